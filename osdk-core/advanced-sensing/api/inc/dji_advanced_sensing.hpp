@@ -21,6 +21,8 @@
 
 #include "dji_camera_stream.hpp"
 
+class H264AccessUnitAssembler;
+
 namespace DJI {
 namespace OSDK {
 
@@ -95,6 +97,35 @@ public:
     RECV_FRONT_DEPTH  = 15,
   };
 
+  /*!
+   * @brief How the M210 stereo image read thread waits for data
+   */
+  enum ReadThreadMode
+  {
+    /*! sleep 10us after every read, the historical behavior */
+    READ_THREAD_POLLING      = 0,
+    /*! only wait inside the blocking USB read, and back off when it fails
+     *  right away */
+    READ_THREAD_EVENT_DRIVEN = 1,
+  };
+
+  /*!
+   * @brief Counters of the M210 stereo image read thread, to compare the
+   * polling and the event-driven mode
+   */
+  typedef struct ReadThreadStat {
+    uint64_t loops;          /*!< receive() calls */
+    uint64_t frames;         /*!< frames handed to the callbacks */
+    uint64_t dataWakeups;    /*!< reads that returned bytes but no whole frame */
+    uint64_t idleWakeups;    /*!< reads that timed out or failed */
+    uint64_t sleepUs;        /*!< time slept between reads */
+    uint64_t avgQueueUs;     /*!< mean time a frame waits in the receive buffer,
+                                  from the read that completed it to its dispatch */
+    uint64_t maxQueueUs;     /*!< worst time a frame waits in the receive buffer */
+    uint64_t avgCallbackUs;  /*!< mean time a frame spends in its callback */
+    uint64_t maxCallbackUs;  /*!< worst time a frame spends in its callback */
+  } ReadThreadStat;
+
 public:
   AdvancedSensing(Vehicle* vehiclePtr);
 
@@ -185,6 +216,110 @@ public:
    *  @return true if successfully started, false otherwise
    */
   bool startMainCameraStream(CameraImageCallback cb = NULL, void * cbParam = NULL);
+  /*! @brief
+   *
+   *  Start the FPV Camera Stream, the callback gets the decoded frames
+   *  without copy
+   *
+   *  @platforms M210V2, M300
+   *  @param cb callback function that is called in a callback thread when a new
+   *            image is received and decoded
+   *  @param cbParam a void pointer that users can manipulate inside the callback
+   *  @return true if successfully started, false otherwise
+   */
+  bool startFPVCameraFrameStream(CameraImageFrameCallback cb, void * cbParam = NULL);
+  /*! @brief
+   *
+   *  Start the Main Camera Stream, the callback gets the decoded frames
+   *  without copy
+   *
+   *  @platforms M210V2, M300
+   *  @param cb callback function that is called in a callback thread when a new
+   *            image is received and decoded
+   *  @param cbParam a void pointer that users can manipulate inside the callback
+   *  @return true if successfully started, false otherwise
+   */
+  bool startMainCameraFrameStream(CameraImageFrameCallback cb, void * cbParam = NULL);
+  /*! @brief
+   *
+   *  Set the pixel format and size of the decoded FPV camera images
+   *
+   *  @platforms M210V2, M300
+   *  @param config output format, RGB24 at stream resolution by default.
+   *         YUV420P and GRAY8 at stream resolution skip the colour conversion.
+   *         A set width or height is at least 2, and even for NV12/YUV420P.
+   *  @return true if the config is valid, false otherwise
+   */
+  bool setFPVCameraImageOutput(const CameraImageOutputConfig& config);
+  /*! @brief
+   *
+   *  Set the pixel format and size of the decoded main camera images
+   *
+   *  @platforms M210V2, M300
+   *  @param config output format, RGB24 at stream resolution by default.
+   *         YUV420P and GRAY8 at stream resolution skip the colour conversion.
+   *         A set width or height is at least 2, and even for NV12/YUV420P.
+   *  @return true if the config is valid, false otherwise
+   */
+  bool setMainCameraImageOutput(const CameraImageOutputConfig& config);
+  /*! @brief
+   *
+   *  Set the number of decoded FPV camera images kept for the consumers
+   *
+   *  @platforms M210V2, M300
+   *  @param ringSize number of frames, 4 by default. More frames let a
+   *         consumer keep some with CameraImageFrame without the decoder
+   *         dropping new ones.
+   *  @note Only succeeds while no frame is being decoded into or borrowed,
+   *        e.g. before the stream is started.
+   *  @return true if the size is changed, false otherwise
+   */
+  bool setFPVCameraImageRingSize(int ringSize);
+  /*! @brief
+   *
+   *  Set the number of decoded main camera images kept for the consumers
+   *
+   *  @platforms M210V2, M300
+   *  @param ringSize number of frames, 4 by default. More frames let a
+   *         consumer keep some with CameraImageFrame without the decoder
+   *         dropping new ones.
+   *  @note Only succeeds while no frame is being decoded into or borrowed,
+   *        e.g. before the stream is started.
+   *  @return true if the size is changed, false otherwise
+   */
+  bool setMainCameraImageRingSize(int ringSize);
+  /*! @brief
+   *
+   *  Get the counters of the decoded FPV camera image ring
+   *
+   *  @platforms M210V2, M300
+   *  @return written, consumed, overwritten and dropped frames
+   */
+  CameraImageRingStat getFPVCameraImageRingStat();
+  /*! @brief
+   *
+   *  Get the counters of the decoded main camera image ring
+   *
+   *  @platforms M210V2, M300
+   *  @return written, consumed, overwritten and dropped frames
+   */
+  CameraImageRingStat getMainCameraImageRingStat();
+  /*! @brief
+   *
+   *  Get the counters of the FPV camera decoding pipeline
+   *
+   *  @platforms M210V2, M300
+   *  @return received and dropped stream chunks, decoded and dropped frames
+   */
+  DecoderPipelineStat getFPVCameraDecoderStat();
+  /*! @brief
+   *
+   *  Get the counters of the main camera decoding pipeline
+   *
+   *  @platforms M210V2, M300
+   *  @return received and dropped stream chunks, decoded and dropped frames
+   */
+  DecoderPipelineStat getMainCameraDecoderStat();
   /*! @brief
    *
    *  Set the ACM device path, mainly for M210V2
@@ -193,6 +328,25 @@ public:
    */
   void setAcmDevicePath(const char *acm_path);
 
+  /*! @brief
+   *
+   *  Choose how the stereo image read thread waits for data, takes effect on
+   *  its next read
+   *
+   *  @platforms M210V2
+   *  @param mode ref to DJI::OSDK::AdvancedSensing::ReadThreadMode
+   */
+  void setReadThreadMode(ReadThreadMode mode);
+
+  /*! @brief
+   *
+   *  Get the counters of the stereo image read thread
+   *
+   *  @platforms M210V2
+   *  @return counters since the thread started
+   */
+  ReadThreadStat getReadThreadStat();
+
   /*! @brief
    *
    *  Stop the FPV RGB Stream
@@ -244,6 +398,28 @@ public:
    *  @return true if a new image frame is ready, false if timeout
    */
   bool getMainCameraImage(CameraRGBImage& copyOfImage);
+  /*! @brief Borrow the new image from the FPV camera without copy
+   *
+   *  @platforms M210V2, M300
+   *  @param frame handle to the new image, it keeps the frame in the decoder's
+   *         pool until it is released or destroyed.
+   *  @note If a new image is not ready upon calling this function,
+   *        it will wait for 20ms till timeout.
+   *
+   *  @return true if a new image frame is ready, false if timeout
+   */
+  bool getFPVCameraImageFrame(CameraImageFrame& frame);
+  /*! @brief Borrow the new image from the main camera without copy
+   *
+   *  @platforms M210V2, M300
+   *  @param frame handle to the new image, it keeps the frame in the decoder's
+   *         pool until it is released or destroyed.
+   *  @note If a new image is not ready upon calling this function,
+   *        it will wait for 20ms till timeout.
+   *
+   *  @return true if a new image frame is ready, false if timeout
+   */
+  bool getMainCameraImageFrame(CameraImageFrame& frame);
 
   /*! @brief
    *  Change the camera stream source from one payload device. (Beta API)
@@ -274,6 +450,24 @@ public:
    */
   LiveView::LiveViewErrCode startH264Stream(LiveView::LiveViewCameraPosition pos, H264Callback cb, void *userData);
 
+  /*! @brief
+   *
+   *  Start the FPV or Camera H264 Stream, reassembled into access units
+   *  with IDR/SPS/PPS flags, receive timestamp and sequence number.
+   *  Stop it with stopH264Stream.
+   *
+   *  @platforms M210V2, M300
+   *  @note For M210 V2 series, only OSDK_CAMERA_POSITION_NO_1 and
+   *  OSDK_CAMERA_POSITION_FPV are supported.
+   *  @param pos point out which camera to output the H264 stream
+   *  @param cb callback function that is called in a callback thread when a new
+   *            access unit is complete
+   *  @param userData a void pointer that users can manipulate inside the callback
+   *  @return Errorcode of liveivew, ref to DJI::OSDK::LiveView::LiveViewErrCode
+   */
+  LiveView::LiveViewErrCode startH264AccessUnitStream(LiveView::LiveViewCameraPosition pos,
+                                                      H264AccessUnitCallback cb, void *userData);
+
   /*! @brief
    *
    *  Stop the FPV or Camera H264 Stream
@@ -300,6 +494,25 @@ public:
    */
   Perception::PerceptionErrCode subscribePerceptionImage(Perception::DirectionType direction, Perception::PerceptionImageCB cb, void* userData);
 
+  /*! @brief
+   *
+   *  Subscribe the perception camera images as left/right pairs delivered on
+   *  worker threads (Only for M300 series). Ref to
+   *  DJI::OSDK::Perception::subscribePerceptionStereoPair
+   *
+   *  @platforms M300
+   *  @param direction point out which direction's stream need to be subscribed
+   *  @param cb callback function that is called in a worker thread when a
+   *            stereo pair is complete
+   *  @param userData a void pointer that users can manipulate inside the callback
+   *  @param config queue depth, worker number and drop policy, NULL for defaults
+   *  @return Errorcode of perception, ref to DJI::OSDK::Perception::PerceptionErrCode
+   */
+  Perception::PerceptionErrCode subscribePerceptionStereoPair(Perception::DirectionType direction,
+                                                              Perception::PerceptionStereoPairCB cb,
+                                                              void *userData,
+                                                              const Perception::StereoDeliveryConfig *config = NULL);
+
   /*! @brief
    *
    *  Unsubscribe the perception camera image stream (Only for M300 series)
@@ -346,6 +559,7 @@ LiveView *liveview;
 Perception *perception;
 const char* acm_dev;
 map<LiveView::LiveViewCameraPosition, DJICameraStreamDecoder*> streamDecoder;
+map<LiveView::LiveViewCameraPosition, H264AccessUnitAssembler*> h264Assembler;
 
 public:
 AdvancedSensingProtocol* getAdvancedSensingProtocol();
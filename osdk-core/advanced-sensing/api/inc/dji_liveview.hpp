@@ -85,6 +85,23 @@ class LiveView {
    */
   LiveViewErrCode startH264Stream(LiveViewCameraPosition pos, H264Callback cb, void *userData);
 
+  /*! @brief
+   *
+   *  Start the FPV or Camera H264 Stream, reassembled into access units.
+   *  Each callback carries one complete coded picture with its IDR/SPS/PPS
+   *  flags, the monotonic receive time of its first byte and a sequence
+   *  number. Stop it with stopH264Stream.
+   *
+   *  @platforms M300
+   *  @param pos point out which camera to output the H264 stream
+   *  @param cb callback function that is called in a callback thread when a new
+   *            access unit is complete
+   *  @param userData a void pointer that users can manipulate inside the callback
+   *  @return Errorcode of liveivew, ref to DJI::OSDK::LiveView::LiveViewErrCode
+   */
+  LiveViewErrCode startH264AccessUnitStream(LiveViewCameraPosition pos,
+                                            H264AccessUnitCallback cb, void *userData);
+
   /*! @brief
    *
    *  Stop the FPV or Camera H264 Stream
@@ -29,17 +29,58 @@
 #ifndef ONBOARDSDK_DJI_LIVEVIEW_IMPL_H
 #define ONBOARDSDK_DJI_LIVEVIEW_IMPL_H
 
+#include <atomic>
 #include "dji_type.hpp"
 #include "dji_vehicle.hpp"
 #include "dji_liveview.hpp"
 #include "dji_linker.hpp"
 
+class H264AccessUnitAssembler;
+
 namespace DJI {
 namespace OSDK {
 
 // Forward Declaration
 class Vehicle;
 
+/*! Callback slots of the H.264 streams, indexed by camera position. The
+ *  receive path reads the handler of a slot through an atomic pointer, so
+ *  dispatching a packet takes no lock and allocates nothing. A published
+ *  handler is never modified, set() publishes a new one and frees the old
+ *  one once no dispatch is running on the slot anymore. */
+class H264CallbackTable {
+ public:
+  typedef struct Handler {
+    H264Callback cb;
+    void *userData;
+  } Handler;
+
+  static const int SLOT_NUM = LiveView::OSDK_CAMERA_POSITION_FPV + 1;
+
+  /*! defaults holds SLOT_NUM handlers, they are used until set() is called
+   *  on a slot and are never freed. */
+  H264CallbackTable(const Handler *defaults);
+
+  ~H264CallbackTable();
+
+  /*! Returns once the previous callback of pos can no longer be running,
+   *  so it must not be called from inside that callback. */
+  void set(LiveView::LiveViewCameraPosition pos, H264Callback cb,
+           void *userData);
+
+  void dispatch(LiveView::LiveViewCameraPosition pos, uint8_t *buf,
+                int bufLen);
+
+ private:
+  typedef struct Slot {
+    std::atomic<const Handler *> active;
+    std::atomic<int> dispatching;
+  } Slot;
+
+  const Handler *defaults;
+  Slot slots[SLOT_NUM];
+};
+
 class LiveViewImpl {
  public:
   LiveViewImpl(Vehicle *vehiclePtr);
@@ -48,14 +89,14 @@ class LiveViewImpl {
 
   LiveView::LiveViewErrCode startH264Stream(LiveView::LiveViewCameraPosition pos, H264Callback cb, void *userData);
 
+  LiveView::LiveViewErrCode startH264AccessUnitStream(LiveView::LiveViewCameraPosition pos,
+                                                      H264AccessUnitCallback cb, void *userData);
+
   LiveView::LiveViewErrCode stopH264Stream(LiveView::LiveViewCameraPosition pos);
 
   LiveView::LiveViewErrCode changeH264Source(LiveView::LiveViewCameraPosition pos, LiveView::LiveViewCameraSource source);
 
-  typedef struct H264CallbackHandler {
-    H264Callback cb;
-    void *userData;
-  } H264CallbackHandler;
+  typedef H264CallbackTable::Handler H264CallbackHandler;
 
  private:
 
@@ -168,8 +209,11 @@ class LiveViewImpl {
   Vehicle *vehicle;
 
  private:
-  static std::map<LiveView::LiveViewCameraPosition, H264CallbackHandler> h264CbHandlerMap;
-  static T_RecvCmdItem bulkCmdList[];
+  static const int H264_CB_SLOT_NUM = H264CallbackTable::SLOT_NUM;
+  static const H264CallbackHandler defaultH264Handlers[H264_CB_SLOT_NUM];
+  H264CallbackTable h264Callbacks;
+  /*! Registered to the linker with this instance as user data */
+  T_RecvCmdItem h264CmdList[4];
   static E_OsdkStat RecordStreamHandler(struct _CommandHandle *cmdHandle,
                                         const T_CmdInfo *cmdInfo,
                                         const uint8_t *cmdData,
@@ -182,6 +226,10 @@ class LiveViewImpl {
   int subscribeLiveViewData(E_OSDKCameraType type, LiveView::LiveViewCameraPosition pos);
   int unsubscribeLiveViewData(LiveView::LiveViewCameraPosition pos);
 
+  /*! Created on the first access unit stream of a position and kept until
+   *  destruction, the receive path may still hold it after a stop. */
+  H264AccessUnitAssembler *h264Assembler[H264_CB_SLOT_NUM];
+
   T_OsdkTaskHandle h264TaskHandle;
   static void *heartBeatTask(void *p);
   E_OsdkStat startHeartBeatTask();
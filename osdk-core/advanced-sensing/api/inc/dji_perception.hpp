@@ -127,6 +127,41 @@ class Perception {
   typedef void(*PerceptionImageCB)
       (Perception::ImageInfoType, uint8_t *imageRawBuffer, int bufferLen, void *userData);
 
+  /*! @bref left and right image of the same stereo frame. The image buffers
+   *  are pooled and only valid inside the callback. */
+  typedef struct StereoImagePair {
+    ImageInfoType leftInfo;
+    ImageInfoType rightInfo;
+    const uint8_t *leftImage;
+    const uint8_t *rightImage;
+    int leftLen;
+    int rightLen;
+  } StereoImagePair;
+
+  /*! @bref callback type to receive paired stereo camera images */
+  typedef void(*PerceptionStereoPairCB)
+      (const Perception::StereoImagePair &pair, void *userData);
+
+  /*! @bref which pair to give up when the delivery queue is full */
+  typedef enum StereoDropPolicy : uint8_t {
+    STEREO_DROP_OLDEST = 0, /*!< keep the latest frames, lowest latency */
+    STEREO_DROP_NEWEST = 1  /*!< keep the queued frames, no gaps in bursts */
+  } StereoDropPolicy;
+
+  typedef struct StereoDeliveryConfig {
+    uint32_t queueDepth;  /*!< pairs waiting for a worker, at least 1 */
+    uint32_t workerNum;   /*!< threads calling the pair callback, at least 1 */
+    StereoDropPolicy dropPolicy;
+  } StereoDeliveryConfig;
+
+  typedef struct StereoDeliveryStat {
+    uint64_t receivedImages;  /*!< images received from the link */
+    uint64_t deliveredPairs;  /*!< pairs handed to the callback */
+    uint64_t droppedPairs;    /*!< pairs discarded because the queue was full */
+    uint64_t unpairedImages;  /*!< images whose other half never arrived */
+    uint64_t droppedImages;   /*!< images discarded because the pool ran out */
+  } StereoDeliveryStat;
+
  public:
 
   /*! @brief subscribe the raw images of both stereo cameras in the same
@@ -141,6 +176,39 @@ class Perception {
    */
   PerceptionErrCode subscribePerceptionImage(DirectionType direction, PerceptionImageCB cb, void* userData);
 
+  /*! @brief subscribe both stereo cameras in the same direction and receive
+   * the left and right images as one pair.
+   *
+   * Each image is copied once into a pooled buffer on the receive thread,
+   * the halves are matched by direction, sequence and time stamp, and the
+   * pairs are passed to cb on dedicated worker threads, so a slow callback
+   * never blocks the link. Every direction has its own delivery, and the
+   * callback set by subscribePerceptionImage keeps receiving the single
+   * images. Use unsubscribePerceptionImage to stop it. The delivery of a
+   * direction can't be restarted or stopped from its own cb, such calls
+   * are refused.
+   *
+   *  @platforms M300
+   *  @param direction to specifly the direction of the subscription. Ref to
+   * DJI::OSDK::Perception::DirectionType
+   *  @param cb callback to observer the stereo image pairs.
+   *  @param userData when cb is called, used in cb.
+   *  @param config queue depth, worker number and drop policy, NULL for
+   * one worker, a depth of 4 and DJI::OSDK::Perception::STEREO_DROP_OLDEST
+   *  @return error code. Ref to DJI::OSDK::Perception::PerceptionErrCode
+   */
+  PerceptionErrCode subscribePerceptionStereoPair(DirectionType direction,
+                                                  PerceptionStereoPairCB cb,
+                                                  void *userData,
+                                                  const StereoDeliveryConfig *config = NULL);
+
+  /*! @brief get the counters of the stereo pair delivery.
+   *
+   *  @platforms M300
+   *  @return counters of all directions since the first pair subscription
+   */
+  StereoDeliveryStat getStereoDeliveryStat();
+
   /*! @brief unsubscribe the raw image of both stereo cameras in the same
    * direction.
    *
@@ -177,6 +245,8 @@ class Perception {
   void cancelAllSubsciptions();
 
  private:
+  PerceptionErrCode subscribeDirection(DirectionType direction);
+
   Vehicle *vehicle;
   PerceptionImpl *impl;
 };
@@ -39,6 +39,7 @@ namespace OSDK {
 
 // Forward Declaration
 class Vehicle;
+class PerceptionStereoDelivery;
 
 class PerceptionImpl {
  public:
@@ -50,6 +51,9 @@ class PerceptionImpl {
   typedef struct PerceptionImageHandler {
     Perception::PerceptionImageCB cb;
     void* userData;
+    /*! Pair engine of each direction, owned by PerceptionImpl and fed
+     *  independently of cb */
+    PerceptionStereoDelivery *delivery[IMAGE_MAX_DIRECTION_NUM];
   } PerceptionImageHandler;
 
   typedef struct PerceptionCamParamHandler {
@@ -77,11 +81,20 @@ class PerceptionImpl {
 
   E_OsdkStat subscribeCameraParam();
 
+  E_OsdkStat startStereoDelivery(Perception::DirectionType direction,
+                                 Perception::PerceptionStereoPairCB cb, void *userData,
+                                 const Perception::StereoDeliveryConfig &config);
+
+  void stopStereoDelivery(Perception::DirectionType direction);
+
+  Perception::StereoDeliveryStat getStereoDeliveryStat();
+
   void cancelAllSubsciptions();
 
   vector<Perception::DirectionType> getUpdatingDiretcion();
  public:
-  static PerceptionImageHandler imageHandler;
+  /*! Per instance, the linker hands it to cameraImageHandler */
+  PerceptionImageHandler imageHandler;
   static PerceptionCamParamHandler camParamHandler;
 
   static const char rectifyDownLeft[11];
@@ -99,6 +112,8 @@ class PerceptionImpl {
 
  private:
   Vehicle *vehicle;
+  PerceptionStereoDelivery *stereoDelivery[IMAGE_MAX_DIRECTION_NUM];
+  T_RecvCmdItem imageCmdList[1];
   static uint32_t imageUpdateSysMs[IMAGE_MAX_DIRECTION_NUM];
   static uint32_t updateJudgingInMs;
   string getSubscribeString(Perception::CamPositionType camChoice);
@@ -0,0 +1,114 @@
+/** @file dji_perception_stereo_delivery.hpp
+ *  @version 4.0.0
+ *  @date Jan 2020
+ *
+ *  @brief Pair and dispatch the perception stereo images off the link thread
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef ONBOARDSDK_DJI_PERCEPTION_STEREO_DELIVERY_H
+#define ONBOARDSDK_DJI_PERCEPTION_STEREO_DELIVERY_H
+
+#include <pthread.h>
+#include <vector>
+#include "dji_perception.hpp"
+
+namespace DJI {
+namespace OSDK {
+
+/*! Copies every image once into a pooled buffer, matches the left and right
+ *  halves of a frame by sequence and time stamp and hands the pairs to a
+ *  small worker pool through a bounded queue. One instance serves one
+ *  direction. push() is called from the link thread and never runs the user
+ *  callback.
+ */
+class PerceptionStereoDelivery {
+ public:
+  static const uint32_t DEFAULT_QUEUE_DEPTH = 4;
+  static const uint32_t DEFAULT_WORKER_NUM = 1;
+  /*! Halves waiting for their other side, older ones are given up */
+  static const uint32_t PENDING_IMAGE_NUM = 4;
+
+  PerceptionStereoDelivery();
+
+  ~PerceptionStereoDelivery();
+
+  /*! Restarts the workers, pairs still queued are dropped. Fails when
+   *  called from the pair callback, which runs on a worker. */
+  bool start(Perception::PerceptionStereoPairCB cb, void *userData,
+             const Perception::StereoDeliveryConfig &config);
+
+  /*! Joins the workers, so it is refused from the pair callback */
+  void stop();
+
+  void push(const Perception::ImageInfoType &info, const uint8_t *image,
+            int imageLen);
+
+  Perception::StereoDeliveryStat getStat();
+
+  static Perception::StereoDeliveryConfig defaultConfig();
+
+ private:
+  typedef struct ImageBuffer {
+    Perception::ImageInfoType info;
+    std::vector<uint8_t> data; /* capacity is kept between frames */
+    int len;
+  } ImageBuffer;
+
+  typedef struct PairItem {
+    ImageBuffer *left;
+    ImageBuffer *right;
+  } PairItem;
+
+  static void *workerTask(void *arg);
+  void workerLoop();
+
+  bool isWorkerThread();
+  static bool isLeftImage(const Perception::ImageInfoType &info);
+  ImageBuffer *takeFreeBuffer();
+  void giveBackBuffer(ImageBuffer *buf);
+  void enqueuePair(ImageBuffer *left, ImageBuffer *right);
+
+  pthread_mutex_t mutex;
+  pthread_cond_t pairReady;
+  std::vector<pthread_t> workers;
+  bool running;
+
+  Perception::PerceptionStereoPairCB cb;
+  void *userData;
+  Perception::StereoDeliveryConfig config;
+
+  std::vector<ImageBuffer *> pool;    /* only grows, buffers may be in use */
+  std::vector<ImageBuffer *> freeBuffers;
+  std::vector<ImageBuffer *> pending;  /* unmatched halves, oldest first */
+  std::vector<PairItem> queue;         /* ring of queueDepth pairs */
+  uint32_t queueHead;
+  uint32_t queueCount;
+
+  Perception::StereoDeliveryStat stat;
+};
+
+} // OSDK
+} // DJI
+
+#endif //ONBOARDSDK_DJI_PERCEPTION_STEREO_DELIVERY_H
@@ -22,7 +22,10 @@
 #include "dji_advanced_sensing.hpp"
 #include "dji_version.hpp"
 #include "dji_camera_stream_decoder.hpp"
+#include "dji_h264_access_unit.hpp"
 #include "dji_linker.hpp"
+#include <atomic>
+#include <time.h>
 using namespace DJI;
 using namespace DJI::OSDK;
 
@@ -42,6 +45,35 @@ Version::VersionData internal_drone_version;
 
 static pthread_t adv_pthread_handle;
 
+static std::atomic<int>      adv_read_mode(AdvancedSensing::READ_THREAD_POLLING);
+static std::atomic<uint64_t> adv_read_loops(0);
+static std::atomic<uint64_t> adv_read_frames(0);
+static std::atomic<uint64_t> adv_read_data_wakeups(0);
+static std::atomic<uint64_t> adv_read_idle_wakeups(0);
+static std::atomic<uint64_t> adv_read_sleep_us(0);
+static std::atomic<uint64_t> adv_read_queue_sum_us(0);
+static std::atomic<uint64_t> adv_read_queue_max_us(0);
+static std::atomic<uint64_t> adv_read_callback_sum_us(0);
+static std::atomic<uint64_t> adv_read_callback_max_us(0);
+
+/*! A failed read faster than this is not a USB timeout, the device is gone */
+static const uint64_t ADV_READ_FAIL_FAST_US = 1000;
+static const int      ADV_READ_BACKOFF_US   = 1000;
+
+static uint64_t adv_time_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void adv_sleep_us(int us)
+{
+  uint64_t start = adv_time_us();
+  usleep(us);
+  adv_read_sleep_us += adv_time_us() - start;
+}
+
 void *adv_pthread(void *p){
   DSTATUS("adv pthread created !!!!!!!!!!!!!!!!!!!!!!!");
   if (p) {
@@ -49,14 +81,66 @@ void *adv_pthread(void *p){
     RecvContainer container = {0};
     RecvContainer* recvContainer = &container;
     Vehicle*       vehiclePtr    = (Vehicle *)p;
+    AdvancedSensingProtocol* protocol =
+      vehiclePtr->advancedSensing->getAdvancedSensingProtocol();
+    ThreadAbstract* threadHandle = protocol->getThreadHandle();
+    uint32_t readCount   = protocol->getReadCount();
+    uint64_t lastReadEnd = adv_time_us();
     while (true)
     {
-      recvContainer = vehiclePtr->advancedSensing->getAdvancedSensingProtocol()->receive();
+      uint64_t readStart = adv_time_us();
+      recvContainer = protocol->receive();
+      uint64_t readEnd = adv_time_us();
+      adv_read_loops++;
+
+      //! Taken under the buffer lock, the same one the parser holds while
+      //! it fills the container
+      threadHandle->lockRecvContainer();
+      uint32_t newReadCount = protocol->getReadCount();
+      bool     pendingData  = protocol->hasPendingData();
+      threadHandle->freeRecvContainer();
+      bool newData = (newReadCount != readCount);
+      readCount = newReadCount;
+      if (newData)
+        lastReadEnd = readEnd;
+
+      bool failed = false;
       if(recvContainer->recvInfo.cmd_id != 0xFF)
       {
+        //! A frame cut from bytes of an earlier read waited behind the
+        //! callbacks of the frames before it
+        uint64_t queueUs = readEnd - lastReadEnd;
+        adv_read_queue_sum_us += queueUs;
+        if (queueUs > adv_read_queue_max_us)
+          adv_read_queue_max_us = queueUs;
+
         vehiclePtr->processAdvancedSensingImgs(recvContainer);
+        uint64_t callbackUs = adv_time_us() - readEnd;
+        adv_read_frames++;
+        adv_read_callback_sum_us += callbackUs;
+        if (callbackUs > adv_read_callback_max_us)
+          adv_read_callback_max_us = callbackUs;
+      }
+      else if (newData)
+      {
+        adv_read_data_wakeups++;
+      }
+      else
+      {
+        adv_read_idle_wakeups++;
+        failed = (readEnd - readStart) < ADV_READ_FAIL_FAST_US;
+      }
+
+      if (adv_read_mode == AdvancedSensing::READ_THREAD_POLLING)
+      {
+        adv_sleep_us(10);
+      }
+      else if (failed && !pendingData)
+      {
+        //! The bulk read blocks until data comes in or it times out, so
+        //! only a read that fails right away needs a pause
+        adv_sleep_us(ADV_READ_BACKOFF_US);
       }
-      usleep(10);
     }
   } else {
     DERROR("passing parameter error !");
@@ -88,6 +172,7 @@ AdvancedSensing::AdvancedSensing(Vehicle* vehiclePtr) :
   vgaHandler.callback     = 0;
   vgaHandler.userData     = 0;
   streamDecoder.clear();
+  h264Assembler.clear();
   // call a closed-source version of getDroneVersion() to prevent hacking
   internalGetDroneVersion(vehiclePtr);
 
@@ -179,6 +264,11 @@ AdvancedSensing::~AdvancedSensing()
     if (pair.second) delete pair.second;
   }
 
+  /*! Cameras and liveview are gone, nothing feeds the assemblers anymore */
+  for (auto pair : h264Assembler) {
+    if (pair.second) delete pair.second;
+  }
+
   /*! Linker destroy liveview handle task */
   if (!vehicle_ptr->linker->destroyLiveViewTask()) {
     DERROR("Failed to destroy task for liveview!");
@@ -510,6 +600,158 @@ bool AdvancedSensing::startMainCameraStream(CameraImageCallback cb, void * cbPar
   }
 }
 
+bool AdvancedSensing::startFPVCameraFrameStream(CameraImageFrameCallback cb,
+                                                void *cbParam) {
+  if (vehicle_ptr->isM300()) {
+    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_FPV);
+    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
+      deocderPair->second->init();
+      deocderPair->second->registerFrameCallback(cb, cbParam);
+      return (LiveView::OSDK_LIVEVIEW_PASS
+          == startH264Stream(LiveView::OSDK_CAMERA_POSITION_FPV, H264ToRGBCb,
+                             deocderPair->second));
+    } else {
+      return false;
+    }
+  } else {
+    return fpvCam_ptr->startCameraFrameStream(cb, cbParam);
+  }
+}
+
+bool AdvancedSensing::startMainCameraFrameStream(CameraImageFrameCallback cb,
+                                                 void *cbParam) {
+  if (vehicle_ptr->isM300()) {
+    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_NO_1);
+    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
+      deocderPair->second->init();
+      deocderPair->second->registerFrameCallback(cb, cbParam);
+      return (LiveView::OSDK_LIVEVIEW_PASS
+          == startH264Stream(LiveView::OSDK_CAMERA_POSITION_NO_1, H264ToRGBCb,
+                             deocderPair->second));
+    } else {
+      return false;
+    }
+  } else {
+    return mainCam_ptr->startCameraFrameStream(cb, cbParam);
+  }
+}
+
+bool AdvancedSensing::setFPVCameraImageOutput(const CameraImageOutputConfig& config)
+{
+  bool ret = false;
+  if (vehicle_ptr->isM300()) {
+    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_FPV);
+    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
+      ret = deocderPair->second->setOutputConfig(config);
+    }
+  } else {
+    ret = fpvCam_ptr->setImageOutputConfig(config);
+  }
+  return ret;
+}
+
+bool AdvancedSensing::setMainCameraImageOutput(const CameraImageOutputConfig& config)
+{
+  bool ret = false;
+  if (vehicle_ptr->isM300()) {
+    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_NO_1);
+    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
+      ret = deocderPair->second->setOutputConfig(config);
+    }
+  } else {
+    ret = mainCam_ptr->setImageOutputConfig(config);
+  }
+  return ret;
+}
+
+bool AdvancedSensing::setFPVCameraImageRingSize(int ringSize)
+{
+  bool ret = false;
+  if (vehicle_ptr->isM300()) {
+    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_FPV);
+    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
+      ret = deocderPair->second->decodedImageHandler.setRingSize(ringSize);
+    }
+  } else {
+    ret = fpvCam_ptr->setImageRingSize(ringSize);
+  }
+  return ret;
+}
+
+bool AdvancedSensing::setMainCameraImageRingSize(int ringSize)
+{
+  bool ret = false;
+  if (vehicle_ptr->isM300()) {
+    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_NO_1);
+    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
+      ret = deocderPair->second->decodedImageHandler.setRingSize(ringSize);
+    }
+  } else {
+    ret = mainCam_ptr->setImageRingSize(ringSize);
+  }
+  return ret;
+}
+
+CameraImageRingStat AdvancedSensing::getFPVCameraImageRingStat()
+{
+  CameraImageRingStat stat;
+  memset(&stat, 0, sizeof(stat));
+  if (vehicle_ptr->isM300()) {
+    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_FPV);
+    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
+      stat = deocderPair->second->decodedImageHandler.getRingStat();
+    }
+  } else {
+    stat = fpvCam_ptr->getImageRingStat();
+  }
+  return stat;
+}
+
+CameraImageRingStat AdvancedSensing::getMainCameraImageRingStat()
+{
+  CameraImageRingStat stat;
+  memset(&stat, 0, sizeof(stat));
+  if (vehicle_ptr->isM300()) {
+    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_NO_1);
+    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
+      stat = deocderPair->second->decodedImageHandler.getRingStat();
+    }
+  } else {
+    stat = mainCam_ptr->getImageRingStat();
+  }
+  return stat;
+}
+
+DecoderPipelineStat AdvancedSensing::getFPVCameraDecoderStat()
+{
+  DecoderPipelineStat stat;
+  memset(&stat, 0, sizeof(stat));
+  if (vehicle_ptr->isM300()) {
+    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_FPV);
+    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
+      stat = deocderPair->second->getPipelineStat();
+    }
+  } else {
+    stat = fpvCam_ptr->getDecoderStat();
+  }
+  return stat;
+}
+
+DecoderPipelineStat AdvancedSensing::getMainCameraDecoderStat()
+{
+  DecoderPipelineStat stat;
+  memset(&stat, 0, sizeof(stat));
+  if (vehicle_ptr->isM300()) {
+    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_NO_1);
+    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
+      stat = deocderPair->second->getPipelineStat();
+    }
+  } else {
+    stat = mainCam_ptr->getDecoderStat();
+  }
+  return stat;
+}
+
 void AdvancedSensing::stopFPVCameraStream()
 {
   if (vehicle_ptr->isM300()) {
@@ -592,11 +834,59 @@ bool AdvancedSensing::getFPVCameraImage(CameraRGBImage& copyOfImage)
   return ret;
 }
 
+bool AdvancedSensing::getMainCameraImageFrame(CameraImageFrame& frame)
+{
+  bool ret = false;
+  if (vehicle_ptr->isM300()) {
+    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_NO_1);
+    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
+      ret = deocderPair->second->getNewImageFrame(frame, 20);
+    }
+  } else {
+    ret = mainCam_ptr->getCurrentImageFrame(frame);
+  }
+  return ret;
+}
+
+bool AdvancedSensing::getFPVCameraImageFrame(CameraImageFrame& frame)
+{
+  bool ret = false;
+  if (vehicle_ptr->isM300()) {
+    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_FPV);
+    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
+      ret = deocderPair->second->getNewImageFrame(frame, 20);
+    }
+  } else {
+    ret = fpvCam_ptr->getCurrentImageFrame(frame);
+  }
+  return ret;
+}
+
 void AdvancedSensing::setAcmDevicePath(const char *acm_path)
 {
     this->acm_dev=acm_path;
 }
 
+void AdvancedSensing::setReadThreadMode(ReadThreadMode mode)
+{
+  adv_read_mode = mode;
+}
+
+AdvancedSensing::ReadThreadStat AdvancedSensing::getReadThreadStat()
+{
+  ReadThreadStat stat;
+  stat.loops         = adv_read_loops;
+  stat.frames        = adv_read_frames;
+  stat.dataWakeups   = adv_read_data_wakeups;
+  stat.idleWakeups   = adv_read_idle_wakeups;
+  stat.sleepUs       = adv_read_sleep_us;
+  stat.avgQueueUs    = stat.frames ? adv_read_queue_sum_us / stat.frames : 0;
+  stat.maxQueueUs    = adv_read_queue_max_us;
+  stat.avgCallbackUs = stat.frames ? adv_read_callback_sum_us / stat.frames : 0;
+  stat.maxCallbackUs = adv_read_callback_max_us;
+  return stat;
+}
+
 LiveView::LiveViewErrCode AdvancedSensing::changeH264Source(LiveView::LiveViewCameraPosition pos,
                                                             LiveView::LiveViewCameraSource source) {
   return liveview->changeH264Source(pos, source);
@@ -621,6 +911,34 @@ LiveView::LiveViewErrCode AdvancedSensing::startH264Stream(
   }
 }
 
+LiveView::LiveViewErrCode AdvancedSensing::startH264AccessUnitStream(
+    LiveView::LiveViewCameraPosition pos, H264AccessUnitCallback cb, void *userData) {
+  if (vehicle_ptr->isM300())
+    return liveview->startH264AccessUnitStream(pos, cb, userData);
+  else if(vehicle_ptr->isM210V2()) {
+    DJICameraStream *cam;
+    switch (pos) {
+      case LiveView::OSDK_CAMERA_POSITION_FPV:
+        cam = fpvCam_ptr;
+        break;
+      case LiveView::OSDK_CAMERA_POSITION_NO_1:
+        cam = mainCam_ptr;
+        break;
+      default:
+        DERROR("M210 V2 series only support FPV and MainCam H264 steam in OSDK.");
+        return LiveView::OSDK_LIVEVIEW_INDEX_ILLEGAL;
+    }
+    /*! Kept until destruction, the link thread may still feed it after a stop */
+    H264AccessUnitAssembler *&assembler = h264Assembler[pos];
+    if (!assembler) assembler = new H264AccessUnitAssembler();
+    assembler->setCallback(cb, userData);
+    return (cam->startCameraH264(&H264AccessUnitAssembler::feedCallback, assembler))
+           ? LiveView::OSDK_LIVEVIEW_PASS : LiveView::OSDK_LIVEVIEW_UNKNOWN;
+  } else {
+    return LiveView::OSDK_LIVEVIEW_UNSUPPORT_AIRCRAFT;
+  }
+}
+
 LiveView::LiveViewErrCode AdvancedSensing::stopH264Stream(
     LiveView::LiveViewCameraPosition pos) {
   if (vehicle_ptr->isM300())
@@ -719,6 +1037,17 @@ Perception::PerceptionErrCode AdvancedSensing::subscribePerceptionImage(
   }
 }
 
+Perception::PerceptionErrCode AdvancedSensing::subscribePerceptionStereoPair(
+    Perception::DirectionType direction, Perception::PerceptionStereoPairCB cb,
+    void *userData, const Perception::StereoDeliveryConfig *config) {
+  if (vehicle_ptr->isM300()) {
+    return perception->subscribePerceptionStereoPair(direction, cb, userData, config);
+  } else {
+    DERROR("Only support M300");
+    return Perception::OSDK_PERCEPTION_REQ_UNSUPPORT;
+  }
+}
+
 Perception::PerceptionErrCode AdvancedSensing::unsubscribePerceptionImage(
     Perception::DirectionType direction) {
   if (vehicle_ptr->isM210V2()) {
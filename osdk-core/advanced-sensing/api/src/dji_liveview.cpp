@@ -55,6 +55,15 @@ LiveView::LiveViewErrCode LiveView::startH264Stream(LiveViewCameraPosition pos,
   }
 }
 
+LiveView::LiveViewErrCode LiveView::startH264AccessUnitStream(LiveViewCameraPosition pos,
+                                                              H264AccessUnitCallback cb, void *userData) {
+  if(vehicle->isM300()) {
+    return impl->startH264AccessUnitStream(pos, cb, userData);
+  } else {
+    return OSDK_LIVEVIEW_UNSUPPORT_AIRCRAFT;
+  }
+}
+
 LiveView::LiveViewErrCode LiveView::stopH264Stream(LiveViewCameraPosition pos) {
   if (vehicle->isM300()) {
     return impl->stopH264Stream(pos);
@@ -28,6 +28,7 @@
 
 #include <dji_vehicle.hpp>
 #include "dji_liveview_impl.hpp"
+#include "dji_h264_access_unit.hpp"
 #include "osdk_osal.h"
 
 using namespace DJI;
@@ -61,26 +62,90 @@ void defaultH264CB(uint8_t* buf, int bufLen, void* userData) {
   *(uint8_t *)userData = 1;
 }
 
-std::map<LiveView::LiveViewCameraPosition, LiveViewImpl::H264CallbackHandler> LiveViewImpl::h264CbHandlerMap = {
-        {LiveView::OSDK_CAMERA_POSITION_NO_1, {defaultH264CB, (void *)&(defUserData[LiveView::OSDK_CAMERA_POSITION_NO_1])}},
-        {LiveView::OSDK_CAMERA_POSITION_NO_2, {defaultH264CB, (void *)&(defUserData[LiveView::OSDK_CAMERA_POSITION_NO_2])}},
-        {LiveView::OSDK_CAMERA_POSITION_NO_3, {defaultH264CB, (void *)&(defUserData[LiveView::OSDK_CAMERA_POSITION_NO_3])}},
-        {LiveView::OSDK_CAMERA_POSITION_FPV,  {defaultH264CB, (void *)&(defUserData[LiveView::OSDK_CAMERA_POSITION_FPV])}},
+#define H264_CB_HANDLER(pos, cb) {cb, (void *)&(defUserData[pos])}
+
+const LiveViewImpl::H264CallbackHandler LiveViewImpl::defaultH264Handlers[LiveViewImpl::H264_CB_SLOT_NUM] = {
+        H264_CB_HANDLER(LiveView::OSDK_CAMERA_POSITION_NO_1, defaultH264CB),
+        H264_CB_HANDLER(LiveView::OSDK_CAMERA_POSITION_NO_2, defaultH264CB),
+        H264_CB_HANDLER(LiveView::OSDK_CAMERA_POSITION_NO_3, defaultH264CB),
+        H264_CB_HANDLER(3, NULL),
+        H264_CB_HANDLER(4, NULL),
+        H264_CB_HANDLER(5, NULL),
+        H264_CB_HANDLER(6, NULL),
+        H264_CB_HANDLER(LiveView::OSDK_CAMERA_POSITION_FPV, defaultH264CB),
     };
 
-T_RecvCmdItem LiveViewImpl::bulkCmdList[] = {
-    PROT_CMD_ITEM(0, 0, LIVEVIEW_TEMP_CMD_SET, LIVEVIEW_FPV_CAM_TEMP_CMD_ID,  MASK_HOST_DEVICE_SET_ID, (void *)&h264CbHandlerMap, RecordStreamHandler),
-    PROT_CMD_ITEM(0, 0, LIVEVIEW_TEMP_CMD_SET, LIVEVIEW_MAIN_CAM_TEMP_CMD_ID, MASK_HOST_DEVICE_SET_ID, (void *)&h264CbHandlerMap, RecordStreamHandler),
-    PROT_CMD_ITEM(0, 0, LIVEVIEW_TEMP_CMD_SET, LIVEVIEW_VICE_CAM_TEMP_CMD_ID, MASK_HOST_DEVICE_SET_ID, (void *)&h264CbHandlerMap, RecordStreamHandler),
-    PROT_CMD_ITEM(0, 0, LIVEVIEW_TEMP_CMD_SET, LIVEVIEW_TOP_CAM_TEMP_CMD_ID,  MASK_HOST_DEVICE_SET_ID, (void *)&h264CbHandlerMap, RecordStreamHandler),
-};
+H264CallbackTable::H264CallbackTable(const Handler *defaults) :
+    defaults(defaults)
+{
+  for (int i = 0; i < SLOT_NUM; i++) {
+    slots[i].active.store(&defaults[i]);
+    slots[i].dispatching.store(0);
+  }
+}
+
+H264CallbackTable::~H264CallbackTable()
+{
+  for (int i = 0; i < SLOT_NUM; i++) {
+    const Handler *handler = slots[i].active.load();
+    if (handler != &defaults[i]) delete handler;
+  }
+}
+
+void H264CallbackTable::dispatch(LiveView::LiveViewCameraPosition pos,
+                                 uint8_t *buf, int bufLen) {
+  if ((pos < 0) || (pos >= SLOT_NUM)) return;
+
+  /*! Announce the dispatch before loading the handler. Together with the
+   *  exchange and the load of dispatching in set(), all seq_cst, either
+   *  set() sees this dispatch or this dispatch sees the new handler. */
+  Slot &slot = slots[pos];
+  slot.dispatching.fetch_add(1);
+  const Handler *handler = slot.active.load();
+  if (handler->cb != NULL) {
+    handler->cb(buf, bufLen, handler->userData);
+  }
+  slot.dispatching.fetch_sub(1);
+}
+
+void H264CallbackTable::set(LiveView::LiveViewCameraPosition pos,
+                            H264Callback cb, void *userData) {
+  if ((pos < 0) || (pos >= SLOT_NUM)) return;
+
+  Handler *handler = new Handler;
+  handler->cb = cb;
+  handler->userData = userData;
+
+  Slot &slot = slots[pos];
+  const Handler *old = slot.active.exchange(handler);
+
+  /*! A dispatch that started before the exchange may still be using the
+   *  old handler, any later one already sees the new handler. */
+  while (slot.dispatching.load() != 0) {
+    OsdkOsal_TaskSleepMs(1);
+  }
+  if (old != &defaults[pos]) delete old;
+}
+
+#define H264_CMD_ITEM(cmdId) \
+  PROT_CMD_ITEM(0, 0, LIVEVIEW_TEMP_CMD_SET, cmdId, MASK_HOST_DEVICE_SET_ID, (void *)this, RecordStreamHandler)
 
 LiveViewImpl::LiveViewImpl(Vehicle* vehiclePtr) :
-    vehicle(vehiclePtr)
+    vehicle(vehiclePtr), h264Callbacks(defaultH264Handlers)
 {
+  for (int i = 0; i < H264_CB_SLOT_NUM; i++) h264Assembler[i] = NULL;
+
+  const T_RecvCmdItem cmdList[] = {
+      H264_CMD_ITEM(LIVEVIEW_FPV_CAM_TEMP_CMD_ID),
+      H264_CMD_ITEM(LIVEVIEW_MAIN_CAM_TEMP_CMD_ID),
+      H264_CMD_ITEM(LIVEVIEW_VICE_CAM_TEMP_CMD_ID),
+      H264_CMD_ITEM(LIVEVIEW_TOP_CAM_TEMP_CMD_ID),
+  };
+  memcpy(h264CmdList, cmdList, sizeof(h264CmdList));
+
   T_RecvCmdHandle recvCmdHandle;
-  recvCmdHandle.cmdList = bulkCmdList;
-  recvCmdHandle.cmdCount = sizeof(bulkCmdList) / sizeof(T_RecvCmdItem);
+  recvCmdHandle.cmdList = h264CmdList;
+  recvCmdHandle.cmdCount = sizeof(h264CmdList) / sizeof(T_RecvCmdItem);
   recvCmdHandle.protoType = PROTOCOL_USBMC;
 
   if(!vehicle->linker->registerCmdHandler(&recvCmdHandle)) {
@@ -99,6 +164,12 @@ LiveViewImpl::LiveViewImpl(Vehicle* vehiclePtr) :
 
 LiveViewImpl::~LiveViewImpl()
 {
+  for (int i = 0; i < H264_CB_SLOT_NUM; i++) {
+    if (h264Assembler[i]) {
+      h264Callbacks.set((LiveView::LiveViewCameraPosition)i, NULL, NULL);
+      delete h264Assembler[i];
+    }
+  }
 }
 
 E_OsdkStat LiveViewImpl::RecordStreamHandler(struct _CommandHandle *cmdHandle,
@@ -110,8 +181,7 @@ E_OsdkStat LiveViewImpl::RecordStreamHandler(struct _CommandHandle *cmdHandle,
     return OSDK_STAT_ERR;
   }
 
-  std::map<LiveView::LiveViewCameraPosition, H264CallbackHandler> handlerMap =
-      *(std::map<LiveView::LiveViewCameraPosition, H264CallbackHandler> *)userData;
+  LiveViewImpl *impl = (LiveViewImpl *)userData;
 
   LiveView::LiveViewCameraPosition pos;
   switch (cmdInfo->cmdId) {
@@ -131,11 +201,7 @@ E_OsdkStat LiveViewImpl::RecordStreamHandler(struct _CommandHandle *cmdHandle,
       return OSDK_STAT_ERR_OUT_OF_RANGE;
   }
 
-  if((handlerMap.find(pos) != handlerMap.end()) && (handlerMap[pos].cb != NULL)) {
-    handlerMap[pos].cb((uint8_t *)cmdData, cmdInfo->dataLen, handlerMap[pos].userData);
-  } else {
-    //DERROR("Can't find valid cb in handlerMap, pos = %d", pos);
-  }
+  impl->h264Callbacks.dispatch(pos, (uint8_t *)cmdData, cmdInfo->dataLen);
 
   return OSDK_STAT_OK;
 }
@@ -467,10 +533,7 @@ LiveView::LiveViewErrCode LiveViewImpl::startH264Stream(LiveView::LiveViewCamera
     return LiveView::OSDK_LIVEVIEW_CAM_NOT_MOUNTED;
   }
 
-  if (h264CbHandlerMap.find(pos) != h264CbHandlerMap.end()) {
-    h264CbHandlerMap[pos].cb = cb;
-    h264CbHandlerMap[pos].userData = userData;
-  }
+  h264Callbacks.set(pos, cb, userData);
 
   if(subscribeLiveViewData(targetCamType, pos) == -1) {
     //vehicle->linker->destroyLiveViewTask();
@@ -484,6 +547,21 @@ LiveView::LiveViewErrCode LiveViewImpl::startH264Stream(LiveView::LiveViewCamera
   return LiveView::OSDK_LIVEVIEW_PASS;
 }
 
+LiveView::LiveViewErrCode LiveViewImpl::startH264AccessUnitStream(LiveView::LiveViewCameraPosition pos,
+                                                                H264AccessUnitCallback cb, void *userData) {
+  if ((pos < 0) || (pos >= H264_CB_SLOT_NUM)) {
+    DERROR("camera[%d] is not mounted\n", pos);
+    return LiveView::OSDK_LIVEVIEW_CAM_NOT_MOUNTED;
+  }
+
+  /*! The raw packets go through the assembler, which hands complete access
+   *  units to the user callback from the same receive thread. */
+  if (!h264Assembler[pos]) h264Assembler[pos] = new H264AccessUnitAssembler();
+  h264Assembler[pos]->setCallback(cb, userData);
+
+  return startH264Stream(pos, &H264AccessUnitAssembler::feedCallback, h264Assembler[pos]);
+}
+
 LiveView::LiveViewErrCode LiveViewImpl::stopH264Stream(LiveView::LiveViewCameraPosition pos) {
   unsubscribeLiveViewData(pos);
   stopHeartBeatTask();
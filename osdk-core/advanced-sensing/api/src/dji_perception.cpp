@@ -29,6 +29,7 @@
 
 #include "dji_perception.hpp"
 #include "dji_perception_impl.hpp"
+#include "dji_perception_stereo_delivery.hpp"
 #include "osdk_osal.h"
 
 using namespace DJI;
@@ -48,6 +49,34 @@ Perception::~Perception() {
 Perception::PerceptionErrCode Perception::subscribePerceptionImage(DirectionType direction,
                                           PerceptionImageCB cb,
                                           void *userData) {
+  PerceptionErrCode ret = subscribeDirection(direction);
+  if (ret == OSDK_PERCEPTION_PASS) {
+    impl->imageHandler.cb = cb;
+    impl->imageHandler.userData = userData;
+  }
+  return ret;
+}
+
+Perception::PerceptionErrCode Perception::subscribePerceptionStereoPair(DirectionType direction,
+                                                                       PerceptionStereoPairCB cb,
+                                                                       void *userData,
+                                                                       const StereoDeliveryConfig *config) {
+  StereoDeliveryConfig cfg = config ? *config : PerceptionStereoDelivery::defaultConfig();
+  PerceptionErrCode ret = subscribeDirection(direction);
+  if (ret != OSDK_PERCEPTION_PASS) return ret;
+
+  if (impl->startStereoDelivery(direction, cb, userData, cfg) != OSDK_STAT_OK) {
+    impl->unsubscribePerceptionImage(direction);
+    return OSDK_PERCEPTION_SUBSCRIBE_FAIL;
+  }
+  return OSDK_PERCEPTION_PASS;
+}
+
+Perception::StereoDeliveryStat Perception::getStereoDeliveryStat() {
+  return impl->getStereoDeliveryStat();
+}
+
+Perception::PerceptionErrCode Perception::subscribeDirection(DirectionType direction) {
   const char *camChoice1;
   const char *camChoice2;
 
@@ -82,7 +111,6 @@ Perception::PerceptionErrCode Perception::subscribePerceptionImage(DirectionType
     DSTATUS("Subscribe perception image %s successfully", camChoice1);
     if (impl->subscribePerceptionImage(camChoice2) == OSDK_STAT_OK) {
       DSTATUS("Subscribe perception image %s successfully", camChoice2);
-      impl->imageHandler = {cb, userData};
       return OSDK_PERCEPTION_PASS;
     } else {
       DERROR("Subscribe perception image %s failed", camChoice2);
@@ -98,6 +126,7 @@ Perception::PerceptionErrCode Perception::subscribePerceptionImage(DirectionType
 Perception::PerceptionErrCode Perception::unsubscribePerceptionImage(DirectionType direction) {
   Perception::PerceptionErrCode ret = OSDK_PERCEPTION_PASS;
   auto result = impl->unsubscribePerceptionImage(direction);
+  impl->stopStereoDelivery(direction);
 
   if (result == OSDK_STAT_OK) return OSDK_PERCEPTION_PASS;
   else if (result == OSDK_STAT_ERR_PARAM) return OSDK_PERCEPTION_PARAM_ERR;
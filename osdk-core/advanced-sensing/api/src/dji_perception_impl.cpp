@@ -27,8 +27,10 @@
  */
 
 
+#include <cstring>
 #include <dji_vehicle.hpp>
 #include "dji_perception_impl.hpp"
+#include "dji_perception_stereo_delivery.hpp"
 #include "osdk_osal.h"
 
 using namespace DJI;
@@ -50,25 +52,35 @@ const char PerceptionImpl::rectifyRightRight[11] = "rectify_rr";
 uint32_t PerceptionImpl::updateJudgingInMs = 100;
 uint32_t PerceptionImpl::imageUpdateSysMs[] = {0};
 
-PerceptionImpl::PerceptionImageHandler PerceptionImpl::imageHandler = {NULL, NULL};
 PerceptionImpl::PerceptionCamParamHandler PerceptionImpl::camParamHandler = {NULL, NULL};
 
-T_RecvCmdItem s_bulkCmdList[] = {
-    PROT_CMD_ITEM(0, 0, 0x24, 0x13, MASK_HOST_DEVICE_SET_ID, &PerceptionImpl::imageHandler,
-                  PerceptionImpl::cameraImageHandler),
-};
-
 T_RecvCmdItem s_v1CmdList[] = {
     PROT_CMD_ITEM(0, 0, 0x24, 0x33, MASK_HOST_DEVICE_SET_ID, &PerceptionImpl::camParamHandler,
                   PerceptionImpl::cameraParamHandler),
 };
 
 PerceptionImpl::PerceptionImpl(Vehicle* vehiclePtr) : vehicle(vehiclePtr) {
+  imageHandler.cb = NULL;
+  imageHandler.userData = NULL;
+
+  /*! Created up front and only deleted with PerceptionImpl, so the link
+   *  thread never sees a pointer change while it pushes images */
+  for (int i = 0; i < IMAGE_MAX_DIRECTION_NUM; i++) {
+    stereoDelivery[i] = new PerceptionStereoDelivery();
+    imageHandler.delivery[i] = stereoDelivery[i];
+  }
+
+  const T_RecvCmdItem bulkCmdList[] = {
+      PROT_CMD_ITEM(0, 0, 0x24, 0x13, MASK_HOST_DEVICE_SET_ID, &imageHandler,
+                    PerceptionImpl::cameraImageHandler),
+  };
+  memcpy(imageCmdList, bulkCmdList, sizeof(imageCmdList));
+
   T_RecvCmdHandle recvCmdHandle1;
   T_RecvCmdHandle recvCmdHandle2;
 
-  recvCmdHandle1.cmdList = s_bulkCmdList;
-  recvCmdHandle1.cmdCount = sizeof(s_bulkCmdList) / sizeof(T_RecvCmdItem);
+  recvCmdHandle1.cmdList = imageCmdList;
+  recvCmdHandle1.cmdCount = sizeof(imageCmdList) / sizeof(T_RecvCmdItem);
   recvCmdHandle1.protoType = PROTOCOL_USBMC;
 
   recvCmdHandle2.cmdList = s_v1CmdList;
@@ -85,6 +97,10 @@ PerceptionImpl::PerceptionImpl(Vehicle* vehiclePtr) : vehicle(vehiclePtr) {
 
 PerceptionImpl::~PerceptionImpl()
 {
+  for (int i = 0; i < IMAGE_MAX_DIRECTION_NUM; i++) {
+    imageHandler.delivery[i] = NULL;
+    delete stereoDelivery[i];
+  }
 }
 
 vector<Perception::DirectionType> PerceptionImpl::getUpdatingDiretcion() {
@@ -122,9 +138,17 @@ E_OsdkStat PerceptionImpl::cameraImageHandler(struct _CommandHandle *cmdHandle,
   }
 
   PerceptionImageHandler *handler = (PerceptionImageHandler *) userData;
-  if (header->rawInfo.direction < IMAGE_MAX_DIRECTION_NUM)
+  if (header->rawInfo.direction < IMAGE_MAX_DIRECTION_NUM) {
     OsdkOsal_GetTimeMs(&imageUpdateSysMs[header->rawInfo.direction]);
 
+    /*! A stopped delivery ignores the image */
+    PerceptionStereoDelivery *delivery = handler->delivery[header->rawInfo.direction];
+    if (delivery)
+      delivery->push(*header,
+                     cmdData + sizeof(Perception::ImageInfoType),
+                     cmdInfo->dataLen - sizeof(Perception::ImageInfoType));
+  }
+
   if (handler->cb)
     handler->cb(*header,
                 (uint8_t *) (cmdData + sizeof(Perception::ImageInfoType)),
@@ -355,6 +379,7 @@ void PerceptionImpl::cancelAllSubsciptions() {
     for (auto dir : updatingMsg) {
       DSTATUS("Unsubscribing stereo camera images (DirectionType : %d)", dir);
       unsubscribePerceptionImage(dir);
+      stopStereoDelivery(dir);
     }
   }
 }
@@ -401,3 +426,28 @@ E_OsdkStat PerceptionImpl::subscribeCameraParam() {
   else
     return OSDK_STAT_SYS_ERR;
 }
+
+E_OsdkStat PerceptionImpl::startStereoDelivery(Perception::DirectionType direction,
+                                               Perception::PerceptionStereoPairCB cb, void *userData,
+                                               const Perception::StereoDeliveryConfig &config) {
+  if ((unsigned) direction >= IMAGE_MAX_DIRECTION_NUM) return OSDK_STAT_ERR_PARAM;
+  if (!stereoDelivery[direction]->start(cb, userData, config)) return OSDK_STAT_SYS_ERR;
+  return OSDK_STAT_OK;
+}
+
+void PerceptionImpl::stopStereoDelivery(Perception::DirectionType direction) {
+  if ((unsigned) direction < IMAGE_MAX_DIRECTION_NUM) stereoDelivery[direction]->stop();
+}
+
+Perception::StereoDeliveryStat PerceptionImpl::getStereoDeliveryStat() {
+  Perception::StereoDeliveryStat stat = {0};
+  for (int i = 0; i < IMAGE_MAX_DIRECTION_NUM; i++) {
+    Perception::StereoDeliveryStat one = stereoDelivery[i]->getStat();
+    stat.receivedImages += one.receivedImages;
+    stat.deliveredPairs += one.deliveredPairs;
+    stat.droppedPairs += one.droppedPairs;
+    stat.unpairedImages += one.unpairedImages;
+    stat.droppedImages += one.droppedImages;
+  }
+  return stat;
+}
@@ -0,0 +1,281 @@
+/** @file dji_perception_stereo_delivery.cpp
+ *  @version 4.0.0
+ *  @date Jan 2020
+ *
+ *  @brief Pair and dispatch the perception stereo images off the link thread
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <cstring>
+#include "dji_perception_stereo_delivery.hpp"
+#include "dji_log.hpp"
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+PerceptionStereoDelivery::PerceptionStereoDelivery()
+    : running(false),
+      cb(NULL),
+      userData(NULL),
+      config(defaultConfig()),
+      queueHead(0),
+      queueCount(0) {
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&pairReady, NULL);
+  pending.reserve(PENDING_IMAGE_NUM);
+  memset(&stat, 0, sizeof(stat));
+}
+
+PerceptionStereoDelivery::~PerceptionStereoDelivery() {
+  stop();
+  for (size_t i = 0; i < pool.size(); i++) delete pool[i];
+  pthread_cond_destroy(&pairReady);
+  pthread_mutex_destroy(&mutex);
+}
+
+Perception::StereoDeliveryConfig PerceptionStereoDelivery::defaultConfig() {
+  Perception::StereoDeliveryConfig def;
+  def.queueDepth = DEFAULT_QUEUE_DEPTH;
+  def.workerNum = DEFAULT_WORKER_NUM;
+  def.dropPolicy = Perception::STEREO_DROP_OLDEST;
+  return def;
+}
+
+bool PerceptionStereoDelivery::start(Perception::PerceptionStereoPairCB cb,
+                                     void *userData,
+                                     const Perception::StereoDeliveryConfig &config) {
+  if (isWorkerThread()) {
+    DERROR("Stereo delivery can't be restarted from its pair callback");
+    return false;
+  }
+  stop();
+
+  pthread_mutex_lock(&mutex);
+  this->cb = cb;
+  this->userData = userData;
+  this->config = config;
+  if (this->config.queueDepth < 1) this->config.queueDepth = 1;
+  if (this->config.workerNum < 1) this->config.workerNum = 1;
+
+  /*! Every queued pair, every pair inside a callback, the unmatched halves
+   *  and the image being copied by push() need their own buffer. */
+  size_t needed = 2 * (this->config.queueDepth + this->config.workerNum)
+                  + PENDING_IMAGE_NUM + 1;
+  freeBuffers.reserve(needed);
+  while (pool.size() < needed) {
+    ImageBuffer *buf = new ImageBuffer();
+    buf->len = 0;
+    pool.push_back(buf);
+    freeBuffers.push_back(buf);
+  }
+  queue.resize(this->config.queueDepth);
+  queueHead = 0;
+  queueCount = 0;
+  running = true;
+
+  workers.resize(this->config.workerNum);
+  size_t started = 0;
+  for (; started < workers.size(); started++) {
+    if (pthread_create(&workers[started], NULL, workerTask, this) != 0) break;
+  }
+  pthread_mutex_unlock(&mutex);
+
+  if (started < workers.size()) {
+    DERROR("Failed to start stereo delivery worker %d", (int) started);
+    workers.resize(started);
+    stop();
+    return false;
+  }
+  return true;
+}
+
+void PerceptionStereoDelivery::stop() {
+  if (isWorkerThread()) {
+    DERROR("Stereo delivery can't be stopped from its pair callback");
+    return;
+  }
+
+  pthread_mutex_lock(&mutex);
+  running = false;
+  pthread_cond_broadcast(&pairReady);
+  pthread_mutex_unlock(&mutex);
+
+  /*! Workers finish the callback they are in before leaving */
+  for (size_t i = 0; i < workers.size(); i++) pthread_join(workers[i], NULL);
+  workers.clear();
+
+  pthread_mutex_lock(&mutex);
+  while (queueCount) {
+    giveBackBuffer(queue[queueHead].left);
+    giveBackBuffer(queue[queueHead].right);
+    queueHead = (queueHead + 1) % queue.size();
+    queueCount--;
+  }
+  for (size_t i = 0; i < pending.size(); i++) giveBackBuffer(pending[i]);
+  pending.clear();
+  pthread_mutex_unlock(&mutex);
+}
+
+void PerceptionStereoDelivery::push(const Perception::ImageInfoType &info,
+                                    const uint8_t *image, int imageLen) {
+  if (!image || imageLen <= 0) return;
+
+  pthread_mutex_lock(&mutex);
+  if (!running) {
+    pthread_mutex_unlock(&mutex);
+    return;
+  }
+  stat.receivedImages++;
+  ImageBuffer *buf = takeFreeBuffer();
+  if (!buf) stat.droppedImages++;
+  pthread_mutex_unlock(&mutex);
+  if (!buf) return;
+
+  /*! The only copy of the image, done without holding the lock */
+  buf->info = info;
+  if (buf->data.size() < (size_t) imageLen) buf->data.resize(imageLen);
+  memcpy(&buf->data[0], image, imageLen);
+  buf->len = imageLen;
+
+  bool left = isLeftImage(info);
+  pthread_mutex_lock(&mutex);
+  if (!running) {
+    giveBackBuffer(buf);
+    pthread_mutex_unlock(&mutex);
+    return;
+  }
+
+  for (size_t i = 0; i < pending.size(); i++) {
+    ImageBuffer *other = pending[i];
+    if ((other->info.rawInfo.direction == info.rawInfo.direction)
+        && (other->info.sequence == info.sequence)
+        && (other->info.timeStamp == info.timeStamp)
+        && (isLeftImage(other->info) != left)) {
+      pending.erase(pending.begin() + i);
+      if (left) enqueuePair(buf, other);
+      else enqueuePair(other, buf);
+      pthread_mutex_unlock(&mutex);
+      return;
+    }
+  }
+
+  if (pending.size() >= PENDING_IMAGE_NUM) {
+    giveBackBuffer(pending[0]);
+    pending.erase(pending.begin());
+    stat.unpairedImages++;
+  }
+  pending.push_back(buf);
+  pthread_mutex_unlock(&mutex);
+}
+
+Perception::StereoDeliveryStat PerceptionStereoDelivery::getStat() {
+  pthread_mutex_lock(&mutex);
+  Perception::StereoDeliveryStat copy = stat;
+  pthread_mutex_unlock(&mutex);
+  return copy;
+}
+
+bool PerceptionStereoDelivery::isWorkerThread() {
+  /*! workers only changes in start() and stop(), which a worker never
+   *  gets through, so a worker always finds itself here */
+  pthread_t self = pthread_self();
+  pthread_mutex_lock(&mutex);
+  bool found = false;
+  for (size_t i = 0; i < workers.size(); i++) {
+    if (pthread_equal(workers[i], self)) found = true;
+  }
+  pthread_mutex_unlock(&mutex);
+  return found;
+}
+
+bool PerceptionStereoDelivery::isLeftImage(const Perception::ImageInfoType &info) {
+  /*! Left cameras have the odd CamPositionType values */
+  return (info.dataType & 1) != 0;
+}
+
+PerceptionStereoDelivery::ImageBuffer *PerceptionStereoDelivery::takeFreeBuffer() {
+  if (freeBuffers.empty()) return NULL;
+  ImageBuffer *buf = freeBuffers.back();
+  freeBuffers.pop_back();
+  return buf;
+}
+
+void PerceptionStereoDelivery::giveBackBuffer(ImageBuffer *buf) {
+  freeBuffers.push_back(buf);
+}
+
+void PerceptionStereoDelivery::enqueuePair(ImageBuffer *left, ImageBuffer *right) {
+  if (queueCount == queue.size()) {
+    stat.droppedPairs++;
+    if (config.dropPolicy == Perception::STEREO_DROP_NEWEST) {
+      giveBackBuffer(left);
+      giveBackBuffer(right);
+      return;
+    }
+    giveBackBuffer(queue[queueHead].left);
+    giveBackBuffer(queue[queueHead].right);
+    queueHead = (queueHead + 1) % queue.size();
+    queueCount--;
+  }
+
+  PairItem &item = queue[(queueHead + queueCount) % queue.size()];
+  item.left = left;
+  item.right = right;
+  queueCount++;
+  pthread_cond_signal(&pairReady);
+}
+
+void *PerceptionStereoDelivery::workerTask(void *arg) {
+  ((PerceptionStereoDelivery *) arg)->workerLoop();
+  return NULL;
+}
+
+void PerceptionStereoDelivery::workerLoop() {
+  pthread_mutex_lock(&mutex);
+  while (true) {
+    while (running && (queueCount == 0)) pthread_cond_wait(&pairReady, &mutex);
+    if (!running) break;
+
+    PairItem item = queue[queueHead];
+    queueHead = (queueHead + 1) % queue.size();
+    queueCount--;
+    Perception::PerceptionStereoPairCB pairCb = cb;
+    void *pairUserData = userData;
+    pthread_mutex_unlock(&mutex);
+
+    Perception::StereoImagePair pair;
+    pair.leftInfo = item.left->info;
+    pair.rightInfo = item.right->info;
+    pair.leftImage = &item.left->data[0];
+    pair.rightImage = &item.right->data[0];
+    pair.leftLen = item.left->len;
+    pair.rightLen = item.right->len;
+    if (pairCb) pairCb(pair, pairUserData);
+
+    pthread_mutex_lock(&mutex);
+    giveBackBuffer(item.left);
+    giveBackBuffer(item.right);
+    stat.deliveredPairs++;
+  }
+  pthread_mutex_unlock(&mutex);
+}
@@ -8,30 +8,179 @@
 
 #ifndef ADVANCED_SENSING_DJI_CAMERA_IMAGE_HPP
 #define ADVANCED_SENSING_DJI_CAMERA_IMAGE_HPP
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
+/*! @brief Pixel layouts the decoder can output for the camera stream
+ */
+enum CameraImageFormat
+{
+  CAMERA_IMAGE_RGB24   = 0, /*!< packed RGB, 3 bytes per pixel (default) */
+  CAMERA_IMAGE_BGR24   = 1, /*!< packed BGR, 3 bytes per pixel, OpenCV order */
+  CAMERA_IMAGE_GRAY8   = 2, /*!< luma only, 1 byte per pixel */
+  CAMERA_IMAGE_NV12    = 3, /*!< Y plane followed by interleaved UV plane */
+  CAMERA_IMAGE_YUV420P = 4  /*!< Y, U and V planes, as produced by the decoder */
+};
+
+/*! @brief Output settings of the decoded images of one camera stream
+ *  @note width and height set to 0 keep the stream resolution. If only
+ *        one of them is set, the other one follows the stream aspect ratio.
+ *        A set size is at least 2, and even for NV12 and YUV420P.
+ *        Scaling is done in the same pass as the pixel format conversion.
+ */
+typedef struct CameraImageOutputConfig
+{
+  CameraImageFormat format;
+  int               width;
+  int               height;
+} CameraImageOutputConfig;
+
+/*! @brief Counters of the decoded image ring of one camera stream, used to
+ *  tell whether the consumer keeps up with the decoder.
+ */
+typedef struct CameraImageRingStat
+{
+  uint64_t writtenFrames;     /*!< frames committed by the decoder */
+  uint64_t consumedFrames;    /*!< frames borrowed or copied out by consumers */
+  uint64_t overwrittenFrames; /*!< ready frames replaced before being read */
+  uint64_t droppedFrames;     /*!< frames discarded because all slots were borrowed */
+} CameraImageRingStat;
+
+/*! @brief Counters of the decoding pipeline of one camera stream: the
+ *  reading thread queues raw chunks for a decode thread, which queues
+ *  decoded frames for a colour conversion thread.
+ */
+typedef struct DecoderPipelineStat
+{
+  uint64_t receivedChunks; /*!< raw stream chunks handed to the decoder */
+  uint64_t droppedChunks;  /*!< chunks discarded because the decoder is behind */
+  uint64_t decodedFrames;  /*!< frames out of avcodec_receive_frame */
+  uint64_t droppedFrames;  /*!< decoded frames discarded because conversion is behind */
+} DecoderPipelineStat;
+
 /*! @brief Data structure for the image frames from the
  *         FPV camera or main camera
  */
 struct CameraRGBImage
 {
-  // rawData.size should be height x width x 3 x sizeof(char)
+  // rawData.size should be height x width x 3 x sizeof(char) for RGB24/BGR24,
+  // height x width for GRAY8 and height x width x 3 / 2 for NV12/YUV420P
   std::vector<uint8_t> rawData;
   int height;
   int width;
+  CameraImageFormat format;
+};
+
+class DJICameraImageHandler;
+struct CameraImageSlot;
+
+/*! @brief Move-only handle to a decoded frame that stays in the decoder's
+ *         frame pool. The pixels are not copied; the pool slot is reserved
+ *         until release() is called or the handle is destroyed.
+ *  @note  The decoder drops new frames while every pool slot is held, so
+ *         handles should be released as soon as the frame is processed.
+ */
+class CameraImageFrame
+{
+public:
+  CameraImageFrame();
+  CameraImageFrame(DJICameraImageHandler* handler, CameraImageSlot* slot);
+  CameraImageFrame(CameraImageFrame&& other);
+  CameraImageFrame& operator=(CameraImageFrame&& other);
+  ~CameraImageFrame();
+
+  CameraImageFrame(const CameraImageFrame&) = delete;
+  CameraImageFrame& operator=(const CameraImageFrame&) = delete;
+
+  /*! @return true if the handle refers to a frame */
+  bool valid() const;
+
+  /*! @brief Read-only view of the frame, only valid while the handle is */
+  const CameraRGBImage& image() const;
+
+  const uint8_t* data() const;
+  size_t         size() const;
+  int            width() const;
+  int            height() const;
+
+  /*! @brief Pixel layout of data(), as set by the output config */
+  CameraImageFormat format() const;
+
+  /*! @brief Increasing number given by the decoder to each frame */
+  uint64_t sequence() const;
+
+  /*! @brief Give the frame back to the pool, the handle becomes invalid */
+  void release();
+
+private:
+  DJICameraImageHandler* handler;
+  CameraImageSlot*       slot;
 };
 
 /*! @brief User callback function called by OSDK (in a dedicated thread)
  *  when a new image frame from camera is received.
+ *  @note The image is copied for every call, prefer CameraImageFrameCallback.
  */
 typedef void (*CameraImageCallback)(CameraRGBImage pImg, void* userData);
 
+/*! @brief User callback function called by OSDK (in a dedicated thread)
+ *  when a new image frame from camera is received, without copying it.
+ *  The frame is released when the callback returns, unless the user moves
+ *  it into a CameraImageFrame of their own to keep it longer.
+ */
+typedef void (*CameraImageFrameCallback)(CameraImageFrame& frame, void* userData);
+
 /*! @brief User callback function called by OSDK (in a dedicated thread)
  *  when a H264 frame is received.
  */
 typedef void (*H264Callback)(uint8_t* buf, int bufLen, void* userData);
 
+/*! @brief Content flags of a reassembled H264 access unit
+ */
+enum H264AccessUnitFlag
+{
+  H264_AU_FLAG_IDR = 1 << 0, /*!< contains an IDR slice */
+  H264_AU_FLAG_SPS = 1 << 1, /*!< contains a sequence parameter set */
+  H264_AU_FLAG_PPS = 1 << 2  /*!< contains a picture parameter set */
+};
+
+struct H264AccessUnitBuffer;
+
+/*! @brief One complete H264 access unit (one coded picture) of the stream
+ */
+typedef struct H264AccessUnit
+{
+  const uint8_t*        data;       /*!< Annex-B bytes, start codes included */
+  int                   dataLen;
+  uint32_t              flags;      /*!< H264AccessUnitFlag bits */
+  uint64_t              recvTimeUs; /*!< CLOCK_MONOTONIC time its first byte arrived */
+  uint32_t              sequence;   /*!< access unit counter, gaps mean dropped units */
+  H264AccessUnitBuffer* buffer;     /*!< pooled buffer holding data */
+} H264AccessUnit;
+
+/*! @brief User callback function called by OSDK (in a dedicated thread)
+ *  when a complete H264 access unit is received.
+ *  @note au->data lives in a pooled buffer that goes back to the pool when
+ *  the callback returns. To keep or forward the unit without copying it,
+ *  copy the H264AccessUnit itself, call H264AccessUnitRetain in the callback
+ *  and H264AccessUnitRelease once done with it.
+ *  @note The end of a unit is only seen when the first NAL of the next one
+ *  arrives. Unless the encoder sends an access unit delimiter right after
+ *  each picture, every unit is delivered about one frame interval late.
+ */
+typedef void (*H264AccessUnitCallback)(const H264AccessUnit* au, void* userData);
+
+/*! @brief Keep the buffer of au after the callback returns.
+ *  While buffers are kept, the pool has fewer to reassemble into, units that
+ *  find no free buffer are dropped and show up as a sequence gap.
+ */
+void H264AccessUnitRetain(const H264AccessUnit* au);
+
+/*! @brief Give back a buffer kept with H264AccessUnitRetain
+ */
+void H264AccessUnitRelease(const H264AccessUnit* au);
+
 /*! @brief Data structure for the image frames from the
  *         FPV camera or main camera
  */
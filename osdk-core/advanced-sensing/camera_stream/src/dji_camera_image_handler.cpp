@@ -24,11 +24,19 @@
  */
 
 #include "dji_camera_image_handler.hpp"
+#include <cstring>
+#include <ctime>
+#include <cerrno>
 
-DJICameraImageHandler::DJICameraImageHandler():m_newImageFlag(false)
+DJICameraImageHandler::DJICameraImageHandler(int ringSize)
+  : m_readyHead(0),
+    m_readyCount(0),
+    m_seq(0)
 {
   pthread_mutex_init(&m_mutex, NULL);
   pthread_cond_init(&m_condv, NULL);
+  resetRingStat();
+  setRingSize(ringSize);
 }
 
 DJICameraImageHandler::~DJICameraImageHandler()
@@ -37,56 +45,385 @@ DJICameraImageHandler::~DJICameraImageHandler()
   pthread_cond_destroy(&m_condv);
 }
 
-bool DJICameraImageHandler::getNewImageWithLock(CameraRGBImage & copyOfImage, int timeoutMilliSec)
+bool DJICameraImageHandler::setRingSize(int ringSize)
+{
+  if (ringSize < 1)
+  {
+    return false;
+  }
+
+  pthread_mutex_lock(&m_mutex);
+  for (size_t i = 0; i < m_slots.size(); ++i)
+  {
+    if (m_slots[i].state == CameraImageSlot::SLOT_WRITING ||
+        m_slots[i].state == CameraImageSlot::SLOT_BORROWED)
+    {
+      pthread_mutex_unlock(&m_mutex);
+      return false;
+    }
+  }
+
+  m_slots.resize(ringSize);
+  for (size_t i = 0; i < m_slots.size(); ++i)
+  {
+    m_slots[i].image.height = 0;
+    m_slots[i].image.width  = 0;
+    m_slots[i].image.format = CAMERA_IMAGE_RGB24;
+    m_slots[i].seq          = 0;
+    m_slots[i].refCount     = 0;
+    m_slots[i].state        = CameraImageSlot::SLOT_FREE;
+  }
+  m_readyQueue.assign(ringSize, NULL);
+  m_readyHead  = 0;
+  m_readyCount = 0;
+  pthread_mutex_unlock(&m_mutex);
+  return true;
+}
+
+int DJICameraImageHandler::getRingSize()
+{
+  pthread_mutex_lock(&m_mutex);
+  int ringSize = (int)m_slots.size();
+  pthread_mutex_unlock(&m_mutex);
+  return ringSize;
+}
+
+CameraImageSlot* DJICameraImageHandler::findFreeSlot()
+{
+  for (size_t i = 0; i < m_slots.size(); ++i)
+  {
+    if (m_slots[i].state == CameraImageSlot::SLOT_FREE)
+    {
+      return &m_slots[i];
+    }
+  }
+  return NULL;
+}
+
+CameraImageSlot* DJICameraImageHandler::popReadySlot()
+{
+  if (m_readyCount == 0)
+  {
+    return NULL;
+  }
+  CameraImageSlot* slot = m_readyQueue[m_readyHead];
+  m_readyQueue[m_readyHead] = NULL;
+  m_readyHead = (m_readyHead + 1) % (int)m_readyQueue.size();
+  m_readyCount--;
+  return slot;
+}
+
+CameraImageSlot* DJICameraImageHandler::popNewestReadySlot()
 {
-  int result = -1;
+  CameraImageSlot* slot = popReadySlot();
+  while (NULL != slot && m_readyCount > 0)
+  {
+    slot->state = CameraImageSlot::SLOT_FREE;
+    m_stat.overwrittenFrames++;
+    slot = popReadySlot();
+  }
+  return slot;
+}
+
+CameraImageSlot* DJICameraImageHandler::acquireWriteSlot(int bufSize)
+{
+  if (bufSize <= 0)
+  {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&m_mutex);
+  CameraImageSlot* slot = findFreeSlot();
+  if (NULL == slot)
+  {
+    /* No free slot: replace the oldest frame nobody has read yet */
+    slot = popReadySlot();
+    if (NULL != slot)
+    {
+      m_stat.overwrittenFrames++;
+    }
+  }
+
+  if (NULL == slot)
+  {
+    /* Every slot is being written or held by a consumer */
+    m_stat.droppedFrames++;
+    pthread_mutex_unlock(&m_mutex);
+    return NULL;
+  }
+  slot->state = CameraImageSlot::SLOT_WRITING;
+  pthread_mutex_unlock(&m_mutex);
+
+  /* Only this thread owns the slot now, so it can be resized without lock */
+  slot->image.rawData.resize(bufSize);
+  return slot;
+}
+
+void DJICameraImageHandler::commitWriteSlot(CameraImageSlot* slot, int width, int height,
+                                            CameraImageFormat format)
+{
+  if (NULL == slot)
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&m_mutex);
+  slot->image.width  = width;
+  slot->image.height = height;
+  slot->image.format = format;
+  slot->seq          = ++m_seq;
+  slot->state        = CameraImageSlot::SLOT_READY;
+
+  int tail = (m_readyHead + m_readyCount) % (int)m_readyQueue.size();
+  m_readyQueue[tail] = slot;
+  m_readyCount++;
+  m_stat.writtenFrames++;
+
+  pthread_cond_signal(&m_condv);
+  pthread_mutex_unlock(&m_mutex);
+}
+
+void DJICameraImageHandler::abortWriteSlot(CameraImageSlot* slot)
+{
+  if (NULL == slot)
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&m_mutex);
+  slot->state = CameraImageSlot::SLOT_FREE;
+  pthread_mutex_unlock(&m_mutex);
+}
+
+bool DJICameraImageHandler::waitForReadyImage(int timeoutMilliSec)
+{
+  if (m_readyCount > 0)
+  {
+    return true;
+  }
+
+  struct timespec absTimeout;
+  clock_gettime(CLOCK_REALTIME, &absTimeout);
+  absTimeout.tv_sec  += timeoutMilliSec / 1000;
+  absTimeout.tv_nsec += (long)(timeoutMilliSec % 1000) * 1000000L;
+  if (absTimeout.tv_nsec >= 1000000000L)
+  {
+    absTimeout.tv_sec  += 1;
+    absTimeout.tv_nsec -= 1000000000L;
+  }
 
   /*! @note
    * Here result == 0 means successful.
    * Because this is the behavior of pthread_cond_timedwait.
    */
+  int result = 0;
+  while (m_readyCount == 0 && result != ETIMEDOUT)
+  {
+    result = pthread_cond_timedwait(&m_condv, &m_mutex, &absTimeout);
+  }
+  return (m_readyCount > 0);
+}
+
+CameraImageSlot* DJICameraImageHandler::borrowNewImageWithLock(int timeoutMilliSec)
+{
+  CameraImageSlot* slot = NULL;
+
   pthread_mutex_lock(&m_mutex);
-  if(m_newImageFlag)
+  if (waitForReadyImage(timeoutMilliSec))
   {
-    /* At this point, a copy of m_img is made, so it is safe to 
-     * do any modifications to copyOfImage in user code.
-     */
-    copyOfImage = m_img;
-    m_newImageFlag = false;
-    result = 0;
+    slot = popReadySlot();
+    slot->state    = CameraImageSlot::SLOT_BORROWED;
+    slot->refCount = 1;
+    m_stat.consumedFrames++;
   }
-  else
+  pthread_mutex_unlock(&m_mutex);
+  return slot;
+}
+
+void DJICameraImageHandler::retainImage(CameraImageSlot* slot)
+{
+  if (NULL == slot)
   {
-    struct timespec absTimeout;
-    clock_gettime(CLOCK_REALTIME, &absTimeout);
-    absTimeout.tv_nsec += timeoutMilliSec * 1e6;
-    result = pthread_cond_timedwait(&m_condv, &m_mutex, &absTimeout);
+    return;
+  }
 
-    if(result == 0)
-    {
-      copyOfImage = m_img;
-      m_newImageFlag = false;
-    }
+  pthread_mutex_lock(&m_mutex);
+  slot->refCount++;
+  pthread_mutex_unlock(&m_mutex);
+}
+
+void DJICameraImageHandler::releaseImage(CameraImageSlot* slot)
+{
+  if (NULL == slot)
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&m_mutex);
+  if (slot->refCount > 0 && --slot->refCount == 0)
+  {
+    slot->state = CameraImageSlot::SLOT_FREE;
   }
   pthread_mutex_unlock(&m_mutex);
-  return (result == 0) ? true : false;
+}
+
+bool DJICameraImageHandler::getNewImageWithLock(CameraRGBImage & copyOfImage, int timeoutMilliSec)
+{
+  CameraImageSlot* slot = NULL;
+
+  pthread_mutex_lock(&m_mutex);
+  if (waitForReadyImage(timeoutMilliSec))
+  {
+    slot = popNewestReadySlot();
+    slot->state    = CameraImageSlot::SLOT_BORROWED;
+    slot->refCount = 1;
+    m_stat.consumedFrames++;
+  }
+  pthread_mutex_unlock(&m_mutex);
+  if (NULL == slot)
+  {
+    return false;
+  }
+
+  /* At this point, a copy of the slot is made, so it is safe to
+   * do any modifications to copyOfImage in user code.
+   */
+  copyOfImage = slot->image;
+  releaseImage(slot);
+  return true;
+}
+
+bool DJICameraImageHandler::getNewImageFrame(CameraImageFrame & frame, int timeoutMilliSec)
+{
+  CameraImageSlot* slot = borrowNewImageWithLock(timeoutMilliSec);
+  if (NULL == slot)
+  {
+    return false;
+  }
+
+  frame = CameraImageFrame(this, slot);
+  return true;
 }
 
 bool DJICameraImageHandler::newImageIsReady()
 {
-  return m_newImageFlag;
+  pthread_mutex_lock(&m_mutex);
+  bool ready = (m_readyCount > 0);
+  pthread_mutex_unlock(&m_mutex);
+  return ready;
 }
 
 void DJICameraImageHandler::writeNewImageWithLock(uint8_t* buf, int bufSize, int width, int height)
 {
-  pthread_mutex_lock(&m_mutex);
+  CameraImageSlot* slot = acquireWriteSlot(bufSize);
+  if (NULL == slot)
+  {
+    return;
+  }
 
-  m_img.rawData.assign(buf, buf+bufSize);
-  m_img.height = height;
-  m_img.width  = width;
-  m_newImageFlag = true;
+  memcpy(slot->image.rawData.data(), buf, bufSize);
+  commitWriteSlot(slot, width, height);
+}
 
-  pthread_cond_signal(&m_condv);
+CameraImageRingStat DJICameraImageHandler::getRingStat()
+{
+  pthread_mutex_lock(&m_mutex);
+  CameraImageRingStat stat = m_stat;
+  pthread_mutex_unlock(&m_mutex);
+  return stat;
+}
+
+void DJICameraImageHandler::resetRingStat()
+{
+  pthread_mutex_lock(&m_mutex);
+  memset(&m_stat, 0, sizeof(m_stat));
   pthread_mutex_unlock(&m_mutex);
 }
 
+CameraImageFrame::CameraImageFrame()
+  : handler(NULL),
+    slot(NULL)
+{
+}
+
+CameraImageFrame::CameraImageFrame(DJICameraImageHandler* handler, CameraImageSlot* slot)
+  : handler(handler),
+    slot(slot)
+{
+}
+
+CameraImageFrame::CameraImageFrame(CameraImageFrame&& other)
+  : handler(other.handler),
+    slot(other.slot)
+{
+  other.handler = NULL;
+  other.slot    = NULL;
+}
+
+CameraImageFrame& CameraImageFrame::operator=(CameraImageFrame&& other)
+{
+  if (this != &other)
+  {
+    release();
+    handler       = other.handler;
+    slot          = other.slot;
+    other.handler = NULL;
+    other.slot    = NULL;
+  }
+  return *this;
+}
+
+CameraImageFrame::~CameraImageFrame()
+{
+  release();
+}
+
+bool CameraImageFrame::valid() const
+{
+  return (NULL != slot);
+}
+
+const CameraRGBImage& CameraImageFrame::image() const
+{
+  return slot->image;
+}
+
+const uint8_t* CameraImageFrame::data() const
+{
+  return slot ? slot->image.rawData.data() : NULL;
+}
+
+size_t CameraImageFrame::size() const
+{
+  return slot ? slot->image.rawData.size() : 0;
+}
+
+int CameraImageFrame::width() const
+{
+  return slot ? slot->image.width : 0;
+}
+
+int CameraImageFrame::height() const
+{
+  return slot ? slot->image.height : 0;
+}
+
+CameraImageFormat CameraImageFrame::format() const
+{
+  return slot ? slot->image.format : CAMERA_IMAGE_RGB24;
+}
+
+uint64_t CameraImageFrame::sequence() const
+{
+  return slot ? slot->seq : 0;
+}
+
+void CameraImageFrame::release()
+{
+  if (handler && slot)
+  {
+    handler->releaseImage(slot);
+  }
+  handler = NULL;
+  slot    = NULL;
+}
@@ -12,25 +12,85 @@
 #ifndef DJICAMERAIMAGEHANDLER_HH
 #define DJICAMERAIMAGEHANDLER_HH
 
+#include <vector>
 #include "pthread.h"
 #include "dji_camera_image.hpp"
 
+/*! @brief One pooled frame buffer of the image ring.
+ *  The decoder writes into image.rawData directly and consumers borrow
+ *  the slot instead of copying it. The capacity of rawData is kept
+ *  between frames, so no allocation happens once the ring is warmed up.
+ */
+struct CameraImageSlot
+{
+  enum State
+  {
+    SLOT_FREE     = 0,
+    SLOT_WRITING  = 1,
+    SLOT_READY    = 2,
+    SLOT_BORROWED = 3
+  };
+
+  CameraRGBImage image;
+  uint64_t       seq;
+  int            refCount;
+  State          state;
+};
+
 class DJICameraImageHandler
 {
 public:
-  DJICameraImageHandler();
+  static const int DEFAULT_RING_SIZE = 4;
+
+  DJICameraImageHandler(int ringSize = DEFAULT_RING_SIZE);
   ~DJICameraImageHandler();
 
   bool newImageIsReady();
 
+  /*! Change the number of slots, only succeeds when no slot is in use */
+  bool setRingSize(int ringSize);
+  int  getRingSize();
+
+  /* Producer side: get an unused slot big enough for bufSize bytes, fill
+   * it outside the lock, then commit it (or abort on decode failure).
+   */
+  CameraImageSlot* acquireWriteSlot(int bufSize);
+  void commitWriteSlot(CameraImageSlot* slot, int width, int height,
+                       CameraImageFormat format = CAMERA_IMAGE_RGB24);
+  void abortWriteSlot(CameraImageSlot* slot);
+
+  /* Consumer side: borrow the oldest ready frame without copying it.
+   * Every borrowed or retained slot must be given back by releaseImage.
+   */
+  CameraImageSlot* borrowNewImageWithLock(int timeoutMilliSec);
+  void retainImage(CameraImageSlot* slot);
+  void releaseImage(CameraImageSlot* slot);
+
   void writeNewImageWithLock(uint8_t* buf, int bufSize, int width, int height);
+  /* Copy out the newest ready frame, the older ones are skipped and counted
+   * as overwritten, so a slow poller never falls behind the stream.
+   */
   bool getNewImageWithLock(CameraRGBImage & copyOfImage, int timeoutMilliSec);
+  bool getNewImageFrame(CameraImageFrame & frame, int timeoutMilliSec);
+
+  CameraImageRingStat getRingStat();
+  void resetRingStat();
 
 private:
+  CameraImageSlot* findFreeSlot();
+  CameraImageSlot* popReadySlot();
+  CameraImageSlot* popNewestReadySlot();
+  bool waitForReadyImage(int timeoutMilliSec);
+
   pthread_mutex_t m_mutex;
   pthread_cond_t  m_condv;
-  CameraRGBImage  m_img;
-  bool            m_newImageFlag;
+
+  std::vector<CameraImageSlot>  m_slots;
+  std::vector<CameraImageSlot*> m_readyQueue; /* FIFO of ready slots, oldest at m_readyHead */
+  int                           m_readyHead;
+  int                           m_readyCount;
+  uint64_t                      m_seq;
+  CameraImageRingStat           m_stat;
 };
 
 #endif
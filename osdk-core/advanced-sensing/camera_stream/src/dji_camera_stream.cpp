@@ -29,10 +29,16 @@
 
 #include "dji_log.hpp"
 
-void decodeStream(void* cbParam, uint8_t* buf, int len)
+void decodeStreamSpans(void* cbParam, const CameraStreamSpan* spans, int num)
 {
   DJICameraStreamDecoder *d = reinterpret_cast<DJICameraStreamDecoder*>(cbParam);
-  d->decodeBuffer(buf, len);
+  d->decodeSpans(spans, num);
+}
+
+uint64_t decodedStreamBytes(void* cbParam)
+{
+  DJICameraStreamDecoder *d = reinterpret_cast<DJICameraStreamDecoder*>(cbParam);
+  return d->getConsumedBytes();
 }
 
 DJICameraStream::DJICameraStream(CameraType camType) :
@@ -56,7 +62,7 @@ DJICameraStream::~DJICameraStream()
   }
 }
 
-bool DJICameraStream::startCameraStream(CameraImageCallback cb, void* cbParam)
+bool DJICameraStream::startDecodingStream()
 {
   if(!rawDataStream->init())
   {
@@ -71,17 +77,28 @@ bool DJICameraStream::startCameraStream(CameraImageCallback cb, void* cbParam)
   }
 
   /*!
-   * 1. Register callback (decoding) when raw data is received.
+   * 1. Register callback (decoding) when raw data is received, the data is
+   *    parsed in place in the UDT buffer.
    * 2. Start udt thread: it'll start read raw data and call decoding function
    * 3. Register decoder callback by user. It'll start callback thread.
    */
-  rawDataStream->registerCallback(&decodeStream, decoder);
+  rawDataStream->registerSpanCallback(&decodeStreamSpans, &decodedStreamBytes, decoder);
 
   if(!rawDataStream->start())
   {
     return false;
   }
 
+  return true;
+}
+
+bool DJICameraStream::startCameraStream(CameraImageCallback cb, void* cbParam)
+{
+  if(!startDecodingStream())
+  {
+    return false;
+  }
+
   /*! 
    * Callback registered by user.
    * Run when a new image is available.
@@ -94,11 +111,31 @@ bool DJICameraStream::startCameraStream(CameraImageCallback cb, void* cbParam)
   return true;
 }
 
+bool DJICameraStream::startCameraFrameStream(CameraImageFrameCallback cb, void* cbParam)
+{
+  if(!startDecodingStream())
+  {
+    return false;
+  }
+
+  /*!
+   * Callback registered by user.
+   * Run when a new image is available, the frame is lent without copy.
+   */
+  if(!decoder->registerFrameCallback(cb, cbParam))
+  {
+    return false;
+  }
+
+  return true;
+}
+
 void DJICameraStream::stopCameraStream()
 {
   decoder->registerCallback(NULL, NULL);
   rawDataStream->registerCallback(NULL, NULL);
   rawDataStream->cleanup();
+  rawDataStream->registerSpanCallback(NULL, NULL, NULL);
   decoder->cleanup();
 }
 
@@ -107,6 +144,31 @@ bool DJICameraStream::getCurrentImage(CameraRGBImage& copyOfImage)
   return decoder->decodedImageHandler.getNewImageWithLock(copyOfImage, 20);
 }
 
+bool DJICameraStream::getCurrentImageFrame(CameraImageFrame& frame)
+{
+  return decoder->getNewImageFrame(frame, 20);
+}
+
+bool DJICameraStream::setImageOutputConfig(const CameraImageOutputConfig& config)
+{
+  return decoder->setOutputConfig(config);
+}
+
+bool DJICameraStream::setImageRingSize(int ringSize)
+{
+  return decoder->decodedImageHandler.setRingSize(ringSize);
+}
+
+CameraImageRingStat DJICameraStream::getImageRingStat()
+{
+  return decoder->decodedImageHandler.getRingStat();
+}
+
+DecoderPipelineStat DJICameraStream::getDecoderStat()
+{
+  return decoder->getPipelineStat();
+}
+
 bool DJICameraStream::newImageIsReady()
 {
   return decoder->decodedImageHandler.newImageIsReady();
@@ -156,6 +218,7 @@ void DJICameraStream::stopCameraH264()
   decoder->registerCallback(NULL, NULL);
   rawDataStream->registerCallback(NULL, NULL);
   rawDataStream->cleanup();
+  rawDataStream->registerSpanCallback(NULL, NULL, NULL);
   decoder->cleanup();
 }
 
@@ -30,8 +30,24 @@ public:
 
   bool getCurrentImage(CameraRGBImage& copyOfImage);
 
+  bool getCurrentImageFrame(CameraImageFrame& frame);
+
+  bool setImageOutputConfig(const CameraImageOutputConfig& config);
+
+  /*!
+   * @param ringSize: number of decoded frames kept for the consumers,
+   *        only changed while no frame is being written or borrowed
+   */
+  bool setImageRingSize(int ringSize);
+
+  CameraImageRingStat getImageRingStat();
+
+  DecoderPipelineStat getDecoderStat();
+
   bool startCameraStream(CameraImageCallback cb = NULL, void * cbParam = NULL);
 
+  bool startCameraFrameStream(CameraImageFrameCallback cb, void * cbParam = NULL);
+
   void stopCameraStream();
 
   bool startCameraH264(H264Callback cb = NULL, void * cbParam = NULL);
@@ -39,6 +55,8 @@ public:
   void stopCameraH264();
 
 private:
+  bool startDecodingStream();
+
   DJICameraStreamLink     *rawDataStream;
   DJICameraStreamDecoder  *decoder;
 
@@ -26,6 +26,9 @@
 #include "dji_camera_stream_decoder.hpp"
 #include "dji_log.hpp"
 #include "unistd.h"
+#include <algorithm>
+#include <cstring>
+#include <sched.h>
 #include "pthread.h"
 
 DJICameraStreamDecoder::DJICameraStreamDecoder()
@@ -33,28 +36,53 @@ DJICameraStreamDecoder::DJICameraStreamDecoder()
     cbThreadIsRunning(false),
     cbThreadStatus(-1),
     cb(NULL),
+    frameCb(NULL),
     cbUserParam(NULL),
+    chunkPool(STREAM_CHUNK_NUM),
+    freeChunks(STREAM_CHUNK_NUM),
+    readyChunks(STREAM_CHUNK_NUM),
+    framePool(DECODED_FRAME_NUM, (AVFrame*)NULL),
+    freeFrames(DECODED_FRAME_NUM),
+    readyFrames(DECODED_FRAME_NUM),
+    pipelineIsRunning(false),
+    producers(0),
+    receivedChunks(0),
+    droppedChunks(0),
+    decodedFrames(0),
+    droppedFrames(0),
+    consumedBytes(0),
     pCodecCtx(NULL),
     pCodec(NULL),
     pCodecParserCtx(NULL),
     pSwsCtx(NULL),
+    pPacket(NULL),
     pFrameYUV(NULL),
-    pFrameRGB(NULL),
-    rgbBuf(NULL),
+    pFrameOut(NULL),
+    pendingFrame(NULL),
     bufSize(0)
 {
+  outputConfig.format = CAMERA_IMAGE_RGB24;
+  outputConfig.width  = 0;
+  outputConfig.height = 0;
+  for (size_t i = 0; i < chunkPool.size(); ++i)
+  {
+    chunkPool[i].spans.reserve(DJICameraStreamLink::BORROW_SPAN_NUM);
+    chunkPool[i].spanLen = 0;
+  }
   pthread_mutex_init(&decodemutex, NULL);
+  sem_init(&chunkSem, 0, 0);
+  sem_init(&frameSem, 0, 0);
 }
 
 DJICameraStreamDecoder::~DJICameraStreamDecoder()
 {
-  pthread_mutex_destroy(&decodemutex);
-  if(cb)
-  {
-    registerCallback(NULL, NULL);
-  }
+  registerCallback(NULL, NULL);
 
   cleanup();
+
+  sem_destroy(&chunkSem);
+  sem_destroy(&frameSem);
+  pthread_mutex_destroy(&decodemutex);
 }
 
 bool DJICameraStreamDecoder::init()
@@ -64,52 +92,87 @@ bool DJICameraStreamDecoder::init()
   if(true == initSuccess)
   {
     DSTATUS_PRIVATE("Decoder already initialized.\n");
+    pthread_mutex_unlock(&decodemutex);
     return true;
   }
 
-  avcodec_register_all();
-  pCodecCtx = avcodec_alloc_context3(NULL);
-  if (!pCodecCtx)
+  bool ret = false;
+  do
   {
-    return false;
-  }
+    avcodec_register_all();
+    pCodecCtx = avcodec_alloc_context3(NULL);
+    if (!pCodecCtx)
+    {
+      break;
+    }
 
-  pCodecCtx->thread_count = 4;
-  pCodec = avcodec_find_decoder(AV_CODEC_ID_H264);
-  if (!pCodec || avcodec_open2(pCodecCtx, pCodec, NULL) < 0)
-  {
-    return false;
-  }
+    pCodecCtx->thread_count = 4;
+    pCodec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    if (!pCodec || avcodec_open2(pCodecCtx, pCodec, NULL) < 0)
+    {
+      break;
+    }
 
-  pCodecParserCtx = av_parser_init(AV_CODEC_ID_H264);
-  if (!pCodecParserCtx)
-  {
-    return false;
-  }
+    pCodecParserCtx = av_parser_init(AV_CODEC_ID_H264);
+    if (!pCodecParserCtx)
+    {
+      break;
+    }
 
-  pFrameYUV = av_frame_alloc();
-  if (!pFrameYUV)
-  {
-    return false;
-  }
+    pPacket = av_packet_alloc();
+    if (!pPacket)
+    {
+      break;
+    }
 
-  pFrameRGB = av_frame_alloc();
-  if (!pFrameRGB)
-  {
-    return false;
-  }
+    pFrameYUV = av_frame_alloc();
+    if (!pFrameYUV)
+    {
+      break;
+    }
 
-  pSwsCtx = NULL;
+    pFrameOut = av_frame_alloc();
+    if (!pFrameOut)
+    {
+      break;
+    }
+
+    bool framePoolReady = true;
+    for (size_t i = 0; i < framePool.size(); ++i)
+    {
+      framePool[i] = av_frame_alloc();
+      framePoolReady = framePoolReady && (NULL != framePool[i]);
+    }
+    if (!framePoolReady)
+    {
+      break;
+    }
+
+    pSwsCtx = NULL;
+
+    DSTATUS_PRIVATE("All components for decoding initialized ...\n");
+    DDEBUG_PRIVATE("Decoder Version = %d\n", avcodec_version());
 
-  DSTATUS_PRIVATE("All components for decoding initialized ...\n");
-  DDEBUG_PRIVATE("Decoder Version = %d\n", avcodec_version());
+    pCodecCtx->flags2 |= AV_CODEC_FLAG2_SHOW_ALL;
 
-  pCodecCtx->flags2 |= AV_CODEC_FLAG2_SHOW_ALL;
-  initSuccess = true;
+    if (!startPipeline())
+    {
+      break;
+    }
+
+    initSuccess = true;
+    ret = true;
+  } while (0);
 
   pthread_mutex_unlock(&decodemutex);
 
-  return true;
+  if (!ret)
+  {
+    DERROR_PRIVATE("Decoder initialization failed!\n");
+    cleanup();
+  }
+
+  return ret;
 }
 
 bool DJICameraStreamDecoder::getNewImage(CameraRGBImage & copyOfImage, int timeoutMilliSec)
@@ -117,11 +180,28 @@ bool DJICameraStreamDecoder::getNewImage(CameraRGBImage & copyOfImage, int timeo
   return decodedImageHandler.getNewImageWithLock(copyOfImage, timeoutMilliSec);
 }
 
+bool DJICameraStreamDecoder::getNewImageFrame(CameraImageFrame & frame, int timeoutMilliSec)
+{
+  return decodedImageHandler.getNewImageFrame(frame, timeoutMilliSec);
+}
+
 void DJICameraStreamDecoder::cleanup()
 {
+  /* Stop accepting stream data first and wait for a producer already
+   * past the check, then let the pipeline threads finish without holding
+   * decodemutex, as the convert thread takes it.
+   */
   pthread_mutex_lock(&decodemutex);
-
   initSuccess = false;
+  pthread_mutex_unlock(&decodemutex);
+  while (producers > 0)
+  {
+    sched_yield();
+  }
+
+  stopPipeline();
+
+  pthread_mutex_lock(&decodemutex);
   if (NULL != pSwsCtx)
   {
     sws_freeContext(pSwsCtx);
@@ -130,8 +210,21 @@ void DJICameraStreamDecoder::cleanup()
 
   if (NULL != pFrameYUV)
   {
-    av_free(pFrameYUV);
-    pFrameYUV = NULL;
+    av_frame_free(&pFrameYUV);
+  }
+
+  for (size_t i = 0; i < framePool.size(); ++i)
+  {
+    if (NULL != framePool[i])
+    {
+      av_frame_free(&framePool[i]);
+    }
+  }
+  pendingFrame = NULL;
+
+  if (NULL != pPacket)
+  {
+    av_packet_free(&pPacket);
   }
 
   if (NULL != pCodecParserCtx)
@@ -152,19 +245,228 @@ void DJICameraStreamDecoder::cleanup()
     pCodecCtx = NULL;
   }
 
-  if (NULL != rgbBuf )
+  if (NULL != pFrameOut)
+  {
+    av_free(pFrameOut);
+    pFrameOut = NULL;
+  }
+
+  pthread_mutex_unlock(&decodemutex);
+}
+
+bool DJICameraStreamDecoder::startPipeline()
+{
+  /* No pipeline thread and no producer is running at this point, so the
+   * queues can be refilled from this thread.
+   */
+  StreamChunk* chunk = NULL;
+  while (readyChunks.pop(chunk));
+  while (freeChunks.pop(chunk));
+  for (size_t i = 0; i < chunkPool.size(); ++i)
   {
-    av_free(rgbBuf);
-    rgbBuf = NULL;
+    freeChunks.push(&chunkPool[i]);
   }
 
-  if (NULL != pFrameRGB)
+  AVFrame* frame = NULL;
+  while (readyFrames.pop(frame));
+  while (freeFrames.pop(frame));
+  for (size_t i = 0; i < framePool.size(); ++i)
   {
-    av_free(pFrameRGB);
-    pFrameRGB = NULL;
+    freeFrames.push(framePool[i]);
   }
+  pendingFrame = NULL;
 
-  pthread_mutex_unlock(&decodemutex);
+  while (0 == sem_trywait(&chunkSem));
+  while (0 == sem_trywait(&frameSem));
+
+  pipelineIsRunning = true;
+  if (0 != pthread_create(&decodeThread, NULL, decodeThreadEntry, this))
+  {
+    DERROR_PRIVATE("Decode thread creation failed!\n");
+    pipelineIsRunning = false;
+    return false;
+  }
+
+  if (0 != pthread_create(&convertThread, NULL, convertThreadEntry, this))
+  {
+    DERROR_PRIVATE("Convert thread creation failed!\n");
+    pipelineIsRunning = false;
+    sem_post(&chunkSem);
+    pthread_join(decodeThread, NULL);
+    return false;
+  }
+
+  return true;
+}
+
+void DJICameraStreamDecoder::stopPipeline()
+{
+  if (!pipelineIsRunning)
+  {
+    return;
+  }
+
+  pipelineIsRunning = false;
+  sem_post(&chunkSem);
+  sem_post(&frameSem);
+  pthread_join(decodeThread, NULL);
+  pthread_join(convertThread, NULL);
+
+  /* Borrowed spans left behind will never be parsed, hand them back */
+  StreamChunk* chunk = NULL;
+  while (readyChunks.pop(chunk))
+  {
+    releaseChunk(chunk);
+    freeChunks.push(chunk);
+  }
+}
+
+void* DJICameraStreamDecoder::decodeThreadEntry(void* p)
+{
+  static_cast<DJICameraStreamDecoder*>(p)->decodeThreadFunc();
+  return NULL;
+}
+
+void* DJICameraStreamDecoder::convertThreadEntry(void* p)
+{
+  static_cast<DJICameraStreamDecoder*>(p)->convertThreadFunc();
+  return NULL;
+}
+
+void DJICameraStreamDecoder::decodeThreadFunc()
+{
+  DSTATUS_PRIVATE("Decoder Decode Thread Start...\n");
+  while (pipelineIsRunning)
+  {
+    sem_wait(&chunkSem);
+
+    StreamChunk* chunk = NULL;
+    if (!readyChunks.pop(chunk))
+    {
+      continue;
+    }
+
+    decodeChunk(chunk);
+    releaseChunk(chunk);
+    freeChunks.push(chunk);
+  }
+  DSTATUS_PRIVATE("Decoder Decode Thread Stopped...\n");
+}
+
+void DJICameraStreamDecoder::decodeChunk(StreamChunk* chunk)
+{
+  if (chunk->spans.empty())
+  {
+    decodeData(chunk->data.data(), (int)chunk->data.size());
+    return;
+  }
+
+  for (size_t i = 0; i < chunk->spans.size(); ++i)
+  {
+    decodeData(chunk->spans[i].data, chunk->spans[i].len);
+  }
+}
+
+void DJICameraStreamDecoder::releaseChunk(StreamChunk* chunk)
+{
+  if (chunk->spanLen > 0)
+  {
+    consumedBytes.fetch_add(chunk->spanLen, std::memory_order_release);
+    chunk->spans.clear();
+    chunk->spanLen = 0;
+  }
+}
+
+void DJICameraStreamDecoder::decodeData(const uint8_t* pData, int len)
+{
+  int remainingLen = len;
+  int processedLen = 0;
+
+  while (remainingLen > 0)
+  {
+    processedLen = av_parser_parse2(pCodecParserCtx, pCodecCtx,
+                                    &pPacket->data, &pPacket->size,
+                                    pData, remainingLen,
+                                    AV_NOPTS_VALUE, AV_NOPTS_VALUE, AV_NOPTS_VALUE);
+    remainingLen -= processedLen;
+    pData        += processedLen;
+
+    if (pPacket->size <= 0)
+    {
+      continue;
+    }
+
+    if (avcodec_send_packet(pCodecCtx, pPacket) < 0)
+    {
+      //DSTATUS_PRIVATE("Got Frame, but no picture\n");
+      continue;
+    }
+
+    /* Drain every frame the packet produced, so send_packet never
+     * sees a full decoder on the next call.
+     */
+    while (true)
+    {
+      /* If the convert thread is behind no pooled frame is free,
+       * then decode into the scratch frame and drop it.
+       */
+      AVFrame* frame = pendingFrame;
+      if (NULL == frame)
+      {
+        freeFrames.pop(frame);
+      }
+
+      AVFrame* target = (NULL != frame) ? frame : pFrameYUV;
+      if (avcodec_receive_frame(pCodecCtx, target) < 0)
+      {
+        pendingFrame = frame;
+        break;
+      }
+
+      decodedFrames++;
+      pendingFrame = NULL;
+      if (NULL != frame)
+      {
+        readyFrames.push(frame);
+        sem_post(&frameSem);
+      }
+      else
+      {
+        av_frame_unref(pFrameYUV);
+        droppedFrames++;
+      }
+    }
+  }
+}
+
+void DJICameraStreamDecoder::convertThreadFunc()
+{
+  DSTATUS_PRIVATE("Decoder Convert Thread Start...\n");
+  while (pipelineIsRunning)
+  {
+    sem_wait(&frameSem);
+
+    AVFrame* frame = NULL;
+    if (!readyFrames.pop(frame))
+    {
+      continue;
+    }
+
+    convertFrame(frame);
+    av_frame_unref(frame);
+    freeFrames.push(frame);
+  }
+  DSTATUS_PRIVATE("Decoder Convert Thread Stopped...\n");
+}
+
+DecoderPipelineStat DJICameraStreamDecoder::getPipelineStat()
+{
+  DecoderPipelineStat stat;
+  stat.receivedChunks = receivedChunks;
+  stat.droppedChunks  = droppedChunks;
+  stat.decodedFrames  = decodedFrames;
+  stat.droppedFrames  = droppedFrames;
+  return stat;
 }
 
 void* DJICameraStreamDecoder::callbackThreadEntry(void* p)
@@ -179,16 +481,37 @@ void DJICameraStreamDecoder::callbackThreadFunc()
 {
   while(cbThreadIsRunning)
   {
-    CameraRGBImage copyOfImage;
-    if(!decodedImageHandler.getNewImageWithLock(copyOfImage, 1000))
+    CameraImageSlot* slot = decodedImageHandler.borrowNewImageWithLock(1000);
+    if(NULL == slot)
     {
       DDEBUG_PRIVATE("Decoder Callback Thread: Get image time out\n");
       continue;
     }
 
-    if(cb)
+    /* The callback and its parameter are replaced together by the
+     * register functions, so read them as one under the lock.
+     */
+    pthread_mutex_lock(&decodemutex);
+    CameraImageCallback      imageCb      = cb;
+    CameraImageFrameCallback imageFrameCb = frameCb;
+    void*                    userParam    = cbUserParam;
+    pthread_mutex_unlock(&decodemutex);
+
+    if(imageFrameCb)
     {
-      (*cb)(copyOfImage, cbUserParam);
+      /* The frame goes back to the pool when the handle is destroyed,
+       * unless the user moved it out inside the callback.
+       */
+      CameraImageFrame frame(&decodedImageHandler, slot);
+      (*imageFrameCb)(frame, userParam);
+    }
+    else
+    {
+      if(imageCb)
+      {
+        (*imageCb)(slot->image, userParam);
+      }
+      decodedImageHandler.releaseImage(slot);
     }
   }
   DSTATUS_PRIVATE("Decoder Callback Thread Stopped...\n");
@@ -196,81 +519,258 @@ void DJICameraStreamDecoder::callbackThreadFunc()
 
 void DJICameraStreamDecoder::decodeBuffer(uint8_t* buf, int bufLen)
 {
-  uint8_t* pData   = buf;
-  int remainingLen = bufLen;
-  int processedLen = 0;
+  if (bufLen <= 0)
+  {
+    return;
+  }
+
+  /* The caller is the network reading thread, so only copy the data into
+   * a free chunk here and leave parsing and decoding to the decode thread.
+   * No lock is taken: cleanup() waits for producers after clearing
+   * initSuccess, both sequentially consistent.
+   */
+  producers++;
+  if (!initSuccess)
+  {
+    producers--;
+    return;
+  }
+
+  receivedChunks++;
+  StreamChunk* chunk = NULL;
+  if (!freeChunks.pop(chunk))
+  {
+    droppedChunks++;
+    producers--;
+    return;
+  }
+
+  chunk->data.assign(buf, buf + bufLen);
+  readyChunks.push(chunk);
+  sem_post(&chunkSem);
+  producers--;
+}
+
+void DJICameraStreamDecoder::decodeSpans(const CameraStreamSpan* spans, int num)
+{
+  uint64_t len = 0;
+  for (int i = 0; i < num; ++i)
+  {
+    len += spans[i].len;
+  }
+  if (0 == len)
+  {
+    return;
+  }
+
+  producers++;
+  if (!initSuccess)
+  {
+    consumedBytes.fetch_add(len, std::memory_order_release);
+    producers--;
+    return;
+  }
+
+  receivedChunks++;
+  StreamChunk* chunk = NULL;
+  if (!freeChunks.pop(chunk))
+  {
+    droppedChunks++;
+    consumedBytes.fetch_add(len, std::memory_order_release);
+    producers--;
+    return;
+  }
+
+  chunk->data.clear();
+  chunk->spans.assign(spans, spans + num);
+  chunk->spanLen = len;
+  readyChunks.push(chunk);
+  sem_post(&chunkSem);
+  producers--;
+}
+
+uint64_t DJICameraStreamDecoder::getConsumedBytes()
+{
+  return consumedBytes.load(std::memory_order_acquire);
+}
+
+static AVPixelFormat toAVPixelFormat(CameraImageFormat format)
+{
+  switch(format)
+  {
+    case CAMERA_IMAGE_BGR24:
+      return AV_PIX_FMT_BGR24;
+    case CAMERA_IMAGE_GRAY8:
+      return AV_PIX_FMT_GRAY8;
+    case CAMERA_IMAGE_NV12:
+      return AV_PIX_FMT_NV12;
+    case CAMERA_IMAGE_YUV420P:
+      return AV_PIX_FMT_YUV420P;
+    case CAMERA_IMAGE_RGB24:
+    default:
+      return AV_PIX_FMT_RGB24;
+  }
+}
+
+void DJICameraStreamDecoder::convertFrame(AVFrame* pFrame)
+{
+  int w = pFrame->width;
+  int h = pFrame->height;
+  //DSTATUS_PRIVATE("Got picture! size=%dx%d\n", w, h);
 
-  AVPacket pkt;
-  av_init_packet(&pkt);
   pthread_mutex_lock(&decodemutex);
-  while (remainingLen > 0)
+  CameraImageOutputConfig config = outputConfig;
+  pthread_mutex_unlock(&decodemutex);
+
+  if(w <= 0 || h <= 0)
   {
-    if (!pCodecParserCtx || !pCodecCtx) {
-      //DSTATUS("Invalid decoder ctx.");
-      break;
-    }
-    processedLen = av_parser_parse2(pCodecParserCtx, pCodecCtx,
-                                    &pkt.data, &pkt.size,
-                                    pData, remainingLen,
-                                    AV_NOPTS_VALUE, AV_NOPTS_VALUE, AV_NOPTS_VALUE);
-    remainingLen -= processedLen;
-    pData        += processedLen;
+    return;
+  }
 
-    if (pkt.size > 0)
-    {
-      int gotPicture = 0;
-      avcodec_decode_video2(pCodecCtx, pFrameYUV, &gotPicture, &pkt);
+  /* A side derived from the aspect ratio is kept even, and at least 2
+   * so that a tiny configured size never rounds it down to nothing.
+   */
+  int outW = config.width;
+  int outH = config.height;
+  if(outW <= 0 && outH <= 0)
+  {
+    outW = w;
+    outH = h;
+  }
+  else if(outW <= 0)
+  {
+    outW = std::max(2, (int)((int64_t)w * outH / h) & ~1);
+  }
+  else if(outH <= 0)
+  {
+    outH = std::max(2, (int)((int64_t)h * outW / w) & ~1);
+  }
 
-      if (!gotPicture)
-      {
-        //DSTATUS_PRIVATE("Got Frame, but no picture\n");
-        continue;
-      }
-      else
+  AVPixelFormat srcFmt = (AVPixelFormat)pFrame->format;
+  AVPixelFormat dstFmt = toAVPixelFormat(config.format);
+
+  int size = avpicture_get_size(dstFmt, outW, outH);
+  if(size <= 0)
+  {
+    DERROR_PRIVATE("Cannot output %dx%d images, frame dropped\n", outW, outH);
+    return;
+  }
+  bufSize = size;
+
+  /* Write straight into a pooled slot of the image ring,
+   * so the decoded frame is never copied again on its way out.
+   */
+  CameraImageSlot* slot = decodedImageHandler.acquireWriteSlot(bufSize);
+  if(NULL == slot)
+  {
+    return;
+  }
+  avpicture_fill((AVPicture*)pFrameOut, slot->image.rawData.data(), dstFmt, outW, outH);
+
+  bool sameSize = (outW == w) && (outH == h);
+  bool srcIsYUV420 = (srcFmt == AV_PIX_FMT_YUV420P) || (srcFmt == AV_PIX_FMT_YUVJ420P);
+  if(sameSize && srcIsYUV420 &&
+     (dstFmt == AV_PIX_FMT_YUV420P || dstFmt == AV_PIX_FMT_GRAY8))
+  {
+    /* The decoder output is already in the wanted layout,
+     * only pack its planes into the slot without any conversion.
+     */
+    int planeNum = (dstFmt == AV_PIX_FMT_GRAY8) ? 1 : 3;
+    for(int plane = 0; plane < planeNum; ++plane)
+    {
+      int planeW = (plane == 0) ? w : (w + 1) / 2;
+      int planeH = (plane == 0) ? h : (h + 1) / 2;
+      for(int row = 0; row < planeH; ++row)
       {
-        int w = pFrameYUV->width;
-        int h = pFrameYUV->height;
-        //DSTATUS_PRIVATE("Got picture! size=%dx%d\n", w, h);
-
-        if(NULL == pSwsCtx)
-        {
-          pSwsCtx = sws_getContext(w, h, pCodecCtx->pix_fmt,
-                                   w, h, AV_PIX_FMT_RGB24,
-                                   4, NULL, NULL, NULL);
-        }
-
-        if(NULL == rgbBuf)
-        {
-          bufSize = avpicture_get_size(AV_PIX_FMT_RGB24, w, h);
-          rgbBuf = (uint8_t*) av_malloc(bufSize);
-          avpicture_fill((AVPicture*)pFrameRGB, rgbBuf, AV_PIX_FMT_RGB24, w, h);
-        }
-
-        if(NULL != pSwsCtx && NULL != rgbBuf)
-        {
-          sws_scale(pSwsCtx,
-                    (uint8_t const *const *) pFrameYUV->data, pFrameYUV->linesize, 0, pFrameYUV->height,
-                             pFrameRGB->data, pFrameRGB->linesize);
-
-          pFrameRGB->height = h;
-          pFrameRGB->width = w;
-
-          decodedImageHandler.writeNewImageWithLock(pFrameRGB->data[0], bufSize, w, h);
-        }
+        memcpy(pFrameOut->data[plane] + row * pFrameOut->linesize[plane],
+               pFrame->data[plane] + row * pFrame->linesize[plane], planeW);
       }
     }
   }
+  else
+  {
+    /* Colour conversion and scaling are done by the same sws_scale pass */
+    pSwsCtx = sws_getCachedContext(pSwsCtx, w, h, srcFmt,
+                                   outW, outH, dstFmt,
+                                   sameSize ? SWS_BICUBIC : SWS_FAST_BILINEAR,
+                                   NULL, NULL, NULL);
+    if(NULL == pSwsCtx)
+    {
+      decodedImageHandler.abortWriteSlot(slot);
+      return;
+    }
+
+    sws_scale(pSwsCtx,
+              (uint8_t const *const *) pFrame->data, pFrame->linesize, 0, pFrame->height,
+              pFrameOut->data, pFrameOut->linesize);
+  }
+
+  pFrameOut->height = outH;
+  pFrameOut->width  = outW;
+
+  decodedImageHandler.commitWriteSlot(slot, outW, outH, config.format);
+}
+
+bool DJICameraStreamDecoder::setOutputConfig(const CameraImageOutputConfig& config)
+{
+  if(config.width < 0 || config.height < 0 ||
+     config.width == 1 || config.height == 1)
+  {
+    return false;
+  }
+
+  /* The chroma planes of 4:2:0 layouts are half the size in both ways */
+  bool chromaSubsampled = (config.format == CAMERA_IMAGE_NV12) ||
+                          (config.format == CAMERA_IMAGE_YUV420P);
+  if(chromaSubsampled && ((config.width & 1) || (config.height & 1)))
+  {
+    return false;
+  }
+
+  pthread_mutex_lock(&decodemutex);
+  outputConfig = config;
+  pthread_mutex_unlock(&decodemutex);
+  return true;
+}
+
+CameraImageOutputConfig DJICameraStreamDecoder::getOutputConfig()
+{
+  pthread_mutex_lock(&decodemutex);
+  CameraImageOutputConfig config = outputConfig;
   pthread_mutex_unlock(&decodemutex);
-  av_free_packet(&pkt);
+  return config;
 }
 
 bool DJICameraStreamDecoder::registerCallback(CameraImageCallback f, void *param)
 {
+  pthread_mutex_lock(&decodemutex);
   cb = f;
+  frameCb = NULL;
+  cbUserParam = param;
+  pthread_mutex_unlock(&decodemutex);
+
+  return updateCallbackThread();
+}
+
+bool DJICameraStreamDecoder::registerFrameCallback(CameraImageFrameCallback f, void *param)
+{
+  pthread_mutex_lock(&decodemutex);
+  frameCb = f;
+  cb = NULL;
   cbUserParam = param;
+  pthread_mutex_unlock(&decodemutex);
+
+  return updateCallbackThread();
+}
+
+bool DJICameraStreamDecoder::updateCallbackThread()
+{
+  pthread_mutex_lock(&decodemutex);
+  bool hasCallback = (NULL != cb || NULL != frameCb);
+  pthread_mutex_unlock(&decodemutex);
 
   /* When users register a non-NULL callback, we will start the callback thread. */
-  if(NULL != cb)
+  if(hasCallback)
   {
     if(!cbThreadIsRunning)
     {
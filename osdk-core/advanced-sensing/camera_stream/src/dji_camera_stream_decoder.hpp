@@ -16,9 +16,14 @@ extern "C"{
 #include <libswscale/swscale.h>
 }
 
+#include <atomic>
+#include <vector>
 #include "pthread.h"
+#include "semaphore.h"
 #include "dji_camera_image.hpp"
 #include "dji_camera_image_handler.hpp"
+#include "dji_camera_stream_link.hpp"
+#include "dji_spsc_queue.hpp"
 
 class DJICameraStreamDecoder
 {
@@ -30,25 +35,102 @@ public:
 
   bool getNewImage(CameraRGBImage & copyOfImage, int timeoutMilliSec);
 
+  bool getNewImageFrame(CameraImageFrame & frame, int timeoutMilliSec);
+
   void callbackThreadFunc();
 
+  /* Only queues the raw stream data, decoding and colour conversion
+   * are done by the decode and convert threads started by init().
+   * Takes no lock, so it never waits for those threads.
+   */
   void decodeBuffer(uint8_t* pBuf, int len);
 
+  /* Zero-copy variant of decodeBuffer: the spans are parsed in place by
+   * the decode thread, they must stay valid until getConsumedBytes() has
+   * grown by their total length. Dropped data is counted as consumed.
+   */
+  void decodeSpans(const CameraStreamSpan* spans, int num);
+
+  /* Total length of the spans the decoder is done with, never decreases */
+  uint64_t getConsumedBytes();
+
   static void* callbackThreadEntry(void *p); 
 
+  static void* decodeThreadEntry(void *p);
+
+  static void* convertThreadEntry(void *p);
+
+  DecoderPipelineStat getPipelineStat();
+
   bool registerCallback(CameraImageCallback f, void* param);
 
-  DJICameraImageHandler decodedImageHandler;
+  bool registerFrameCallback(CameraImageFrameCallback f, void* param);
 
-private:
-  bool initSuccess;
+  /* Pixel format and size of the decoded images, RGB24 at stream size by default */
+  bool setOutputConfig(const CameraImageOutputConfig& config);
+
+  CameraImageOutputConfig getOutputConfig();
 
-  pthread_t callbackThread;
-  bool      cbThreadIsRunning;
-  int       cbThreadStatus;
+  DJICameraImageHandler decodedImageHandler;
 
-  CameraImageCallback cb;
-  void*               cbUserParam;
+private:
+  std::atomic<bool> initSuccess;
+
+  pthread_t         callbackThread;
+  std::atomic<bool> cbThreadIsRunning;
+  int               cbThreadStatus;
+
+  /* Written by the register functions and read by the callback thread,
+   * both under decodemutex
+   */
+  CameraImageCallback      cb;
+  CameraImageFrameCallback frameCb;
+  void*                    cbUserParam;
+
+  bool updateCallbackThread();
+
+  void convertFrame(AVFrame* pFrame);
+
+  /* Stream chunk copied out of the network buffer, or spans borrowed from
+   * it, recycled through freeChunks
+   */
+  struct StreamChunk
+  {
+    std::vector<uint8_t>          data;
+    std::vector<CameraStreamSpan> spans;
+    uint64_t                      spanLen;
+  };
+
+  static const int STREAM_CHUNK_NUM   = 32;
+  static const int DECODED_FRAME_NUM  = 4;
+
+  void decodeThreadFunc();
+  void convertThreadFunc();
+  void decodeChunk(StreamChunk* chunk);
+  void decodeData(const uint8_t* pData, int len);
+  void releaseChunk(StreamChunk* chunk);
+  bool startPipeline();
+  void stopPipeline();
+
+  std::vector<StreamChunk>    chunkPool;
+  SPSCQueue<StreamChunk*>     freeChunks;   /* decode thread -> producer */
+  SPSCQueue<StreamChunk*>     readyChunks;  /* producer -> decode thread */
+  std::vector<AVFrame*>       framePool;
+  SPSCQueue<AVFrame*>         freeFrames;   /* convert thread -> decode thread */
+  SPSCQueue<AVFrame*>         readyFrames;  /* decode thread -> convert thread */
+  sem_t                       chunkSem;
+  sem_t                       frameSem;
+
+  pthread_t         decodeThread;
+  pthread_t         convertThread;
+  std::atomic<bool> pipelineIsRunning;
+  std::atomic<int>  producers;   /* decodeBuffer/decodeSpans calls past the initSuccess check */
+
+  std::atomic<uint64_t> receivedChunks;
+  std::atomic<uint64_t> droppedChunks;
+  std::atomic<uint64_t> decodedFrames;
+  std::atomic<uint64_t> droppedFrames;
+  std::atomic<uint64_t> consumedBytes;
 
   pthread_mutex_t       decodemutex;
   AVCodecContext*       pCodecCtx;
@@ -56,10 +138,13 @@ private:
   AVCodecParserContext* pCodecParserCtx;
   SwsContext*           pSwsCtx;
 
-  AVFrame* pFrameYUV;
-  AVFrame* pFrameRGB;
-  uint8_t* rgbBuf;
-  size_t   bufSize;
+  AVPacket* pPacket;
+  AVFrame*  pFrameYUV;
+  AVFrame*  pFrameOut;
+  AVFrame*  pendingFrame; /* pooled frame taken but not filled by receive_frame */
+  size_t    bufSize;
+
+  CameraImageOutputConfig outputConfig;
 };
 
 #endif // DJICAMERASTREAMDECODER_HH
@@ -61,7 +61,12 @@ DJICameraStreamLink::DJICameraStreamLink(CameraType c)
     threadStatus(-1),
     isRunning(false),
     cb(NULL),
-    cbParam(NULL)
+    cbParam(NULL),
+    spanCb(NULL),
+    consumedCb(NULL),
+    spanCbParam(NULL),
+    forwardedBytes(0),
+    releasedBytes(0)
 {
   camNameStr = ((c==FPV_CAMERA) ? std::string("FPV_CAMERA") : std::string("MAIN_CAMERA"));
   port = ((c==FPV_CAMERA) ? std::string(UDT_SERVER_PORT_FPV) : std::string(UDT_SERVER_PORT_MAIN));
@@ -218,8 +223,19 @@ void DJICameraStreamLink::readThreadFunc()
   while (isRunning)
   {
     int rcvLen=0;
+    if (spanCb)
+    {
+      /* readSpans() has already passed the new data on */
+      if (UDT::ERROR != (rcvLen = readSpans()))
+      {
+        retryReading = 0;
+        usleep(2e4); //50 Hz
+        continue;
+      }
+    }
+
     char rcvBuffer[RECEIVE_SIZE];
-    if (UDT::ERROR != (rcvLen = UDT::recv(fHandle, rcvBuffer, RECEIVE_SIZE, 0)))
+    if (!spanCb && UDT::ERROR != (rcvLen = UDT::recv(fHandle, rcvBuffer, RECEIVE_SIZE, 0)))
     {
       retryReading = 0;
       if(rcvLen)
@@ -242,6 +258,9 @@ void DJICameraStreamLink::readThreadFunc()
     {
       DSTATUS_PRIVATE("Unable to read from %s lost, retry connecting ...\n", camNameStr.c_str());
 
+      /* The borrowed spans live in the buffer of the lost socket */
+      waitSpansConsumed();
+
       retryConnect = 0;
       while(!init() && isRunning)
       {
@@ -258,6 +277,7 @@ void DJICameraStreamLink::readThreadFunc()
     usleep(2e4); //50 Hz
   }
 
+  waitSpansConsumed();
   unInit();
   DSTATUS_PRIVATE("**** %s reading thread stopped\n", camNameStr.c_str());
 }
@@ -268,6 +288,88 @@ void DJICameraStreamLink::registerCallback(CAMCALLBACK f, void* param)
   cbParam = param;
 }
 
+bool DJICameraStreamLink::registerSpanCallback(CAMSPANCALLBACK f, CAMCONSUMEDCALLBACK consumed, void* param)
+{
+  if (isRunning || (f && !consumed))
+  {
+    return false;
+  }
+
+  spanCb      = f;
+  consumedCb  = f ? consumed : NULL;
+  spanCbParam = f ? param : NULL;
+
+  /* Both counters follow the consumer's, which may already be non zero */
+  forwardedBytes = consumedCb ? (*consumedCb)(spanCbParam) : 0;
+  releasedBytes  = forwardedBytes;
+  return true;
+}
+
+int DJICameraStreamLink::readSpans()
+{
+  /* Give back what the consumer is done with, borrowing then starts at
+   * the first byte it still holds.
+   */
+  uint64_t consumed = (*consumedCb)(spanCbParam);
+  if (consumed > releasedBytes)
+  {
+    if (UDT::ERROR == UDT::recvrelease(fHandle, (int)(consumed - releasedBytes)))
+    {
+      return UDT::ERROR;
+    }
+    releasedBytes = consumed;
+  }
+
+  UDT::RECVSPAN udtSpans[BORROW_SPAN_NUM];
+  int num = UDT::recvborrow(fHandle, udtSpans, BORROW_SPAN_NUM);
+  if (UDT::ERROR == num)
+  {
+    return UDT::ERROR;
+  }
+
+  /* Skip what was already handed over in an earlier round */
+  CameraStreamSpan spans[BORROW_SPAN_NUM];
+  uint64_t skip    = forwardedBytes - releasedBytes;
+  int      spanNum = 0;
+  int      newLen  = 0;
+  for (int i = 0; i < num; ++i)
+  {
+    if (skip >= (uint64_t)udtSpans[i].len)
+    {
+      skip -= udtSpans[i].len;
+      continue;
+    }
+
+    spans[spanNum].data = reinterpret_cast<const uint8_t*>(udtSpans[i].data) + skip;
+    spans[spanNum].len  = udtSpans[i].len - (int)skip;
+    newLen += spans[spanNum].len;
+    spanNum++;
+    skip = 0;
+  }
+
+  if (spanNum > 0)
+  {
+    forwardedBytes += newLen;
+    (*spanCb)(spanCbParam, spans, spanNum);
+  }
+
+  return newLen;
+}
+
+void DJICameraStreamLink::waitSpansConsumed()
+{
+  if (!consumedCb)
+  {
+    return;
+  }
+
+  while ((*consumedCb)(spanCbParam) < forwardedBytes)
+  {
+    usleep(1000);
+  }
+  releasedBytes = forwardedBytes;
+}
+
 bool DJICameraStreamLink::isThreadRunning()
 {
   return isRunning;
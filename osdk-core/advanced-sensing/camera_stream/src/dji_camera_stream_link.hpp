@@ -18,9 +18,24 @@
 
 typedef void (*CAMCALLBACK)(void*, uint8_t*, int);
 
+/* Stream data left in place in the UDT receiving buffer */
+typedef struct CameraStreamSpan
+{
+  const uint8_t* data;
+  int            len;
+} CameraStreamSpan;
+
+/* Receives new spans, they stay valid until the consumed byte count
+ * reported by the CAMCONSUMEDCALLBACK has grown past them.
+ */
+typedef void (*CAMSPANCALLBACK)(void*, const CameraStreamSpan*, int);
+typedef uint64_t (*CAMCONSUMEDCALLBACK)(void*);
+
 class DJICameraStreamLink
 {
 public:
+  static const int BORROW_SPAN_NUM = 128;
+
   DJICameraStreamLink(CameraType c);
   ~DJICameraStreamLink();
   /* Establish link to camera */
@@ -43,6 +58,11 @@ public:
   /* register a callback function */
   void registerCallback(CAMCALLBACK f, void* param);
 
+  /* Hand the stream over without copying it, instead of calling the
+   * CAMCALLBACK. Only possible while the reading thread is stopped.
+   */
+  bool registerSpanCallback(CAMSPANCALLBACK f, CAMCONSUMEDCALLBACK consumed, void* param);
+
 private:
   CameraType  camType;
   std::string camNameStr;
@@ -58,11 +78,23 @@ private:
   CAMCALLBACK cb;
   void* cbParam;
 
+  CAMSPANCALLBACK     spanCb;
+  CAMCONSUMEDCALLBACK consumedCb;
+  void*               spanCbParam;
+  uint64_t            forwardedBytes;  /* handed to spanCb so far */
+  uint64_t            releasedBytes;   /* given back to UDT so far */
+
   /* disconnect link from camera */
   void unInit();
 
   /* real function to read data from camera */
   void readThreadFunc();
+
+  /* borrow the received data and pass the new part to spanCb */
+  int readSpans();
+
+  /* wait until spanCb's consumer is done with everything handed to it */
+  void waitSpansConsumed();
 };
 
 #endif // DJICAMERASTREAMLINK_HH
@@ -0,0 +1,391 @@
+/*
+ * DJI Onboard SDK Advanced Sensing APIs
+ *
+ * Copyright (c) 2017-2018 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ * @file dji_h264_access_unit.cpp
+ *  @version 4.0.0
+ *  @date Dec 2017
+ *
+ */
+
+
+#include "dji_h264_access_unit.hpp"
+#include <cstring>
+#include <time.h>
+#include <unistd.h>
+
+H264AccessUnitPool::H264AccessUnitPool(int maxBuffers)
+  : maxBuffers(maxBuffers),
+    closed(false)
+{
+  pthread_mutex_init(&mutex, NULL);
+  buffers.reserve(maxBuffers);
+  freeBuffers.reserve(maxBuffers);
+}
+
+H264AccessUnitPool::~H264AccessUnitPool()
+{
+  for (size_t i = 0; i < buffers.size(); ++i)
+  {
+    delete buffers[i];
+  }
+  pthread_mutex_destroy(&mutex);
+}
+
+H264AccessUnitBuffer* H264AccessUnitPool::acquire()
+{
+  H264AccessUnitBuffer* buffer = NULL;
+
+  pthread_mutex_lock(&mutex);
+  if (!closed)
+  {
+    if (!freeBuffers.empty())
+    {
+      buffer = freeBuffers.back();
+      freeBuffers.pop_back();
+    }
+    else if ((int)buffers.size() < maxBuffers)
+    {
+      buffer       = new H264AccessUnitBuffer;
+      buffer->pool = this;
+      buffers.push_back(buffer);
+    }
+  }
+  if (buffer)
+  {
+    buffer->refCount = 1;
+  }
+  pthread_mutex_unlock(&mutex);
+  return buffer;
+}
+
+void H264AccessUnitPool::retain(H264AccessUnitBuffer* buffer)
+{
+  pthread_mutex_lock(&mutex);
+  buffer->refCount++;
+  pthread_mutex_unlock(&mutex);
+}
+
+void H264AccessUnitPool::release(H264AccessUnitBuffer* buffer)
+{
+  pthread_mutex_lock(&mutex);
+  if (buffer->refCount > 0 && --buffer->refCount == 0)
+  {
+    freeBuffers.push_back(buffer);
+  }
+  bool unused = closed && (freeBuffers.size() == buffers.size());
+  pthread_mutex_unlock(&mutex);
+
+  if (unused)
+  {
+    delete this;
+  }
+}
+
+void H264AccessUnitPool::close()
+{
+  pthread_mutex_lock(&mutex);
+  closed      = true;
+  bool unused = (freeBuffers.size() == buffers.size());
+  pthread_mutex_unlock(&mutex);
+
+  if (unused)
+  {
+    delete this;
+  }
+}
+
+int H264AccessUnitPool::getBufferNum()
+{
+  pthread_mutex_lock(&mutex);
+  int num = (int)buffers.size();
+  pthread_mutex_unlock(&mutex);
+  return num;
+}
+
+void H264AccessUnitRetain(const H264AccessUnit* au)
+{
+  if (au && au->buffer)
+  {
+    au->buffer->pool->retain(au->buffer);
+  }
+}
+
+void H264AccessUnitRelease(const H264AccessUnit* au)
+{
+  if (au && au->buffer)
+  {
+    au->buffer->pool->release(au->buffer);
+  }
+}
+
+H264AccessUnitAssembler::H264AccessUnitAssembler(int maxUnitLen, int bufferNum)
+  : dispatching(0),
+    resetPending(false),
+    pool(new H264AccessUnitPool(bufferNum > 2 ? bufferNum : 2)),
+    unitLen(0),
+    scanPos(0),
+    unitHasVcl(false),
+    unitFlags(0),
+    unitTimeUs(0),
+    chunkTimeUs(0),
+    sequence(0),
+    maxUnitLen(maxUnitLen > 0 ? maxUnitLen : DEFAULT_MAX_UNIT_LEN),
+    statUnits(0),
+    statBytes(0),
+    statOverflows(0),
+    statDropped(0),
+    statMaxUnitLen(0)
+{
+  Handler* handler  = new Handler;
+  handler->cb       = NULL;
+  handler->userData = NULL;
+  activeHandler.store(handler);
+
+  /* The pool has at least two buffers, so this one always succeeds */
+  unit = pool->acquire();
+}
+
+H264AccessUnitAssembler::~H264AccessUnitAssembler()
+{
+  delete activeHandler.load();
+  pool->release(unit);
+  pool->close();
+}
+
+void H264AccessUnitAssembler::setCallback(H264AccessUnitCallback cb, void* userData)
+{
+  Handler* handler  = new Handler;
+  handler->cb       = cb;
+  handler->userData = userData;
+  const Handler* old = activeHandler.exchange(handler, std::memory_order_seq_cst);
+
+  /* A callback that started before the exchange may still use the old
+   * handler, any later one already sees the new handler. This needs the
+   * exchange, this load and the counter update in emit() all seq_cst,
+   * otherwise both loads may miss the other side's store.
+   */
+  while (dispatching.load(std::memory_order_seq_cst) != 0)
+  {
+    usleep(1000);
+  }
+  delete old;
+  resetPending.store(true, std::memory_order_release);
+}
+
+void H264AccessUnitAssembler::feedCallback(uint8_t* buf, int bufLen, void* userData)
+{
+  if (userData)
+  {
+    ((H264AccessUnitAssembler*)userData)->feed(buf, bufLen);
+  }
+}
+
+void H264AccessUnitAssembler::feed(const uint8_t* buf, int bufLen)
+{
+  if (resetPending.exchange(false, std::memory_order_acq_rel))
+  {
+    reset();
+    sequence = 0;
+  }
+
+  if (!buf || bufLen <= 0)
+  {
+    return;
+  }
+
+  statBytes.fetch_add(bufLen, std::memory_order_relaxed);
+  chunkTimeUs = monotonicTimeUs();
+
+  if (unitLen + bufLen > maxUnitLen)
+  {
+    /* No unit boundary for far too long, the stream is corrupted or not
+     * H264 at all. Start over instead of growing without bound.
+     */
+    statOverflows.fetch_add(1, std::memory_order_relaxed);
+    reset();
+    if ((size_t)bufLen > maxUnitLen)
+    {
+      return;
+    }
+  }
+
+  if (unitLen == 0)
+  {
+    unitTimeUs = chunkTimeUs;
+  }
+  if (unit->bytes.size() < unitLen + bufLen)
+  {
+    unit->bytes.resize(unitLen + bufLen);
+  }
+  memcpy(&unit->bytes[unitLen], buf, bufLen);
+  unitLen += bufLen;
+
+  scan();
+}
+
+void H264AccessUnitAssembler::reset()
+{
+  unitLen    = 0;
+  scanPos    = 0;
+  unitHasVcl = false;
+  unitFlags  = 0;
+}
+
+void H264AccessUnitAssembler::scan()
+{
+  const uint8_t* p = &unit->bytes[0];
+  size_t         i = scanPos;
+
+  /* A start code at i is only examined once its NAL header (i + 3) and
+   * the first slice header byte (i + 4) have arrived.
+   */
+  while (i + 4 < unitLen)
+  {
+    if (p[i + 2] > 1)
+    {
+      /* No start code can begin at i, i + 1 or i + 2 */
+      i += 3;
+      continue;
+    }
+    if (p[i] != 0 || p[i + 1] != 0 || p[i + 2] != 1)
+    {
+      i++;
+      continue;
+    }
+
+    size_t  nalPos = (i > 0 && p[i - 1] == 0) ? i - 1 : i;
+    uint8_t type   = p[i + 3] & 0x1F;
+    bool    isVcl  = (type == 1 || type == 5);
+    bool    first;
+    if (isVcl)
+    {
+      /* first_mb_in_slice is ue(v), it is 0 iff its first bit is set */
+      first = (p[i + 4] & 0x80) != 0;
+    }
+    else
+    {
+      /* SEI, SPS, PPS, delimiter and the reserved types 14..18 */
+      first = (type >= 6 && type <= 9) || (type >= 14 && type <= 18);
+    }
+
+    if (first && unitHasVcl && nalPos > 0)
+    {
+      emit(nalPos);
+      i -= nalPos;
+      p = &unit->bytes[0];
+    }
+
+    if (type == 5)
+    {
+      unitFlags |= H264_AU_FLAG_IDR;
+    }
+    else if (type == 7)
+    {
+      unitFlags |= H264_AU_FLAG_SPS;
+    }
+    else if (type == 8)
+    {
+      unitFlags |= H264_AU_FLAG_PPS;
+    }
+    if (isVcl)
+    {
+      unitHasVcl = true;
+    }
+    i += 4;
+  }
+
+  scanPos = i;
+}
+
+void H264AccessUnitAssembler::emit(size_t len)
+{
+  size_t                tailLen = unitLen - len;
+  H264AccessUnitBuffer* next    = pool->acquire();
+
+  if (next)
+  {
+    dispatching.fetch_add(1, std::memory_order_seq_cst);
+    const Handler* h = activeHandler.load(std::memory_order_seq_cst);
+    if (h->cb)
+    {
+      H264AccessUnit au;
+      au.data       = &unit->bytes[0];
+      au.dataLen    = (int)len;
+      au.flags      = unitFlags;
+      au.recvTimeUs = unitTimeUs;
+      au.sequence   = sequence;
+      au.buffer     = unit;
+      h->cb(&au, h->userData);
+    }
+    dispatching.fetch_sub(1, std::memory_order_seq_cst);
+    statUnits.fetch_add(1, std::memory_order_relaxed);
+
+    /* Move the bytes of the next unit, they all came with the current
+     * chunk, into the new buffer. The user may keep the old one.
+     */
+    if (next->bytes.size() < tailLen)
+    {
+      next->bytes.resize(tailLen);
+    }
+    if (tailLen > 0)
+    {
+      memcpy(&next->bytes[0], &unit->bytes[len], tailLen);
+    }
+    pool->release(unit);
+    unit = next;
+  }
+  else
+  {
+    /* Every other buffer is kept by the user, drop the unit and reuse its
+     * buffer. The sequence gap tells the user about it.
+     */
+    statDropped.fetch_add(1, std::memory_order_relaxed);
+    memmove(&unit->bytes[0], &unit->bytes[len], tailLen);
+  }
+  sequence++;
+
+  if (len > statMaxUnitLen.load(std::memory_order_relaxed))
+  {
+    statMaxUnitLen.store((uint32_t)len, std::memory_order_relaxed);
+  }
+
+  unitLen    = tailLen;
+  scanPos    = 0;
+  unitHasVcl = false;
+  unitFlags  = 0;
+  unitTimeUs = chunkTimeUs;
+}
+
+H264AccessUnitStat H264AccessUnitAssembler::getStat()
+{
+  H264AccessUnitStat stat;
+  stat.accessUnits = statUnits.load(std::memory_order_relaxed);
+  stat.bytes       = statBytes.load(std::memory_order_relaxed);
+  stat.overflows   = statOverflows.load(std::memory_order_relaxed);
+  stat.droppedUnits = statDropped.load(std::memory_order_relaxed);
+  stat.maxUnitLen  = statMaxUnitLen.load(std::memory_order_relaxed);
+  return stat;
+}
+
+uint64_t H264AccessUnitAssembler::monotonicTimeUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,148 @@
+/** @file dji_h264_access_unit.hpp
+ *  @version 4.0.0
+ *  @date Dec 2017
+ *
+ *  @brief Reassemble the raw H264 byte stream into complete access units
+ *
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJIH264ACCESSUNIT_HH
+#define DJIH264ACCESSUNIT_HH
+
+#include <atomic>
+#include <vector>
+#include "pthread.h"
+#include "dji_camera_image.hpp"
+
+class H264AccessUnitPool;
+
+/*! @brief One pooled access unit buffer. The capacity of bytes is kept
+ *  between units, so no allocation happens once the biggest IDR frame of
+ *  the stream has been seen by every buffer.
+ */
+struct H264AccessUnitBuffer
+{
+  H264AccessUnitPool*  pool;
+  int                  refCount;
+  std::vector<uint8_t> bytes;
+};
+
+/*! @brief Fixed number of access unit buffers shared between the assembler
+ *  and the users keeping units. Buffers are created on demand up to
+ *  maxBuffers. When the assembler goes away while users still keep some,
+ *  the pool deletes itself with the last released buffer.
+ */
+class H264AccessUnitPool
+{
+public:
+  H264AccessUnitPool(int maxBuffers);
+
+  /*! @return a buffer with one reference, NULL if all of them are in use */
+  H264AccessUnitBuffer* acquire();
+  void retain(H264AccessUnitBuffer* buffer);
+  void release(H264AccessUnitBuffer* buffer);
+
+  /*! The owner is gone, nothing is acquired anymore */
+  void close();
+
+  int  getBufferNum();
+
+private:
+  ~H264AccessUnitPool();
+  H264AccessUnitPool(const H264AccessUnitPool&);
+  H264AccessUnitPool& operator=(const H264AccessUnitPool&);
+
+  pthread_mutex_t                     mutex;
+  std::vector<H264AccessUnitBuffer*>  buffers;
+  std::vector<H264AccessUnitBuffer*>  freeBuffers;
+  int                                 maxBuffers;
+  bool                                closed;
+};
+
+/*! @brief Counters of one reassembled stream
+ */
+typedef struct H264AccessUnitStat
+{
+  uint64_t accessUnits;   /*!< access units handed to the callback */
+  uint64_t bytes;         /*!< bytes fed into the assembler */
+  uint64_t overflows;     /*!< buffers discarded for growing past the limit */
+  uint64_t droppedUnits;  /*!< units dropped because every buffer was kept */
+  uint32_t maxUnitLen;    /*!< largest access unit seen so far */
+} H264AccessUnitStat;
+
+/*! @brief Cut an Annex-B stream arriving in arbitrary chunks into access
+ *  units, following the first-NAL-of-a-new-unit rules of H.264 7.4.1.2.3.
+ *
+ *  feed() must always be called from the same thread. A unit is only known
+ *  to be complete when the first NAL of the next one shows up, so unless
+ *  the encoder sends an access unit delimiter right after each picture,
+ *  every unit is delivered one frame late.
+ *  Units are reassembled in place in pooled buffers, the callback gets the
+ *  buffer and may keep it (see H264AccessUnitRetain) instead of copying.
+ */
+class H264AccessUnitAssembler
+{
+public:
+  static const int DEFAULT_MAX_UNIT_LEN = 4 * 1024 * 1024;
+  static const int DEFAULT_BUFFER_NUM   = 4;
+
+  H264AccessUnitAssembler(int maxUnitLen = DEFAULT_MAX_UNIT_LEN,
+                          int bufferNum = DEFAULT_BUFFER_NUM);
+  ~H264AccessUnitAssembler();
+
+  /*! Set the user callback, may be called while feed() is running and
+   *  returns once the previous callback is not running anymore, so it must
+   *  not be called from inside the callback.
+   *  The partial unit buffered so far is dropped on the next feed().
+   */
+  void setCallback(H264AccessUnitCallback cb, void* userData);
+
+  void feed(const uint8_t* buf, int bufLen);
+
+  H264AccessUnitStat getStat();
+
+  /*! H264Callback adapter, userData is the assembler itself */
+  static void feedCallback(uint8_t* buf, int bufLen, void* userData);
+
+private:
+  H264AccessUnitAssembler(const H264AccessUnitAssembler&);
+  H264AccessUnitAssembler& operator=(const H264AccessUnitAssembler&);
+
+  /* Never modified once published, replaced as a whole by setCallback */
+  typedef struct Handler
+  {
+    H264AccessUnitCallback cb;
+    void*                  userData;
+  } Handler;
+
+  void reset();
+  void scan();
+  void emit(size_t unitLen);
+
+  static uint64_t monotonicTimeUs();
+
+  std::atomic<const Handler*> activeHandler;
+  std::atomic<int>        dispatching;
+  std::atomic<bool>       resetPending;
+
+  H264AccessUnitPool*     pool;
+  H264AccessUnitBuffer*   unit;       /* bytes of the pending unit, then the tail */
+  size_t                  unitLen;    /* bytes currently valid in unit */
+  size_t                  scanPos;    /* next byte to look for a start code at */
+  bool                    unitHasVcl;
+  uint32_t                unitFlags;
+  uint64_t                unitTimeUs;
+  uint64_t                chunkTimeUs;
+  uint32_t                sequence;
+  size_t                  maxUnitLen;
+
+  std::atomic<uint64_t>   statUnits;
+  std::atomic<uint64_t>   statBytes;
+  std::atomic<uint64_t>   statOverflows;
+  std::atomic<uint64_t>   statDropped;
+  std::atomic<uint32_t>   statMaxUnitLen;
+};
+
+#endif // DJIH264ACCESSUNIT_HH
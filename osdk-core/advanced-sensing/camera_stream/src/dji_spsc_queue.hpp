@@ -0,0 +1,93 @@
+/** @file dji_spsc_queue.hpp
+ *  @version 4.0.0
+ *  @date Dec 2017
+ *
+ *  @brief Bounded lock-free queue between exactly one producer thread
+ *  and one consumer thread, used to chain the camera stream stages
+
+ *  @copyright 2017 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJISPSCQUEUE_HH
+#define DJISPSCQUEUE_HH
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+template <typename T>
+class SPSCQueue
+{
+public:
+  /* One slot is always kept empty to tell full from empty,
+   * so the ring is sized to the next power of two above capacity.
+   */
+  explicit SPSCQueue(size_t capacity)
+    : head(0),
+      tail(0)
+  {
+    size_t size = 2;
+    while (size < capacity + 1)
+    {
+      size <<= 1;
+    }
+    ring.resize(size);
+    mask = size - 1;
+  }
+
+  /* Producer only. Returns false if the queue is full. */
+  bool push(const T& item)
+  {
+    size_t t    = tail.load(std::memory_order_relaxed);
+    size_t next = (t + 1) & mask;
+    if (next == head.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    ring[t] = item;
+    tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /* Consumer only. Returns false if the queue is empty. */
+  bool pop(T& item)
+  {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    item = ring[h];
+    head.store((h + 1) & mask, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const
+  {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+
+  size_t capacity() const
+  {
+    return mask;
+  }
+
+private:
+  SPSCQueue(const SPSCQueue&);
+  SPSCQueue& operator=(const SPSCQueue&);
+
+  std::vector<T> ring;
+  size_t         mask;
+
+  /* Keep the two indexes on separate cache lines so the producer and
+   * consumer do not invalidate each other on every operation.
+   */
+  char                padHead[64];
+  std::atomic<size_t> head;
+  char                padTail[64];
+  std::atomic<size_t> tail;
+};
+
+#endif // DJISPSCQUEUE_HH
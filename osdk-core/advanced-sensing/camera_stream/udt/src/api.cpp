@@ -1875,6 +1875,44 @@ int CUDT::recvmsg(UDTSOCKET u, char* buf, int len)
    }
 }
 
+int CUDT::recvborrow(UDTSOCKET u, CRecvSpan* spans, int num)
+{
+   try
+   {
+      CUDT* udt = s_UDTUnited.lookup(u);
+      return udt->recvBorrow(spans, num);
+   }
+   catch (CUDTException e)
+   {
+      s_UDTUnited.setError(new CUDTException(e));
+      return ERROR;
+   }
+   catch (...)
+   {
+      s_UDTUnited.setError(new CUDTException(-1, 0, 0));
+      return ERROR;
+   }
+}
+
+int CUDT::recvrelease(UDTSOCKET u, int len)
+{
+   try
+   {
+      CUDT* udt = s_UDTUnited.lookup(u);
+      return udt->recvRelease(len);
+   }
+   catch (CUDTException e)
+   {
+      s_UDTUnited.setError(new CUDTException(e));
+      return ERROR;
+   }
+   catch (...)
+   {
+      s_UDTUnited.setError(new CUDTException(-1, 0, 0));
+      return ERROR;
+   }
+}
+
 int64_t CUDT::sendfile(UDTSOCKET u, fstream& ifs, int64_t& offset, int64_t size, int block)
 {
    try
@@ -2243,6 +2281,16 @@ int recvmsg(UDTSOCKET u, char* buf, int len)
    return CUDT::recvmsg(u, buf, len);
 }
 
+int recvborrow(UDTSOCKET u, RECVSPAN* spans, int num)
+{
+   return CUDT::recvborrow(u, spans, num);
+}
+
+int recvrelease(UDTSOCKET u, int len)
+{
+   return CUDT::recvrelease(u, len);
+}
+
 int64_t sendfile(UDTSOCKET u, fstream& ifs, int64_t& offset, int64_t size, int block)
 {
    return CUDT::sendfile(u, ifs, offset, size, block);
@@ -350,11 +350,14 @@ m_pUnitQueue(queue),
 m_iStartPos(0),
 m_iLastAckPos(0),
 m_iMaxPos(0),
-m_iNotch(0)
+m_iNotch(0),
+m_EmptyUnit()
 {
    m_pUnit = new CUnit* [m_iSize];
    for (int i = 0; i < m_iSize; ++ i)
       m_pUnit[i] = NULL;
+
+   m_EmptyUnit.m_iFlag = 1;
 }
 
 CRcvBuffer::~CRcvBuffer()
@@ -362,10 +365,7 @@ CRcvBuffer::~CRcvBuffer()
    for (int i = 0; i < m_iSize; ++ i)
    {
       if (NULL != m_pUnit[i])
-      {
-         m_pUnit[i]->m_iFlag = 0;
-         -- m_pUnitQueue->m_iCount;
-      }
+         freeUnit(m_pUnit[i]);
    }
 
    delete [] m_pUnit;
@@ -388,6 +388,20 @@ int CRcvBuffer::addData(CUnit* unit, int offset)
    return 0;
 }
 
+int CRcvBuffer::skipData(int offset)
+{
+   int pos = (m_iLastAckPos + offset) % m_iSize;
+   if (offset > m_iMaxPos)
+      m_iMaxPos = offset;
+
+   if (NULL != m_pUnit[pos])
+      return -1;
+
+   m_pUnit[pos] = &m_EmptyUnit;
+
+   return 0;
+}
+
 int CRcvBuffer::readBuffer(char* data, int len)
 {
    int p = m_iStartPos;
@@ -405,10 +419,8 @@ int CRcvBuffer::readBuffer(char* data, int len)
 
       if ((rs > unitsize) || (rs == m_pUnit[p]->m_Packet.getLength() - m_iNotch))
       {
-         CUnit* tmp = m_pUnit[p];
+         freeUnit(m_pUnit[p]);
          m_pUnit[p] = NULL;
-         tmp->m_iFlag = 0;
-         -- m_pUnitQueue->m_iCount;
 
          if (++ p == m_iSize)
             p = 0;
@@ -443,10 +455,8 @@ int CRcvBuffer::readBufferToFile(fstream& ofs, int len)
 
       if ((rs > unitsize) || (rs == m_pUnit[p]->m_Packet.getLength() - m_iNotch))
       {
-         CUnit* tmp = m_pUnit[p];
+         freeUnit(m_pUnit[p]);
          m_pUnit[p] = NULL;
-         tmp->m_iFlag = 0;
-         -- m_pUnitQueue->m_iCount;
 
          if (++ p == m_iSize)
             p = 0;
@@ -464,6 +474,60 @@ int CRcvBuffer::readBufferToFile(fstream& ofs, int len)
    return len - rs;
 }
 
+int CRcvBuffer::peekBuffer(CRecvSpan* span, int num) const
+{
+   int p = m_iStartPos;
+   int lastack = m_iLastAckPos;
+   int notch = m_iNotch;
+   int count = 0;
+
+   while ((p != lastack) && (count < num))
+   {
+      span[count].data = m_pUnit[p]->m_Packet.m_pcData + notch;
+      span[count].len = m_pUnit[p]->m_Packet.getLength() - notch;
+      ++ count;
+
+      if (++ p == m_iSize)
+         p = 0;
+
+      notch = 0;
+   }
+
+   return count;
+}
+
+int CRcvBuffer::releaseBuffer(int len)
+{
+   int p = m_iStartPos;
+   int lastack = m_iLastAckPos;
+   int rs = len;
+
+   while ((p != lastack) && (rs > 0))
+   {
+      int unitsize = m_pUnit[p]->m_Packet.getLength() - m_iNotch;
+
+      if (rs >= unitsize)
+      {
+         freeUnit(m_pUnit[p]);
+         m_pUnit[p] = NULL;
+
+         if (++ p == m_iSize)
+            p = 0;
+
+         m_iNotch = 0;
+         rs -= unitsize;
+      }
+      else
+      {
+         m_iNotch += rs;
+         rs = 0;
+      }
+   }
+
+   m_iStartPos = p;
+   return len - rs;
+}
+
 void CRcvBuffer::ackData(int len)
 {
    m_iLastAckPos = (m_iLastAckPos + len) % m_iSize;
@@ -518,10 +582,8 @@ int CRcvBuffer::readMsg(char* data, int len)
 
       if (!passack)
       {
-         CUnit* tmp = m_pUnit[p];
+         freeUnit(m_pUnit[p]);
          m_pUnit[p] = NULL;
-         tmp->m_iFlag = 0;
-         -- m_pUnitQueue->m_iCount;
       }
       else
          m_pUnit[p]->m_iFlag = 2;
@@ -650,3 +712,13 @@ bool CRcvBuffer::scanMsg(int& p, int& q, bool& passack)
 
    return found;
 }
+
+void CRcvBuffer::freeUnit(CUnit* unit)
+{
+   // the empty unit is not part of the unit queue
+   if (&m_EmptyUnit == unit)
+      return;
+
+   unit->m_iFlag = 0;
+   -- m_pUnitQueue->m_iCount;
+}
@@ -175,6 +175,15 @@ public:
 
    int addData(CUnit* unit, int offset);
 
+      // Functionality:
+      //    Give up a packet that has not arrived, the data is read on as if the packet had been empty.
+      // Parameters:
+      //    0) [in] offset: offset from last ACK point.
+      // Returned value:
+      //    0 is success, -1 if the packet has arrived already.
+
+   int skipData(int offset);
+
       // Functionality:
       //    Read data into a user buffer.
       // Parameters:
@@ -195,6 +204,25 @@ public:
 
    int readBufferToFile(std::fstream& ofs, int len);
 
+      // Functionality:
+      //    Expose the data ready for reading in place, one span per unit.
+      // Parameters:
+      //    0) [out] span: data spans, in stream order.
+      //    1) [in] num: maximum number of spans.
+      // Returned value:
+      //    number of spans returned.
+
+   int peekBuffer(CRecvSpan* span, int num) const;
+
+      // Functionality:
+      //    Consume data exposed by peekBuffer, as readBuffer does without copying it.
+      // Parameters:
+      //    0) [in] len: size of data to be consumed.
+      // Returned value:
+      //    size of data consumed.
+
+   int releaseBuffer(int len);
+
       // Functionality:
       //    Update the ACK point of the buffer.
       // Parameters:
@@ -252,6 +280,7 @@ public:
 
 private:
    bool scanMsg(int& start, int& end, bool& passack);
+   void freeUnit(CUnit* unit);
 
 private:
    CUnit** m_pUnit;                     // pointer to the protocol buffer
@@ -265,6 +294,8 @@ private:
 
    int m_iNotch;			// the starting read point of the first unit
 
+   CUnit m_EmptyUnit;                   // stands in for all the packets given up by skipData()
+
 private:
    CRcvBuffer();
    CRcvBuffer(const CRcvBuffer&);
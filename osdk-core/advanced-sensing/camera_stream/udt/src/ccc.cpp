@@ -54,6 +54,7 @@ m_iMSS(),
 m_iSndCurrSeqNo(),
 m_iRcvRate(),
 m_iRTT(),
+m_iLatency(0),
 m_pcParam(NULL),
 m_iPSize(0),
 m_UDT(),
@@ -143,6 +144,11 @@ void CCC::setRTT(int rtt)
    m_iRTT = rtt;
 }
 
+void CCC::setLatency(int latency)
+{
+   m_iLatency = latency;
+}
+
 void CCC::setUserParam(const char* param, int size)
 {
    delete [] m_pcParam;
@@ -312,3 +318,132 @@ void CUDTCC::onTimeout()
       */
    }
 }
+
+//
+CLiveCC::CLiveCC():
+m_iRCInterval(),
+m_LastRCTime(),
+m_LastDecTime(),
+m_bSlowStart(),
+m_iLastAck(),
+m_iLastDecSeq(),
+m_iMinRTT(),
+m_iQueueDelay()
+{
+}
+
+void CLiveCC::init()
+{
+   m_iRCInterval = m_iSYNInterval;
+   m_LastRCTime = CTimer::getTime();
+   m_LastDecTime = m_LastRCTime;
+   setACKTimer(m_iRCInterval);
+
+   m_bSlowStart = true;
+   m_iLastAck = m_iSndCurrSeqNo;
+   m_iLastDecSeq = CSeqNo::decseq(m_iLastAck);
+   m_iMinRTT = 0;
+   m_iQueueDelay = 0;
+
+   m_dCWndSize = 16;
+   m_dPktSndPeriod = 1;
+}
+
+void CLiveCC::onACK(int32_t ack)
+{
+   uint64_t currtime = CTimer::getTime();
+   if (currtime - m_LastRCTime < (uint64_t)m_iRCInterval)
+      return;
+
+   m_LastRCTime = currtime;
+
+   if ((0 == m_iMinRTT) || (m_iRTT < m_iMinRTT))
+      m_iMinRTT = m_iRTT;
+   m_iQueueDelay = m_iRTT - m_iMinRTT;
+
+   if (m_bSlowStart)
+   {
+      m_dCWndSize += CSeqNo::seqlen(m_iLastAck, ack);
+      m_iLastAck = ack;
+
+      // leave slow start as soon as the data starts queueing, not only on the first loss
+      if ((m_dCWndSize > m_dMaxCWndSize) || (m_iQueueDelay > getBudget() / 2))
+         leaveSlowStart();
+      else
+         return;
+   }
+
+   // anything in flight beyond what is sent during the latency budget only waits in a queue; the receiving
+   // rate alone would follow the pace of the source down, and leave no room for the retransmissions
+   double rate = 1000000.0 / m_dPktSndPeriod;
+   if (rate < m_iRcvRate)
+      rate = m_iRcvRate;
+   m_dCWndSize = rate / 1000000.0 * (m_iMinRTT + getBudget()) + 16;
+   if (m_dCWndSize > m_dMaxCWndSize)
+      m_dCWndSize = m_dMaxCWndSize;
+
+   if (m_iQueueDelay > getBudget() / 2)
+   {
+      // the queue eats up the budget, back off once per RTT so the decrease can be seen before the next one
+      if (currtime - m_LastDecTime > (uint64_t)m_iRTT)
+      {
+         m_dPktSndPeriod = ceil(m_dPktSndPeriod * 1.125);
+         m_LastDecTime = currtime;
+      }
+      return;
+   }
+
+   // the delay says more about the room left than the bandwidth estimate, which the pace of the source
+   // and the jitter of a radio link keep low; probe faster as long as nothing queues
+   if (m_iQueueDelay < getBudget() / 4)
+   {
+      m_dPktSndPeriod /= 1.02;
+      if (m_dPktSndPeriod < 1.0)
+         m_dPktSndPeriod = 1.0;
+   }
+}
+
+void CLiveCC::onLoss(const int32_t* losslist, int)
+{
+   // a radio link also drops packets when it is not congested,
+   // so a loss only counts as congestion while the data is queueing
+   if (m_iQueueDelay <= getBudget() / 4)
+      return;
+
+   if (m_bSlowStart)
+   {
+      leaveSlowStart();
+      return;
+   }
+
+   if (CSeqNo::seqcmp(losslist[0] & 0x7FFFFFFF, m_iLastDecSeq) > 0)
+   {
+      m_dPktSndPeriod = ceil(m_dPktSndPeriod * 1.125);
+      m_iLastDecSeq = m_iSndCurrSeqNo;
+   }
+}
+
+void CLiveCC::onTimeout()
+{
+   if (m_bSlowStart)
+      leaveSlowStart();
+}
+
+int CLiveCC::getBudget() const
+{
+   return (m_iLatency > 0) ? m_iLatency : m_iDefaultLatency;
+}
+
+void CLiveCC::leaveSlowStart()
+{
+   m_bSlowStart = false;
+
+   // live data comes at the pace of its source, so the receiving rate is no more than that pace, and early
+   // in the connection the estimates are not even there yet; start from the fastest rate that has been seen
+   // to get through, to leave room for the retransmissions
+   m_dPktSndPeriod = (m_iRTT + m_iRCInterval) / m_dCWndSize;
+   if ((m_iBandwidth > 0) && (1000000.0 / m_iBandwidth < m_dPktSndPeriod))
+      m_dPktSndPeriod = 1000000.0 / m_iBandwidth;
+   if ((m_iRcvRate > 0) && (1000000.0 / m_iRcvRate < m_dPktSndPeriod))
+      m_dPktSndPeriod = 1000000.0 / m_iRcvRate;
+}
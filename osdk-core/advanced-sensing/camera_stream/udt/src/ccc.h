@@ -201,6 +201,7 @@ private:
    void setSndCurrSeqNo(int32_t seqno);
    void setRcvRate(int rcvrate);
    void setRTT(int rtt);
+   void setLatency(int latency);
 
 protected:
    const int32_t& m_iSYNInterval;	// UDT constant parameter, SYN
@@ -215,6 +216,7 @@ protected:
    int32_t m_iSndCurrSeqNo;		// current maximum seq no sent out
    int m_iRcvRate;			// packet arrive rate at receiver side, packets per second
    int m_iRTT;				// current estimated RTT, microsecond
+   int m_iLatency;                      // target latency set by UDT_LATENCY, microseconds, 0 if none
 
    char* m_pcParam;			// user defined parameter
    int m_iPSize;			// size of m_pcParam
@@ -275,4 +277,42 @@ private:
    int m_iDecCount;			// number of decreases in a congestion epoch
 };
 
+// Rate control for live video, see UDT_LATENCY. Like any CCC it only paces the sending side.
+class CLiveCC: public CCC
+{
+public:
+   CLiveCC();
+
+public:
+   virtual void init();
+   virtual void onACK(int32_t);
+   virtual void onLoss(const int32_t*, int);
+   virtual void onTimeout();
+
+      // Functionality:
+      //    Query the queueing delay the rate control currently reacts to.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    smoothed RTT above the smallest RTT seen, in microseconds.
+
+   int getQueueDelay() const {return m_iQueueDelay;}
+
+private:
+   int getBudget() const;
+   void leaveSlowStart();
+
+private:
+   static const int m_iDefaultLatency = 100000;   // latency budget if UDT_LATENCY is not set, microseconds
+
+   int m_iRCInterval;			// rate control interval
+   uint64_t m_LastRCTime;		// last rate control time
+   uint64_t m_LastDecTime;		// last rate decrease on queueing delay
+   bool m_bSlowStart;			// if in slow start phase
+   int32_t m_iLastAck;			// last ACKed seq no
+   int32_t m_iLastDecSeq;		// max pkt seq no sent out when last decrease on loss happened
+   int m_iMinRTT;			// smallest RTT seen, the path delay without queueing, 0 if none yet
+   int m_iQueueDelay;			// current RTT above m_iMinRTT
+};
+
 #endif
@@ -55,6 +55,7 @@ written by
 #endif
 #include "channel.h"
 #include "packet.h"
+#include "common.h"
 
 #ifdef WIN32
    #define socklen_t int
@@ -74,6 +75,8 @@ m_iSocket(),
 m_iSndBufSize(65536),
 m_iRcvBufSize(65536)
 {
+   memset(&m_Stat, 0, sizeof(CChannelStat));
+   CGuard::createMutex(m_StatLock);
 }
 
 CChannel::CChannel(int version):
@@ -83,10 +86,13 @@ m_iSndBufSize(65536),
 m_iRcvBufSize(65536)
 {
    m_iSockAddrSize = (AF_INET == m_iIPversion) ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
+   memset(&m_Stat, 0, sizeof(CChannelStat));
+   CGuard::createMutex(m_StatLock);
 }
 
 CChannel::~CChannel()
 {
+   CGuard::releaseMutex(m_StatLock);
 }
 
 void CChannel::open(const sockaddr* addr)
@@ -179,6 +185,12 @@ void CChannel::setUDPSockOpt()
       if (0 != ::setsockopt(m_iSocket, SOL_SOCKET, SO_RCVTIMEO, (char *)&tv, sizeof(timeval)))
          throw CUDTException(1, 3, NET_ERROR);
    #endif
+
+   #ifdef LINUX
+      // let the kernel stamp every datagram, see recvBatch(); without it the packets are stamped on return
+      int on = 1;
+      ::setsockopt(m_iSocket, SOL_SOCKET, SO_TIMESTAMP, (char*)&on, sizeof(int));
+   #endif
 }
 
 void CChannel::close() const
@@ -228,20 +240,7 @@ void CChannel::getPeerAddr(sockaddr* addr) const
 
 int CChannel::sendto(const sockaddr* addr, CPacket& packet) const
 {
-   // convert control information into network order
-   if (packet.getFlag())
-      for (int i = 0, n = packet.getLength() / 4; i < n; ++ i)
-         *((uint32_t *)packet.m_pcData + i) = htonl(*((uint32_t *)packet.m_pcData + i));
-
-   // convert packet header into network order
-   //for (int j = 0; j < 4; ++ j)
-   //   packet.m_nHeader[j] = htonl(packet.m_nHeader[j]);
-   uint32_t* p = packet.m_nHeader;
-   for (int j = 0; j < 4; ++ j)
-   {
-      *p = htonl(*p);
-      ++ p;
-   }
+   toNetworkOrder(packet);
 
    #ifndef WIN32
       msghdr mh;
@@ -262,20 +261,7 @@ int CChannel::sendto(const sockaddr* addr, CPacket& packet) const
    #endif
 
    // convert back into local host order
-   //for (int k = 0; k < 4; ++ k)
-   //   packet.m_nHeader[k] = ntohl(packet.m_nHeader[k]);
-   p = packet.m_nHeader;
-   for (int k = 0; k < 4; ++ k)
-   {
-      *p = ntohl(*p);
-       ++ p;
-   }
-
-   if (packet.getFlag())
-   {
-      for (int l = 0, n = packet.getLength() / 4; l < n; ++ l)
-         *((uint32_t *)packet.m_pcData + l) = ntohl(*((uint32_t *)packet.m_pcData + l));
-   }
+   toHostOrder(packet);
 
    return res;
 }
@@ -321,8 +307,203 @@ int CChannel::recvfrom(sockaddr* addr, CPacket& packet) const
    packet.setLength(res - CPacket::m_iPktHdrSize);
 
    // convert back into local host order
-   //for (int i = 0; i < 4; ++ i)
-   //   packet.m_nHeader[i] = ntohl(packet.m_nHeader[i]);
+   toHostOrder(packet);
+
+   return packet.getLength();
+}
+
+int CChannel::sendBatch(const sockaddr* const* addr, CPacket* const* packet, int num)
+{
+   if (num > m_iMaxBatchSize)
+      num = m_iMaxBatchSize;
+   if (num <= 0)
+      return 0;
+
+   for (int i = 0; i < num; ++ i)
+      toNetworkOrder(*packet[i]);
+
+   int sent = 0;
+
+   #ifdef LINUX
+      mmsghdr mh[m_iMaxBatchSize];
+      for (int i = 0; i < num; ++ i)
+      {
+         mh[i].msg_hdr.msg_name = (sockaddr*)addr[i];
+         mh[i].msg_hdr.msg_namelen = m_iSockAddrSize;
+         mh[i].msg_hdr.msg_iov = (iovec*)packet[i]->m_PacketVector;
+         mh[i].msg_hdr.msg_iovlen = 2;
+         mh[i].msg_hdr.msg_control = NULL;
+         mh[i].msg_hdr.msg_controllen = 0;
+         mh[i].msg_hdr.msg_flags = 0;
+         mh[i].msg_len = 0;
+      }
+
+      int calls = 0;
+      for (int done = 0; done < num; ++ calls)
+      {
+         int res = ::sendmmsg(m_iSocket, mh + done, num - done, 0);
+         if (res > 0)
+         {
+            done += res;
+            sent += res;
+         }
+         else if ((res < 0) && (EINTR == errno))
+         {
+            // interrupted before anything was sent, try the same packets again
+            continue;
+         }
+         else
+         {
+            // the first remaining packet cannot be sent, drop it as sendto() would
+            ++ done;
+         }
+      }
+   #else
+      int calls = num;
+      for (int i = 0; i < num; ++ i)
+      {
+         #ifndef WIN32
+            msghdr mh;
+            mh.msg_name = (sockaddr*)addr[i];
+            mh.msg_namelen = m_iSockAddrSize;
+            mh.msg_iov = (iovec*)packet[i]->m_PacketVector;
+            mh.msg_iovlen = 2;
+            mh.msg_control = NULL;
+            mh.msg_controllen = 0;
+            mh.msg_flags = 0;
+
+            if (::sendmsg(m_iSocket, &mh, 0) >= 0)
+               ++ sent;
+         #else
+            DWORD size = CPacket::m_iPktHdrSize + packet[i]->getLength();
+            if (0 == ::WSASendTo(m_iSocket, (LPWSABUF)packet[i]->m_PacketVector, 2, &size, 0, addr[i], m_iSockAddrSize, NULL, NULL))
+               ++ sent;
+         #endif
+      }
+   #endif
+
+   for (int i = 0; i < num; ++ i)
+      toHostOrder(*packet[i]);
+
+   CGuard statguard(m_StatLock);
+   m_Stat.m_llSendCalls += calls;
+   m_Stat.m_llSendPkts += num;
+   if (num > m_Stat.m_iSendMaxBatch)
+      m_Stat.m_iSendMaxBatch = num;
+
+   return sent;
+}
+
+int CChannel::recvBatch(sockaddr* const* addr, CPacket* const* packet, uint64_t* arrival, int num)
+{
+   if (num > m_iMaxBatchSize)
+      num = m_iMaxBatchSize;
+   if (num <= 0)
+      return -1;
+
+   #ifdef LINUX
+      mmsghdr mh[m_iMaxBatchSize];
+      char ctrl[m_iMaxBatchSize][CMSG_SPACE(sizeof(timeval))];
+      for (int i = 0; i < num; ++ i)
+      {
+         mh[i].msg_hdr.msg_name = addr[i];
+         mh[i].msg_hdr.msg_namelen = m_iSockAddrSize;
+         mh[i].msg_hdr.msg_iov = packet[i]->m_PacketVector;
+         mh[i].msg_hdr.msg_iovlen = 2;
+         mh[i].msg_hdr.msg_control = ctrl[i];
+         mh[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+         mh[i].msg_hdr.msg_flags = 0;
+         mh[i].msg_len = 0;
+      }
+
+      #ifdef UNIX
+         fd_set set;
+         timeval tv;
+         FD_ZERO(&set);
+         FD_SET(m_iSocket, &set);
+         tv.tv_sec = 0;
+         tv.tv_usec = 10000;
+         ::select(m_iSocket+1, &set, NULL, &set, &tv);
+      #endif
+
+      // wait (up to the socket time-out) for the first packet only, then take whatever is already queued
+      int res = ::recvmmsg(m_iSocket, mh, num, MSG_WAITFORONE, NULL);
+      if (res <= 0)
+         return -1;
+
+      for (int i = 0; i < res; ++ i)
+      {
+         // packets read together were not received together, keep the kernel time of each one
+         arrival[i] = 0;
+         for (cmsghdr* cm = CMSG_FIRSTHDR(&mh[i].msg_hdr); NULL != cm; cm = CMSG_NXTHDR(&mh[i].msg_hdr, cm))
+         {
+            if ((SOL_SOCKET == cm->cmsg_level) && (SCM_TIMESTAMP == cm->cmsg_type))
+            {
+               timeval tv;
+               memcpy(&tv, CMSG_DATA(cm), sizeof(timeval));
+               arrival[i] = tv.tv_sec * 1000000ULL + tv.tv_usec;
+            }
+         }
+
+         if (mh[i].msg_len < (unsigned int)CPacket::m_iPktHdrSize)
+         {
+            packet[i]->setLength(-1);
+            continue;
+         }
+
+         packet[i]->setLength(mh[i].msg_len - CPacket::m_iPktHdrSize);
+         toHostOrder(*packet[i]);
+      }
+   #else
+      // one packet per call, the caller simply gets smaller batches
+      int res = (recvfrom(addr[0], *packet[0]) < 0) ? -1 : 1;
+      if (res < 0)
+         return -1;
+      arrival[0] = 0;
+   #endif
+
+   {
+      CGuard statguard(m_StatLock);
+      ++ m_Stat.m_llRecvCalls;
+      m_Stat.m_llRecvPkts += res;
+      if (res > m_Stat.m_iRecvMaxBatch)
+         m_Stat.m_iRecvMaxBatch = res;
+   }
+
+   uint64_t now = CTimer::getTime();
+   for (int i = 0; i < res; ++ i)
+   {
+      if (0 == arrival[i])
+         arrival[i] = now;
+   }
+
+   return res;
+}
+
+void CChannel::getStat(CChannelStat& stat) const
+{
+   CGuard statguard(m_StatLock);
+   stat = m_Stat;
+}
+
+void CChannel::toNetworkOrder(CPacket& packet)
+{
+   // convert control information into network order
+   if (packet.getFlag())
+      for (int i = 0, n = packet.getLength() / 4; i < n; ++ i)
+         *((uint32_t *)packet.m_pcData + i) = htonl(*((uint32_t *)packet.m_pcData + i));
+
+   // convert packet header into network order
+   uint32_t* p = packet.m_nHeader;
+   for (int j = 0; j < 4; ++ j)
+   {
+      *p = htonl(*p);
+      ++ p;
+   }
+}
+
+void CChannel::toHostOrder(CPacket& packet)
+{
    uint32_t* p = packet.m_nHeader;
    for (int i = 0; i < 4; ++ i)
    {
@@ -335,6 +516,4 @@ int CChannel::recvfrom(sockaddr* addr, CPacket& packet) const
       for (int j = 0, n = packet.getLength() / 4; j < n; ++ j)
          *((uint32_t *)packet.m_pcData + j) = ntohl(*((uint32_t *)packet.m_pcData + j));
    }
-
-   return packet.getLength();
 }
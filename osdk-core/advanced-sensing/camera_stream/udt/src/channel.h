@@ -46,8 +46,21 @@ written by
 #include "packet.h"
 
 
+struct CChannelStat
+{
+   int64_t m_llRecvCalls;       // batched receiving calls that returned packets
+   int64_t m_llRecvPkts;        // packets returned by those calls
+   int m_iRecvMaxBatch;         // most packets returned by a single call
+   int64_t m_llSendCalls;       // batched sending calls
+   int64_t m_llSendPkts;        // packets passed to those calls
+   int m_iSendMaxBatch;         // most packets passed to a single call
+};
+
 class CChannel
 {
+public:
+   static const int m_iMaxBatchSize = 16;      // most packets moved by one recvBatch()/sendBatch()
+
 public:
    CChannel();
    CChannel(int version);
@@ -154,9 +167,45 @@ public:
 
    int recvfrom(sockaddr* addr, CPacket& packet) const;
 
+      // Functionality:
+      //    Send several packets with as few system calls as possible (sendmmsg on Linux).
+      // Parameters:
+      //    0) [in] addr: destination address of each packet.
+      //    1) [in] packet: packets to be sent.
+      //    2) [in] num: number of packets, at most m_iMaxBatchSize.
+      // Returned value:
+      //    Number of packets sent.
+
+   int sendBatch(const sockaddr* const* addr, CPacket* const* packet, int num);
+
+      // Functionality:
+      //    Receive up to num packets at once (recvmmsg on Linux) and record their source addresses.
+      // Parameters:
+      //    0) [in] addr: storage for the source address of each packet.
+      //    1) [in] packet: packets with their data buffers and lengths prepared.
+      //    2) [out] arrival: time each packet was received, in microseconds (CTimer::getTime() clock).
+      //    3) [in] num: number of packets, at most m_iMaxBatchSize.
+      // Returned value:
+      //    Number of packets received, -1 if nothing has been received.
+      //    A datagram shorter than the packet header is returned with length -1.
+
+   int recvBatch(sockaddr* const* addr, CPacket* const* packet, uint64_t* arrival, int num);
+
+      // Functionality:
+      //    Read the counters of the batched receiving and sending calls.
+      // Parameters:
+      //    0) [out] stat: copy of the counters.
+      // Returned value:
+      //    None.
+
+   void getStat(CChannelStat& stat) const;
+
 private:
    void setUDPSockOpt();
 
+   static void toNetworkOrder(CPacket& packet);
+   static void toHostOrder(CPacket& packet);
+
 private:
    int m_iIPversion;                    // IP version
    int m_iSockAddrSize;                 // socket address structure size (pre-defined to avoid run-time test)
@@ -165,6 +214,9 @@ private:
 
    int m_iSndBufSize;                   // UDP sending buffer size
    int m_iRcvBufSize;                   // UDP receiving buffer size
+
+   CChannelStat m_Stat;                 // updated by the receiving and the sending queue workers
+   mutable pthread_mutex_t m_StatLock;  // guards m_Stat, also read by perfmon() from user threads
 };
 
 
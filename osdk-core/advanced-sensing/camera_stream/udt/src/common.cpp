@@ -46,6 +46,12 @@ written by
    #ifdef OSX
       #include <mach/mach_time.h>
    #endif
+   #ifdef LINUX
+      #include <ctime>
+      #include <poll.h>
+      #include <sys/eventfd.h>
+      #include <sys/timerfd.h>
+   #endif
 #else
    #include <winsock2.h>
    #include <ws2tcpip.h>
@@ -71,7 +77,9 @@ uint64_t CTimer::s_ullCPUFrequency = CTimer::readCPUFrequency();
 CTimer::CTimer():
 m_ullSchedTime(),
 m_TickCond(),
-m_TickLock()
+m_TickLock(),
+m_iTimerFd(-1),
+m_iWakeFd(-1)
 {
    #ifndef WIN32
       pthread_mutex_init(&m_TickLock, NULL);
@@ -80,10 +88,29 @@ m_TickLock()
       m_TickLock = CreateMutex(NULL, false, NULL);
       m_TickCond = CreateEvent(NULL, false, false, NULL);
    #endif
+
+   #ifdef LINUX
+      // sleep on a timer armed on the exact schedulled time, fall back to polling if it cannot be created
+      m_iTimerFd = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+      m_iWakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if ((m_iTimerFd < 0) || (m_iWakeFd < 0))
+      {
+         if (m_iTimerFd >= 0)
+            ::close(m_iTimerFd);
+         if (m_iWakeFd >= 0)
+            ::close(m_iWakeFd);
+         m_iTimerFd = m_iWakeFd = -1;
+      }
+   #endif
+
+   m_Stat = CTimerStat();
+   CGuard::createMutex(m_StatLock);
 }
 
 CTimer::~CTimer()
 {
+   CGuard::releaseMutex(m_StatLock);
+
    #ifndef WIN32
       pthread_mutex_destroy(&m_TickLock);
       pthread_cond_destroy(&m_TickCond);
@@ -91,6 +118,14 @@ CTimer::~CTimer()
       CloseHandle(m_TickLock);
       CloseHandle(m_TickCond);
    #endif
+
+   #ifdef LINUX
+      if (m_iTimerFd >= 0)
+      {
+         ::close(m_iTimerFd);
+         ::close(m_iWakeFd);
+      }
+   #endif
 }
 
 void CTimer::rdtsc(uint64_t &x)
@@ -101,7 +136,12 @@ void CTimer::rdtsc(uint64_t &x)
       return;
    }
 
-   #ifdef IA32
+   #ifdef LINUX
+      // monotonic, and the same on every CPU architecture: one CC is one nanosecond
+      timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      x = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+   #elif defined(IA32)
       uint32_t lval, hval;
       //asm volatile ("push %eax; push %ebx; push %ecx; push %edx");
       //asm volatile ("xor %eax, %eax; cpuid");
@@ -135,7 +175,9 @@ uint64_t CTimer::readCPUFrequency()
 {
    uint64_t frequency = 1;  // 1 tick per microsecond.
 
-   #if defined(IA32) || defined(IA64) || defined(AMD64)
+   #if defined(LINUX)
+      frequency = 1000;
+   #elif defined(IA32) || defined(IA64) || defined(AMD64)
       uint64_t t1, t2;
 
       rdtsc(t1);
@@ -188,8 +230,40 @@ void CTimer::sleepto(uint64_t nexttime)
    uint64_t t;
    rdtsc(t);
 
+   if (t >= m_ullSchedTime)
+      return;
+
+   uint64_t entertime = t;
+   int64_t wakeups = 0;
+
+   // the timer alone wakes tens of us late, a short sleep wakes up early on it and spins the rest,
+   // never more than a quarter of the sleep so that very short periods do not turn into busy waiting
+   uint64_t spintail = 0;
+   if (m_ullSchedTime - t < m_ullSpinPeriod * s_ullCPUFrequency)
+   {
+      spintail = m_ullSpinTail * s_ullCPUFrequency;
+      if (spintail > (m_ullSchedTime - t) / 4)
+         spintail = (m_ullSchedTime - t) / 4;
+   }
+
    while (t < m_ullSchedTime)
    {
+      if (m_iTimerFd >= 0)
+      {
+         if (t + spintail >= m_ullSchedTime)
+         {
+            rdtsc(t);
+            continue;
+         }
+
+         if (waitFd(m_ullSchedTime - spintail))
+         {
+            ++ wakeups;
+            rdtsc(t);
+            continue;
+         }
+      }
+
       #ifndef NO_BUSY_WAITING
          #ifdef IA32
             __asm__ volatile ("pause; rep; nop; nop; nop; nop; nop;");
@@ -221,8 +295,57 @@ void CTimer::sleepto(uint64_t nexttime)
          #endif
       #endif
 
+      ++ wakeups;
       rdtsc(t);
    }
+
+   CGuard statguard(m_StatLock);
+   ++ m_Stat.m_llSleeps;
+   m_Stat.m_llWakeups += wakeups;
+   m_Stat.m_llIdleTime += (t - entertime) / s_ullCPUFrequency;
+
+   // an interrupted sleep ends early, only the full ones tell how late the timer is
+   if (t >= nexttime)
+   {
+      int64_t late = (t - nexttime) / s_ullCPUFrequency;
+      ++ m_Stat.m_llFullSleeps;
+      m_Stat.m_llLateTotal += late;
+      if (late > m_Stat.m_llLateMax)
+         m_Stat.m_llLateMax = late;
+   }
+}
+
+bool CTimer::waitFd(uint64_t waketime)
+{
+   #ifdef LINUX
+      itimerspec its;
+      memset(&its, 0, sizeof(itimerspec));
+      its.it_value.tv_sec = waketime / 1000000000ULL;
+      its.it_value.tv_nsec = waketime % 1000000000ULL;
+      if (0 != ::timerfd_settime(m_iTimerFd, TFD_TIMER_ABSTIME, &its, NULL))
+         return false;
+
+      // one wake-up at waketime, or earlier if interrupt() is called
+      pollfd fds[2];
+      fds[0].fd = m_iTimerFd;
+      fds[0].events = POLLIN;
+      fds[0].revents = 0;
+      fds[1].fd = m_iWakeFd;
+      fds[1].events = POLLIN;
+      fds[1].revents = 0;
+      if (::poll(fds, 2, -1) < 0)
+         return (EINTR == errno);
+
+      uint64_t count;
+      if (fds[0].revents & POLLIN)
+         ::read(m_iTimerFd, &count, sizeof(uint64_t));
+      if (fds[1].revents & POLLIN)
+         ::read(m_iWakeFd, &count, sizeof(uint64_t));
+
+      return true;
+   #else
+      return false;
+   #endif
 }
 
 void CTimer::interrupt()
@@ -230,6 +353,20 @@ void CTimer::interrupt()
    // schedule the sleepto time to the current CCs, so that it will stop
    rdtsc(m_ullSchedTime);
    tick();
+
+   #ifdef LINUX
+      if (m_iWakeFd >= 0)
+      {
+         uint64_t one = 1;
+         ::write(m_iWakeFd, &one, sizeof(uint64_t));
+      }
+   #endif
+}
+
+void CTimer::getStat(CTimerStat& stat) const
+{
+   CGuard statguard(m_StatLock);
+   stat = m_Stat;
 }
 
 void CTimer::tick()
@@ -64,6 +64,16 @@ written by
 
 ////////////////////////////////////////////////////////////////////////////////
 
+struct CTimerStat
+{
+   int64_t m_llSleeps;          // sleepto() calls that had to wait
+   int64_t m_llFullSleeps;      // sleeps that were not interrupted before their schedulled time
+   int64_t m_llWakeups;         // times the waiting thread was woken up
+   int64_t m_llIdleTime;        // time spent waiting, in microseconds
+   int64_t m_llLateTotal;       // total delay of the full sleeps on their schedulled time, in microseconds
+   int64_t m_llLateMax;         // worst delay, in microseconds
+};
+
 class CTimer
 {
 public:
@@ -108,6 +118,15 @@ public:
 
    void tick();
 
+      // Functionality:
+      //    Read the waiting and wake-up counters of sleepto().
+      // Parameters:
+      //    0) [out] stat: copy of the counters.
+      // Returned value:
+      //    None.
+
+   void getStat(CTimerStat& stat) const;
+
 public:
 
       // Functionality:
@@ -166,6 +185,7 @@ public:
 
 private:
    uint64_t getTimeInMicroSec();
+   bool waitFd(uint64_t waketime);
 
 private:
    uint64_t m_ullSchedTime;             // next schedulled time
@@ -173,6 +193,15 @@ private:
    pthread_cond_t m_TickCond;
    pthread_mutex_t m_TickLock;
 
+   static const uint64_t m_ullSpinPeriod = 2000;  // sleeps shorter than this (us) spin their last m_ullSpinTail
+   static const uint64_t m_ullSpinTail = 50;      // us, covers the usual timerfd wake-up lateness
+
+   int m_iTimerFd;                      // timerfd armed on the schedulled time, -1 if not available
+   int m_iWakeFd;                       // eventfd written by interrupt()
+
+   CTimerStat m_Stat;                   // updated by the sleeping thread
+   mutable pthread_mutex_t m_StatLock;  // guards m_Stat, also read by perfmon() from user threads
+
    static pthread_cond_t m_EventCond;
    static pthread_mutex_t m_EventLock;
 
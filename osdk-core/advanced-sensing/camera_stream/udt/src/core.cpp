@@ -116,6 +116,7 @@ CUDT::CUDT()
    m_iRcvTimeOut = -1;
    m_bReuseAddr = true;
    m_llMaxBW = -1;
+   m_iLatency = 0;
 
    m_pCCFactory = new CCCFactory<CUDTCC>;
    m_pCC = NULL;
@@ -169,6 +170,7 @@ CUDT::CUDT(const CUDT& ancestor)
    m_iRcvTimeOut = ancestor.m_iRcvTimeOut;
    m_bReuseAddr = true;	// this must be true, because all accepted sockets shared the same port with the listener
    m_llMaxBW = ancestor.m_llMaxBW;
+   m_iLatency = ancestor.m_iLatency;
 
    m_pCCFactory = ancestor.m_pCCFactory->clone();
    m_pCC = NULL;
@@ -345,6 +347,16 @@ void CUDT::setOpt(UDTOpt optName, const void* optval, int)
    case UDT_MAXBW:
       m_llMaxBW = *(int64_t*)optval;
       break;
+
+   case UDT_LATENCY:
+      if (m_bConnecting || m_bConnected)
+         throw CUDTException(5, 1, 0);
+
+      if (*(int*)optval < 0)
+         throw CUDTException(5, 3, 0);
+
+      m_iLatency = *(int*)optval;
+      break;
     
    default:
       throw CUDTException(5, 0, 0);
@@ -476,6 +488,11 @@ void CUDT::getOpt(UDTOpt optName, void* optval, int& optlen)
       optlen = sizeof(int32_t);
       break;
 
+   case UDT_LATENCY:
+      *(int*)optval = m_iLatency;
+      optlen = sizeof(int);
+      break;
+
    default:
       throw CUDTException(5, 0, 0);
    }
@@ -501,6 +518,11 @@ void CUDT::open()
    m_LastSampleTime = CTimer::getTime();
    m_llTraceSent = m_llTraceRecv = m_iTraceSndLoss = m_iTraceRcvLoss = m_iTraceRetrans = m_iSentACK = m_iRecvACK = m_iSentNAK = m_iRecvNAK = 0;
    m_llSndDuration = m_llSndDurationTotal = 0;
+   m_iRcvDropTotal = 0;
+   m_iMinRTT = 0;
+   m_iRcvBaseDelay = m_iRcvEpochDelay = 0;
+   m_ullRcvEpochTime = 0;
+   m_iRcvQueueDelay = m_iRcvQueueDelayMax = 0;
 
    // structures for queue
    if (NULL == m_pSNode)
@@ -658,11 +680,15 @@ void CUDT::connect(const sockaddr* serv_addr)
       response.setLength(m_iPayloadSize);
       if (m_pRcvQueue->recvfrom(m_SocketID, response) > 0)
       {
-         if (connect(response) <= 0)
-            break;
+         // the data the server sends right after accepting may overtake its last handshake response, skip it
+         if (m_bRendezvous || ((1 == response.getFlag()) && (0 == response.getType())))
+         {
+            if (connect(response) <= 0)
+               break;
 
-         // new request/response should be sent out immediately on receving a response
-         m_llLastReqTime = 0;
+            // new request/response should be sent out immediately on receving a response
+            m_llLastReqTime = 0;
+         }
       }
 
       if (CTimer::getTime() > ttl)
@@ -788,6 +814,7 @@ POST_CONNECT:
    m_pCC->setRcvRate(m_iDeliveryRate);
    m_pCC->setRTT(m_iRTT);
    m_pCC->setBandwidth(m_iBandwidth);
+   m_pCC->setLatency(m_iLatency * 1000);
    m_pCC->init();
 
    m_ullInterval = (uint64_t)(m_pCC->m_dPktSndPeriod * m_ullCPUFrequency);
@@ -886,6 +913,7 @@ void CUDT::connect(const sockaddr* peer, CHandShake* hs)
    m_pCC->setRcvRate(m_iDeliveryRate);
    m_pCC->setRTT(m_iRTT);
    m_pCC->setBandwidth(m_iBandwidth);
+   m_pCC->setLatency(m_iLatency * 1000);
    m_pCC->init();
 
    m_ullInterval = (uint64_t)(m_pCC->m_dPktSndPeriod * m_ullCPUFrequency);
@@ -1135,6 +1163,74 @@ int CUDT::recv(char* data, int len)
 
    CGuard recvguard(m_RecvLock);
 
+   waitRcvData();
+
+   int res = m_pRcvBuffer->readBuffer(data, len);
+
+   if (m_pRcvBuffer->getRcvDataSize() <= 0)
+   {
+      // read is not available any more
+      s_UDTUnited.m_EPoll.update_events(m_SocketID, m_sPollID, UDT_EPOLL_IN, false);
+   }
+
+   if ((res <= 0) && (m_iRcvTimeOut >= 0))
+      throw CUDTException(6, 3, 0);
+
+   return res;
+}
+
+int CUDT::recvBorrow(CRecvSpan* spans, int num)
+{
+   if (UDT_DGRAM == m_iSockType)
+      throw CUDTException(5, 10, 0);
+
+   // throw an exception if not connected
+   if (!m_bConnected)
+      throw CUDTException(2, 2, 0);
+   else if ((m_bBroken || m_bClosing) && (0 == m_pRcvBuffer->getRcvDataSize()))
+      throw CUDTException(2, 1, 0);
+
+   if (num <= 0)
+      return 0;
+
+   CGuard recvguard(m_RecvLock);
+
+   waitRcvData();
+
+   int res = m_pRcvBuffer->peekBuffer(spans, num);
+
+   if ((res <= 0) && (m_iRcvTimeOut >= 0))
+      throw CUDTException(6, 3, 0);
+
+   return res;
+}
+
+int CUDT::recvRelease(int len)
+{
+   if (UDT_DGRAM == m_iSockType)
+      throw CUDTException(5, 10, 0);
+
+   if (!m_bConnected)
+      throw CUDTException(2, 2, 0);
+
+   if (len <= 0)
+      return 0;
+
+   CGuard recvguard(m_RecvLock);
+
+   int res = m_pRcvBuffer->releaseBuffer(len);
+
+   if (m_pRcvBuffer->getRcvDataSize() <= 0)
+   {
+      // read is not available any more
+      s_UDTUnited.m_EPoll.update_events(m_SocketID, m_sPollID, UDT_EPOLL_IN, false);
+   }
+
+   return res;
+}
+
+void CUDT::waitRcvData()
+{
    if (0 == m_pRcvBuffer->getRcvDataSize())
    {
       if (!m_bSynRecving)
@@ -1191,19 +1287,6 @@ int CUDT::recv(char* data, int len)
       throw CUDTException(2, 2, 0);
    else if ((m_bBroken || m_bClosing) && (0 == m_pRcvBuffer->getRcvDataSize()))
       throw CUDTException(2, 1, 0);
-
-   int res = m_pRcvBuffer->readBuffer(data, len);
-
-   if (m_pRcvBuffer->getRcvDataSize() <= 0)
-   {
-      // read is not available any more
-      s_UDTUnited.m_EPoll.update_events(m_SocketID, m_sPollID, UDT_EPOLL_IN, false);
-   }
-
-   if ((res <= 0) && (m_iRcvTimeOut >= 0))
-      throw CUDTException(6, 3, 0);
-
-   return res;
 }
 
 int CUDT::sendmsg(const char* data, int len, int msttl, bool inorder)
@@ -1294,6 +1377,10 @@ int CUDT::sendmsg(const char* data, int len, int msttl, bool inorder)
    if (0 == m_pSndBuffer->getCurrBufSize())
       m_llSndDurationCounter = CTimer::getTime();
 
+   // live data expires with the latency, unless the message sets its own TTL
+   if ((msttl < 0) && (m_iLatency > 0))
+      msttl = m_iLatency;
+
    // insert the user buffer into the sening list
    m_pSndBuffer->addBuffer(data, len, msttl, inorder);
 
@@ -1620,6 +1707,28 @@ void CUDT::sample(CPerfMon* perf, bool clear)
    perf->msRTT = m_iRTT/1000.0;
    perf->mbpsBandwidth = m_iBandwidth * m_iPayloadSize * 8.0 / 1000000.0;
 
+   CChannelStat rstat, sstat;
+   m_pRcvQueue->m_pChannel->getStat(rstat);
+   m_pSndQueue->m_pChannel->getStat(sstat);
+   perf->sysRecvCallTotal = rstat.m_llRecvCalls;
+   perf->sysRecvPktTotal = rstat.m_llRecvPkts;
+   perf->sysRecvBatchMax = rstat.m_iRecvMaxBatch;
+   perf->sysSendCallTotal = sstat.m_llSendCalls;
+   perf->sysSendPktTotal = sstat.m_llSendPkts;
+   perf->sysSendBatchMax = sstat.m_iSendMaxBatch;
+
+   CTimerStat tstat;
+   m_pSndQueue->m_pTimer->getStat(tstat);
+   perf->usSndIdleTotal = tstat.m_llIdleTime;
+   perf->sndWakeupTotal = tstat.m_llWakeups;
+   perf->usSndLateAvg = (tstat.m_llFullSleeps > 0) ? double(tstat.m_llLateTotal) / tstat.m_llFullSleeps : 0;
+   perf->usSndLateMax = tstat.m_llLateMax;
+
+   perf->pktRcvDropTotal = m_iRcvDropTotal;
+   perf->usSndQueueDelay = (m_iMinRTT > 0) ? m_iRTT - m_iMinRTT : 0;
+   perf->usRcvQueueDelay = m_iRcvQueueDelay;
+   perf->usRcvQueueDelayMax = m_iRcvQueueDelayMax;
+
    #ifndef WIN32
       if (0 == pthread_mutex_trylock(&m_ConnectionLock))
    #else
@@ -1645,6 +1754,7 @@ void CUDT::sample(CPerfMon* perf, bool clear)
    {
       m_llTraceSent = m_llTraceRecv = m_iTraceSndLoss = m_iTraceRcvLoss = m_iTraceRetrans = m_iSentACK = m_iRecvACK = m_iSentNAK = m_iRecvNAK = 0;
       m_llSndDuration = 0;
+      m_iRcvQueueDelayMax = 0;
       m_LastSampleTime = currtime;
    }
 }
@@ -2057,6 +2167,8 @@ void CUDT::processCtrl(CPacket& ctrlpkt)
       int rtt = *((int32_t *)ctrlpkt.m_pcData + 1);
       m_iRTTVar = (m_iRTTVar * 3 + abs(rtt - m_iRTT)) >> 2;
       m_iRTT = (m_iRTT * 7 + rtt) >> 3;
+      if ((0 == m_iMinRTT) || (rtt < m_iMinRTT))
+         m_iMinRTT = rtt;
 
       m_pCC->setRTT(m_iRTT);
 
@@ -2098,6 +2210,8 @@ void CUDT::processCtrl(CPacket& ctrlpkt)
       // RTT EWMA
       m_iRTTVar = (m_iRTTVar * 3 + abs(rtt - m_iRTT)) >> 2;
       m_iRTT = (m_iRTT * 7 + rtt) >> 3;
+      if ((0 == m_iMinRTT) || (rtt < m_iMinRTT))
+         m_iMinRTT = rtt;
 
       m_pCC->setRTT(m_iRTT);
 
@@ -2394,18 +2508,38 @@ int CUDT::processData(CUnit* unit)
 
    m_pCC->onPktReceived(&packet);
    ++ m_iPktCount;
-   // update time information
-   m_pRcvTimeWindow->onPktArrival();
+   // update time information, from the receive time: a batch of packets is processed all at once
+   m_pRcvTimeWindow->onPktArrival(unit->m_ullArrivalTime);
 
    // check if it is probing packet pair
    if (0 == (packet.m_iSeqNo & 0xF))
-      m_pRcvTimeWindow->probe1Arrival();
+      m_pRcvTimeWindow->probe1Arrival(unit->m_ullArrivalTime);
    else if (1 == (packet.m_iSeqNo & 0xF))
-      m_pRcvTimeWindow->probe2Arrival();
+      m_pRcvTimeWindow->probe2Arrival(unit->m_ullArrivalTime);
 
    ++ m_llTraceRecv;
    ++ m_llRecvTotal;
 
+   // queueing delay, from the one-way delay above the smallest one seen
+   // the clocks of both sides drift apart, so the smallest delay is renewed every 10 seconds
+   // taken at the arrival, a packet waiting behind others of the same batch has not been delayed by the network
+   uint64_t now = unit->m_ullArrivalTime;
+   int32_t owd = (int32_t)((uint32_t)(now - m_StartTime) - (uint32_t)packet.m_iTimeStamp);
+   if ((0 == m_ullRcvEpochTime) || (now - m_ullRcvEpochTime > 10000000))
+   {
+      m_iRcvBaseDelay = (0 == m_ullRcvEpochTime) ? owd : m_iRcvEpochDelay;
+      m_iRcvEpochDelay = owd;
+      m_ullRcvEpochTime = now;
+   }
+   if (owd < m_iRcvEpochDelay)
+      m_iRcvEpochDelay = owd;
+   if (owd < m_iRcvBaseDelay)
+      m_iRcvBaseDelay = owd;
+   int queuedelay = owd - m_iRcvBaseDelay;
+   m_iRcvQueueDelay = (m_iRcvQueueDelay * 7 + queuedelay) >> 3;
+   if (queuedelay > m_iRcvQueueDelayMax)
+      m_iRcvQueueDelayMax = queuedelay;
+
    int32_t offset = CSeqNo::seqoff(m_iRcvLastAck, packet.m_iSeqNo);
    if ((offset < 0) || (offset >= m_pRcvBuffer->getAvailBufSize()))
       return -1;
@@ -2430,6 +2564,10 @@ int CUDT::processData(CUnit* unit)
       int loss = CSeqNo::seqlen(m_iRcvCurrSeqNo, packet.m_iSeqNo) - 2;
       m_iTraceRcvLoss += loss;
       m_iRcvLossTotal += loss;
+
+      // live data: the loss is given up if it is not recovered within the latency
+      if ((m_iLatency > 0) && (UDT_STREAM == m_iSockType))
+         m_LossDeadlines.push_back(std::make_pair(CSeqNo::decseq(packet.m_iSeqNo), currtime + m_iLatency * 1000 * m_ullCPUFrequency));
    }
 
    // This is not a regular fixed size packet...   
@@ -2447,6 +2585,29 @@ int CUDT::processData(CUnit* unit)
    return 0;
 }
 
+void CUDT::dropLatePackets(uint64_t currtime)
+{
+   while (!m_LossDeadlines.empty() && (currtime > m_LossDeadlines.front().second))
+   {
+      int32_t last = m_LossDeadlines.front().first;
+
+      // the data after every packet still missing is delivered without it,
+      // and the next ACK moves past the loss, which stops the sender from retransmitting it
+      while (m_pRcvLossList->getLossLength() > 0)
+      {
+         int32_t seqno = m_pRcvLossList->getFirstLostSeq();
+         if (CSeqNo::seqcmp(seqno, last) > 0)
+            break;
+
+         m_pRcvBuffer->skipData(CSeqNo::seqoff(m_iRcvLastAck, seqno));
+         m_pRcvLossList->remove(seqno);
+         ++ m_iRcvDropTotal;
+      }
+
+      m_LossDeadlines.pop_front();
+   }
+}
+
 int CUDT::listen(sockaddr* addr, CPacket& packet)
 {
    if (m_bClosing)
@@ -2541,6 +2702,10 @@ void CUDT::checkTimers()
    uint64_t currtime;
    CTimer::rdtsc(currtime);
 
+   // give up the late losses before the ACK, so that it can already move past them
+   if (!m_LossDeadlines.empty())
+      dropLatePackets(currtime);
+
    if ((currtime > m_ullNextACKTime) || ((m_pCC->m_iACKInterval > 0) && (m_pCC->m_iACKInterval <= m_iPktCount)))
    {
       // ACK timer expired or ACK interval is reached
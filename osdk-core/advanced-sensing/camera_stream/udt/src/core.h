@@ -53,6 +53,7 @@ written by
 #include "ccc.h"
 #include "cache.h"
 #include "queue.h"
+#include <deque>
 
 enum UDTSockType {UDT_STREAM = 1, UDT_DGRAM};
 
@@ -93,6 +94,8 @@ public: //API
    static int recv(UDTSOCKET u, char* buf, int len, int flags);
    static int sendmsg(UDTSOCKET u, const char* buf, int len, int ttl = -1, bool inorder = false);
    static int recvmsg(UDTSOCKET u, char* buf, int len);
+   static int recvborrow(UDTSOCKET u, CRecvSpan* spans, int num);
+   static int recvrelease(UDTSOCKET u, int len);
    static int64_t sendfile(UDTSOCKET u, std::fstream& ifs, int64_t& offset, int64_t size, int block = 364000);
    static int64_t recvfile(UDTSOCKET u, std::fstream& ofs, int64_t& offset, int64_t size, int block = 7280000);
    static int select(int nfds, ud_set* readfds, ud_set* writefds, ud_set* exceptfds, const timeval* timeout);
@@ -187,6 +190,36 @@ private:
 
    int recv(char* data, int len);
 
+      // Functionality:
+      //    Wait like recv() for data, then expose it in the receiver buffer instead of copying it.
+      //    The spans stay valid until they are released, and recv() must not be used meanwhile.
+      // Parameters:
+      //    0) [out] spans: data received, in stream order. Spans returned by earlier calls
+      //       and not released yet are returned again.
+      //    1) [in] num: maximum number of spans.
+      // Returned value:
+      //    Number of spans returned.
+
+   int recvBorrow(CRecvSpan* spans, int num);
+
+      // Functionality:
+      //    Give back the first "len" bytes exposed by recvBorrow, as if recv() had read them.
+      // Parameters:
+      //    0) [in] len: size of data consumed.
+      // Returned value:
+      //    Actual size of data released.
+
+   int recvRelease(int len);
+
+      // Functionality:
+      //    Block until data is ready for reading, the receiving time-out expires or the connection is lost.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    None. Exceptions are thrown as recv() would.
+
+   void waitRcvData();
+
       // Functionality:
       //    send a message of a memory block "data" with size of "len".
       // Parameters:
@@ -298,6 +331,7 @@ private: // Options
    int m_iRcvTimeOut;                           // receiving timeout in milliseconds
    bool m_bReuseAddr;				// reuse an exiting port or not, for UDP multiplexer
    int64_t m_llMaxBW;				// maximum data transfer rate (threshold)
+   int m_iLatency;                              // target latency of live data in milliseconds, 0 if none
 
 private: // congestion control
    CCCVirtualFactory* m_pCCFactory;             // Factory class to create a specific CC instance
@@ -365,6 +399,8 @@ private: // Receiving related data
 
    int32_t m_iPeerISN;                          // Initial Sequence Number of the peer side
 
+   std::deque<std::pair<int32_t, uint64_t> > m_LossDeadlines;  // last seq. no. of each loss and when it is given up, in CPU clock cycles
+
 private: // synchronization: mutexes and conditions
    pthread_mutex_t m_ConnectionLock;            // used to synchronize connection operation
 
@@ -388,6 +424,7 @@ private: // Generation and processing of packets
    void processCtrl(CPacket& ctrlpkt);
    int packData(CPacket& packet, uint64_t& ts);
    int processData(CUnit* unit);
+   void dropLatePackets(uint64_t currtime);
    int listen(sockaddr* addr, CPacket& packet);
 
 private: // Trace
@@ -402,6 +439,13 @@ private: // Trace
    int m_iSentNAKTotal;                         // total number of sent NAK packets
    int m_iRecvNAKTotal;                         // total number of received NAK packets
    int64_t m_llSndDurationTotal;		// total real time for sending
+   int m_iRcvDropTotal;                         // total number of lost packets given up for being too late
+
+   int m_iMinRTT;                               // smallest RTT sample, in microseconds, 0 if none yet
+   int32_t m_iRcvBaseDelay;                     // smallest one-way delay of the data in this and the last epoch, relative clock
+   int32_t m_iRcvEpochDelay;                    // smallest one-way delay of the data in this epoch
+   uint64_t m_ullRcvEpochTime;                  // start of this epoch, 0 before the first data packet
+   int m_iRcvQueueDelay;                        // smoothed one-way delay of the data above m_iRcvBaseDelay
 
    uint64_t m_LastSampleTime;                   // last performance sample time
    int64_t m_llTraceSent;                       // number of pakctes sent in the last trace interval
@@ -415,6 +459,7 @@ private: // Trace
    int m_iRecvNAK;                              // number of NAKs received in the last trace interval
    int64_t m_llSndDuration;			// real time for sending
    int64_t m_llSndDurationCounter;		// timers to record the sending duration
+   int m_iRcvQueueDelayMax;                     // largest one-way queueing delay in the last trace interval
 
 private: // Timers
    uint64_t m_ullCPUFrequency;                  // CPU clock frequency, used for Timer, ticks per microsecond
@@ -222,6 +222,48 @@ CUnit* CUnitQueue::getNextAvailUnit()
    return NULL;
 }
 
+int CUnitQueue::getNextAvailUnits(CUnit** units, int num)
+{
+   if (m_iCount * 10 > m_iSize * 9)
+      increase();
+
+   if (m_iCount >= m_iSize)
+      return 0;
+
+   // walk every unit once, starting from the recent available one
+   CQEntry* q = m_pCurrQueue;
+   CUnit* u = m_pAvailUnit;
+   CQEntry* firstq = NULL;
+   int found = 0;
+
+   for (int checked = 0; (checked < m_iSize) && (found < num); ++ checked)
+   {
+      if (0 == u->m_iFlag)
+      {
+         if (0 == found)
+            firstq = q;
+         units[found ++] = u;
+      }
+
+      if (++ u == q->m_pUnit + q->m_iSize)
+      {
+         q = q->m_pNext;
+         u = q->m_pUnit;
+      }
+   }
+
+   if (0 == found)
+   {
+      increase();
+      return 0;
+   }
+
+   m_pCurrQueue = firstq;
+   m_pAvailUnit = units[0];
+
+   return found;
+}
+
 
 CSndUList::CSndUList():
 m_pHeap(NULL),
@@ -530,13 +572,21 @@ void CSndQueue::init(CChannel* c, CTimer* t)
          if (currtime < ts)
             self->m_pTimer->sleepto(ts);
 
-         // it is time to send the next pkt
-         sockaddr* addr;
-         CPacket pkt;
-         if (self->m_pSndUList->pop(addr, pkt) < 0)
+         // it is time to send the next pkt, plus any other already due, in one batch
+         sockaddr* addr[CChannel::m_iMaxBatchSize];
+         CPacket pkt[CChannel::m_iMaxBatchSize];
+         CPacket* packet[CChannel::m_iMaxBatchSize];
+         int num = 0;
+         while ((num < CChannel::m_iMaxBatchSize) && (self->m_pSndUList->pop(addr[num], pkt[num]) >= 0))
+         {
+            packet[num] = pkt + num;
+            ++ num;
+         }
+
+         if (0 == num)
             continue;
 
-         self->m_pChannel->sendto(addr, pkt);
+         self->m_pChannel->sendBatch(addr, packet, num);
       }
       else
       {
@@ -974,9 +1024,14 @@ void CRcvQueue::init(int qsize, int payload, int version, int hsize, CChannel* c
 {
    CRcvQueue* self = (CRcvQueue*)param;
 
-   sockaddr* addr = (AF_INET == self->m_UnitQueue.m_iIPversion) ? (sockaddr*) new sockaddr_in : (sockaddr*) new sockaddr_in6;
-   CUDT* u = NULL;
-   int32_t id;
+   // sockaddr_in6 is large enough for both IP versions
+   sockaddr_in6* addrbuf = new sockaddr_in6[CChannel::m_iMaxBatchSize];
+   sockaddr* addr[CChannel::m_iMaxBatchSize];
+   CUnit* unit[CChannel::m_iMaxBatchSize];
+   CPacket* packet[CChannel::m_iMaxBatchSize];
+   uint64_t arrival[CChannel::m_iMaxBatchSize];
+   for (int i = 0; i < CChannel::m_iMaxBatchSize; ++ i)
+      addr[i] = (sockaddr*)(addrbuf + i);
 
    while (!self->m_bClosing)
    {
@@ -985,77 +1040,40 @@ void CRcvQueue::init(int qsize, int payload, int version, int hsize, CChannel* c
       #endif
 
       // check waiting list, if new socket, insert it to the list
-      while (self->ifNewEntry())
-      {
-         CUDT* ne = self->getNewEntry();
-         if (NULL != ne)
-         {
-            self->m_pRcvUList->insert(ne);
-            self->m_pHash->insert(ne->m_SocketID, ne);
-         }
-      }
+      self->insertNewEntries();
 
-      // find next available slot for incoming packet
-      CUnit* unit = self->m_UnitQueue.getNextAvailUnit();
-      if (NULL == unit)
+      // find available slots for the next incoming packets
+      int num = self->m_UnitQueue.getNextAvailUnits(unit, CChannel::m_iMaxBatchSize);
+      if (0 == num)
       {
          // no space, skip this packet
          CPacket temp;
          temp.m_pcData = new char[self->m_iPayloadSize];
          temp.setLength(self->m_iPayloadSize);
-         self->m_pChannel->recvfrom(addr, temp);
+         self->m_pChannel->recvfrom(addr[0], temp);
          delete [] temp.m_pcData;
          goto TIMER_CHECK;
       }
 
-      unit->m_Packet.setLength(self->m_iPayloadSize);
-
-      // reading next incoming packet, recvfrom returns -1 is nothing has been received
-      if (self->m_pChannel->recvfrom(addr, unit->m_Packet) < 0)
-         goto TIMER_CHECK;
-
-      id = unit->m_Packet.m_iID;
-
-      // ID 0 is for connection request, which should be passed to the listening socket or rendezvous sockets
-      if (0 == id)
+      for (int i = 0; i < num; ++ i)
       {
-         if (NULL != self->m_pListener)
-            self->m_pListener->listen(addr, unit->m_Packet);
-         else if (NULL != (u = self->m_pRendezvousQueue->retrieve(addr, id)))
-         {
-            // asynchronous connect: call connect here
-            // otherwise wait for the UDT socket to retrieve this packet
-            if (!u->m_bSynRecving)
-               u->connect(unit->m_Packet);
-            else
-               self->storePkt(id, unit->m_Packet.clone());
-         }
+         unit[i]->m_Packet.setLength(self->m_iPayloadSize);
+         packet[i] = &(unit[i]->m_Packet);
       }
-      else if (id > 0)
+
+      // reading the next incoming packets, recvBatch returns -1 if nothing has been received
+      num = self->m_pChannel->recvBatch(addr, packet, arrival, num);
+
+      for (int i = 0; i < num; ++ i)
       {
-         if (NULL != (u = self->m_pHash->lookup(id)))
-         {
-            if (CIPAddress::ipcmp(addr, u->m_pPeerAddr, u->m_iIPversion))
-            {
-               if (u->m_bConnected && !u->m_bBroken && !u->m_bClosing)
-               {
-                  if (0 == unit->m_Packet.getFlag())
-                     u->processData(unit);
-                  else
-                     u->processCtrl(unit->m_Packet);
-
-                  u->checkTimers();
-                  self->m_pRcvUList->update(u);
-               }
-            }
-         }
-         else if (NULL != (u = self->m_pRendezvousQueue->retrieve(addr, id)))
-         {
-            if (!u->m_bSynRecving)
-               u->connect(unit->m_Packet);
-            else
-               self->storePkt(id, unit->m_Packet.clone());
-         }
+         unit[i]->m_ullArrivalTime = arrival[i];
+
+         // a connection completed by the previous packet may already own this one
+         if (i > 0)
+            self->insertNewEntries();
+
+         if (unit[i]->m_Packet.getLength() >= 0)
+            self->processUnit(addr[i], unit[i]);
       }
 
 TIMER_CHECK:
@@ -1090,10 +1108,7 @@ TIMER_CHECK:
       self->m_pRendezvousQueue->updateConnStatus();
    }
 
-   if (AF_INET == self->m_UnitQueue.m_iIPversion)
-      delete (sockaddr_in*)addr;
-   else
-      delete (sockaddr_in6*)addr;
+   delete [] addrbuf;
 
    #ifndef WIN32
       return NULL;
@@ -1103,6 +1118,67 @@ TIMER_CHECK:
    #endif
 }
 
+void CRcvQueue::insertNewEntries()
+{
+   while (ifNewEntry())
+   {
+      CUDT* ne = getNewEntry();
+      if (NULL != ne)
+      {
+         m_pRcvUList->insert(ne);
+         m_pHash->insert(ne->m_SocketID, ne);
+      }
+   }
+}
+
+void CRcvQueue::processUnit(sockaddr* addr, CUnit* unit)
+{
+   CUDT* u = NULL;
+   int32_t id = unit->m_Packet.m_iID;
+
+   // ID 0 is for connection request, which should be passed to the listening socket or rendezvous sockets
+   if (0 == id)
+   {
+      if (NULL != m_pListener)
+         m_pListener->listen(addr, unit->m_Packet);
+      else if (NULL != (u = m_pRendezvousQueue->retrieve(addr, id)))
+      {
+         // asynchronous connect: call connect here
+         // otherwise wait for the UDT socket to retrieve this packet
+         if (!u->m_bSynRecving)
+            u->connect(unit->m_Packet);
+         else
+            storePkt(id, unit->m_Packet.clone());
+      }
+   }
+   else if (id > 0)
+   {
+      if (NULL != (u = m_pHash->lookup(id)))
+      {
+         if (CIPAddress::ipcmp(addr, u->m_pPeerAddr, u->m_iIPversion))
+         {
+            if (u->m_bConnected && !u->m_bBroken && !u->m_bClosing)
+            {
+               if (0 == unit->m_Packet.getFlag())
+                  u->processData(unit);
+               else
+                  u->processCtrl(unit->m_Packet);
+
+               u->checkTimers();
+               m_pRcvUList->update(u);
+            }
+         }
+      }
+      else if (NULL != (u = m_pRendezvousQueue->retrieve(addr, id)))
+      {
+         if (!u->m_bSynRecving)
+            u->connect(unit->m_Packet);
+         else
+            storePkt(id, unit->m_Packet.clone());
+      }
+   }
+}
+
 int CRcvQueue::recvfrom(int32_t id, CPacket& packet)
 {
    CGuard bufferlock(m_PassLock);
@@ -55,6 +55,7 @@ class CUDT;
 struct CUnit
 {
    CPacket m_Packet;		// packet
+   uint64_t m_ullArrivalTime;	// time the packet was received, in microseconds
    int m_iFlag;			// 0: free, 1: occupied, 2: msg read but not freed (out-of-order), 3: msg dropped
 };
 
@@ -107,6 +108,16 @@ public:
 
    CUnit* getNextAvailUnit();
 
+      // Functionality:
+      //    find several distinct available units for a batch of incoming packets.
+      // Parameters:
+      //    0) [out] units: the available units found.
+      //    1) [in] num: maximum number of units wanted.
+      // Returned value:
+      //    Number of units found, 0 if none is available.
+
+   int getNextAvailUnits(CUnit** units, int num);
+
 private:
    struct CQEntry
    {
@@ -491,6 +502,9 @@ private:
 
    void storePkt(int32_t id, CPacket* pkt);
 
+   void insertNewEntries();
+   void processUnit(sockaddr* addr, CUnit* unit);
+
 private:
    pthread_mutex_t m_LSLock;
    CUDT* m_pListener;                                   // pointer to the (unique, if any) listening UDT entity
@@ -151,7 +151,8 @@ enum UDTOpt
    UDT_STATE,		// current socket state, see UDTSTATUS, read only
    UDT_EVENT,		// current avalable events associated with the socket
    UDT_SNDDATA,		// size of data in the sending buffer
-   UDT_RCVDATA		// size of data available for recv
+   UDT_RCVDATA,		// size of data available for recv
+   UDT_LATENCY		// target latency (milliseconds) of live data, lost data later than that is given up
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -194,6 +195,34 @@ struct CPerfMon
    double mbpsBandwidth;                // estimated bandwidth, in Mb/s
    int byteAvailSndBuf;                 // available UDT sender buffer size
    int byteAvailRcvBuf;                 // available UDT receiver buffer size
+
+   // UDP channel batching, shared by all UDT sockets on the same UDP port
+   int64_t sysRecvCallTotal;            // receiving system calls that returned packets
+   int64_t sysRecvPktTotal;             // packets returned by those calls
+   int sysRecvBatchMax;                 // most packets returned by a single call
+   int64_t sysSendCallTotal;            // system calls of the sending queue
+   int64_t sysSendPktTotal;             // data packets passed to those calls
+   int sysSendBatchMax;                 // most packets passed to a single call
+
+   // pacing timer of the sending queue, shared by all UDT sockets on the same UDP port
+   int64_t usSndIdleTotal;              // time spent waiting for the next schedulled packet
+   int64_t sndWakeupTotal;              // times the sending queue woke up while waiting
+   double usSndLateAvg;                 // average delay of the wake-ups on the schedulled time
+   int64_t usSndLateMax;                // worst delay of a wake-up
+
+   // live data, see UDT_LATENCY
+   int pktRcvDropTotal;                 // lost packets given up by the receiver for being later than the latency
+   double usSndQueueDelay;              // RTT above the smallest RTT seen, i.e. queueing on the path
+   double usRcvQueueDelay;              // one-way delay of the received data above the smallest seen
+   int usRcvQueueDelayMax;              // largest one-way queueing delay in the last trace interval
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct CRecvSpan
+{
+   const char* data;                    // start of the received data in a receiver buffer unit
+   int len;                             // size of the data
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -303,6 +332,7 @@ namespace UDT
 typedef CUDTException ERRORINFO;
 typedef UDTOpt SOCKOPT;
 typedef CPerfMon TRACEINFO;
+typedef CRecvSpan RECVSPAN;
 typedef ud_set UDSET;
 
 UDT_API extern const UDTSOCKET INVALID_SOCK;
@@ -326,6 +356,8 @@ UDT_API int send(UDTSOCKET u, const char* buf, int len, int flags);
 UDT_API int recv(UDTSOCKET u, char* buf, int len, int flags);
 UDT_API int sendmsg(UDTSOCKET u, const char* buf, int len, int ttl = -1, bool inorder = false);
 UDT_API int recvmsg(UDTSOCKET u, char* buf, int len);
+UDT_API int recvborrow(UDTSOCKET u, RECVSPAN* spans, int num);
+UDT_API int recvrelease(UDTSOCKET u, int len);
 UDT_API int64_t sendfile(UDTSOCKET u, std::fstream& ifs, int64_t& offset, int64_t size, int block = 364000);
 UDT_API int64_t recvfile(UDTSOCKET u, std::fstream& ofs, int64_t& offset, int64_t size, int block = 7280000);
 UDT_API int64_t sendfile2(UDTSOCKET u, const char* path, int64_t* offset, int64_t size, int block = 364000);
@@ -136,29 +136,29 @@ public:
       // Functionality:
       //    Record time information of an arrived packet.
       // Parameters:
-      //    None.
+      //    0) arrtime: time the packet was received, in microseconds.
       // Returned value:
       //    None.
 
-   void onPktArrival();
+   void onPktArrival(uint64_t arrtime);
 
       // Functionality:
       //    Record the arrival time of the first probing packet.
       // Parameters:
-      //    None.
+      //    0) arrtime: time the packet was received, in microseconds.
       // Returned value:
       //    None.
 
-   void probe1Arrival();
+   void probe1Arrival(uint64_t arrtime);
 
       // Functionality:
       //    Record the arrival time of the second probing packet and the interval between packet pairs.
       // Parameters:
-      //    None.
+      //    0) arrtime: time the packet was received, in microseconds.
       // Returned value:
       //    None.
 
-   void probe2Arrival();
+   void probe2Arrival(uint64_t arrtime);
 
 private:
    int m_iAWSize;               // size of the packet arrival history window
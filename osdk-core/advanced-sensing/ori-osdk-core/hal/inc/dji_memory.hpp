@@ -39,6 +39,27 @@ namespace OSDK
 
 #define PRO_PURE_DATA_MAX_SIZE 1007 // 2^10 - header size
 
+/*! @brief Counters of the session memory pool
+ */
+typedef struct MMUStat
+{
+  uint32_t allocs;         /*!< successful allocMemory() calls */
+  uint32_t frees;          /*!< blocks given back through freeMemory() */
+  uint32_t failures;       /*!< allocMemory() calls that returned NULL */
+  uint32_t spills;         /*!< allocations served from a larger class */
+  uint16_t blocksInUse;
+  uint16_t blocksHighWater;
+  uint32_t bytesInUse;     /*!< requested sizes, not block sizes */
+  uint32_t bytesHighWater;
+} MMUStat;
+
+/*! @brief Fixed pool of session buffers in a few size classes.
+ *
+ * Every class keeps a free list of its blocks, so allocMemory() and
+ * freeMemory() are O(1) and never move a live buffer. A request takes a
+ * block of the smallest class it fits, or of the next larger class with
+ * a free block. Callers serialize access, as with the session tables.
+ */
 class MMU
 {
 public:
@@ -47,13 +68,29 @@ public:
   void freeMemory(MMU_Tab* mmu_tab);
   MMU_Tab* allocMemory(uint16_t size);
 
+  MMUStat getStat() const;
+
 public:
-  static const int MMU_TABLE_NUM = 32;
-  static const int MEMORY_SIZE   = 1024;
+  static const int CLASS_NUM     = 4;
+  static const int MMU_TABLE_NUM = 16 + 8 + 6 + 4;
+  static const int MEMORY_SIZE   = 16 * 64 + 8 * 128 + 6 * 256 + 4 * 1024;
+
+  //! Block size and block count of every class, smallest first
+  static const uint16_t CLASS_SIZE[CLASS_NUM];
+  static const uint8_t  CLASS_BLOCKS[CLASS_NUM];
 
 private:
-  MMU_Tab memoryTable[MMU_TABLE_NUM];
-  uint8_t memory[MEMORY_SIZE];
+  static const uint8_t FREE_END = 0xFF;
+
+  MMU_Tab  memoryTable[MMU_TABLE_NUM];
+  uint8_t  memory[MEMORY_SIZE];
+
+  //! Free list heads per class, and the next free block of every block
+  uint8_t  freeHead[CLASS_NUM];
+  uint8_t  freeNext[MMU_TABLE_NUM];
+  uint8_t  blockClass[MMU_TABLE_NUM];
+
+  MMUStat  stat;
 };
 
 } // OSDK
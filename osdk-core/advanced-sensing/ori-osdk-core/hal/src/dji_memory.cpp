@@ -38,27 +38,41 @@
 
 using namespace DJI::OSDK;
 
+const uint16_t MMU::CLASS_SIZE[MMU::CLASS_NUM]   = { 64, 128, 256, 1024 };
+const uint8_t  MMU::CLASS_BLOCKS[MMU::CLASS_NUM] = { 16, 8, 6, 4 };
+
 MMU::MMU()
 {
+  setupMMU();
 }
 
 void
 MMU::setupMMU()
 {
-  uint32_t i;
-  memoryTable[0].tabIndex  = 0;
-  memoryTable[0].usageFlag = 1;
-  memoryTable[0].pmem      = memory;
-  memoryTable[0].memSize   = 0;
-  for (i = 1; i < (MMU_TABLE_NUM - 1); i++)
+  uint32_t offset = 0;
+  uint8_t  index  = 0;
+
+  memset(&stat, 0, sizeof(stat));
+
+  //! Carve the arena class by class and chain each class's blocks
+  for (uint8_t c = 0; c < CLASS_NUM; c++)
   {
-    memoryTable[i].tabIndex  = i;
-    memoryTable[i].usageFlag = 0;
+    freeHead[c] = FREE_END;
+    for (uint8_t b = 0; b < CLASS_BLOCKS[c]; b++)
+    {
+      memoryTable[index].tabIndex  = index;
+      memoryTable[index].usageFlag = 0;
+      memoryTable[index].memSize   = 0;
+      memoryTable[index].pmem      = memory + offset;
+      blockClass[index]            = c;
+
+      freeNext[index] = freeHead[c];
+      freeHead[c]     = index;
+
+      offset += CLASS_SIZE[c];
+      index++;
+    }
   }
-  memoryTable[MMU_TABLE_NUM - 1].tabIndex  = MMU_TABLE_NUM - 1;
-  memoryTable[MMU_TABLE_NUM - 1].usageFlag = 1;
-  memoryTable[MMU_TABLE_NUM - 1].pmem      = memory + MEMORY_SIZE;
-  memoryTable[MMU_TABLE_NUM - 1].memSize   = 0;
 }
 
 void
@@ -68,135 +82,78 @@ MMU::freeMemory(MMU_Tab* mmu_tab)
   {
     return;
   }
-  if (mmu_tab->tabIndex == 0 || mmu_tab->tabIndex == (MMU_TABLE_NUM - 1))
+  if (mmu_tab->tabIndex >= MMU_TABLE_NUM ||
+      mmu_tab != &memoryTable[mmu_tab->tabIndex] || mmu_tab->usageFlag == 0)
   {
+    //! Not one of ours, or already freed
     return;
   }
+
+  uint8_t index = mmu_tab->tabIndex;
+  uint8_t c     = blockClass[index];
+
+  stat.bytesInUse -= mmu_tab->memSize;
+  stat.blocksInUse--;
+  stat.frees++;
+
   mmu_tab->usageFlag = 0;
+  mmu_tab->memSize   = 0;
+  freeNext[index]    = freeHead[c];
+  freeHead[c]        = index;
 }
 
 MMU_Tab*
 MMU::allocMemory(uint16_t size)
 {
-  uint32_t mem_used = 0;
-  uint8_t  i;
-  uint8_t  j                = 0;
-  uint8_t  mmu_tab_used_num = 0;
-  uint8_t  mmu_tab_used_index[MMU_TABLE_NUM];
-
-  uint32_t temp32;
-  uint32_t temp_area[2] = { 0xFFFFFFFF, 0xFFFFFFFF };
-
-  uint32_t record_temp32 = 0;
-  uint8_t  magic_flag    = 0;
-
-  if (size > PRO_PURE_DATA_MAX_SIZE || size > MEMORY_SIZE)
+  if (size > PRO_PURE_DATA_MAX_SIZE || size > CLASS_SIZE[CLASS_NUM - 1])
   {
-    return (MMU_Tab *) 0;
+    stat.failures++;
+    return (MMU_Tab*)0;
   }
 
-  for (i = 0; i < MMU_TABLE_NUM; i++)
+  uint8_t c = 0;
+  while (CLASS_SIZE[c] < size)
   {
-    if (memoryTable[i].usageFlag == 1)
-    {
-      mem_used += memoryTable[i].memSize;
-      mmu_tab_used_index[mmu_tab_used_num++] = memoryTable[i].tabIndex;
-    }
+    c++;
   }
-
-  if (MEMORY_SIZE < (mem_used + size))
+  uint8_t fit = c;
+  while (c < CLASS_NUM && freeHead[c] == FREE_END)
   {
-    return (MMU_Tab *) 0;
+    c++;
   }
-
-  if (mem_used == 0)
+  if (c == CLASS_NUM)
   {
-    memoryTable[1].pmem      = memoryTable[0].pmem;
-    memoryTable[1].memSize   = size;
-    memoryTable[1].usageFlag = 1;
-    return &memoryTable[1];
+    stat.failures++;
+    return (MMU_Tab*)0;
   }
 
-  for (i = 0; i < (mmu_tab_used_num - 1); i++)
-  {
-    for (j = 0; j < (mmu_tab_used_num - i - 1); j++)
-    {
-      if (memoryTable[mmu_tab_used_index[j]].pmem >
-          memoryTable[mmu_tab_used_index[j + 1]].pmem)
-      {
-        mmu_tab_used_index[j + 1] ^= mmu_tab_used_index[j];
-        mmu_tab_used_index[j] ^= mmu_tab_used_index[j + 1];
-        mmu_tab_used_index[j + 1] ^= mmu_tab_used_index[j];
-      }
-    }
-  }
-  for (i = 0; i < (mmu_tab_used_num - 1); i++)
-  {
-    temp32 = static_cast<uint32_t>(memoryTable[mmu_tab_used_index[i + 1]].pmem -
-                                   memoryTable[mmu_tab_used_index[i]].pmem);
+  uint8_t index = freeHead[c];
+  freeHead[c]   = freeNext[index];
 
-    if ((temp32 - memoryTable[mmu_tab_used_index[i]].memSize) >= size)
-    {
-      if (temp_area[1] > (temp32 - memoryTable[mmu_tab_used_index[i]].memSize))
-      {
-        temp_area[0] = memoryTable[mmu_tab_used_index[i]].tabIndex;
-        temp_area[1] = temp32 - memoryTable[mmu_tab_used_index[i]].memSize;
-      }
-    }
+  memoryTable[index].usageFlag = 1;
+  memoryTable[index].memSize   = size;
 
-    record_temp32 += temp32 - memoryTable[mmu_tab_used_index[i]].memSize;
-    if (record_temp32 >= size && magic_flag == 0)
-    {
-      j          = i;
-      magic_flag = 1;
-    }
+  stat.allocs++;
+  if (c != fit)
+  {
+    stat.spills++;
   }
-
-  if (temp_area[0] == 0xFFFFFFFF && temp_area[1] == 0xFFFFFFFF)
+  stat.blocksInUse++;
+  stat.bytesInUse += size;
+  if (stat.blocksInUse > stat.blocksHighWater)
   {
-    for (i = 0; i < j; i++)
-    {
-      if (memoryTable[mmu_tab_used_index[i + 1]].pmem >
-          (memoryTable[mmu_tab_used_index[i]].pmem +
-           memoryTable[mmu_tab_used_index[i]].memSize))
-      {
-        memmove(memoryTable[mmu_tab_used_index[i]].pmem +
-                  memoryTable[mmu_tab_used_index[i]].memSize,
-                memoryTable[mmu_tab_used_index[i + 1]].pmem,
-                memoryTable[mmu_tab_used_index[i + 1]].memSize);
-        memoryTable[mmu_tab_used_index[i + 1]].pmem =
-          memoryTable[mmu_tab_used_index[i]].pmem +
-          memoryTable[mmu_tab_used_index[i]].memSize;
-      }
-    }
-
-    for (i = 1; i < (MMU_TABLE_NUM - 1); i++)
-    {
-      if (memoryTable[i].usageFlag == 0)
-      {
-        memoryTable[i].pmem = memoryTable[mmu_tab_used_index[j]].pmem +
-                              memoryTable[mmu_tab_used_index[j]].memSize;
-
-        memoryTable[i].memSize   = size;
-        memoryTable[i].usageFlag = 1;
-        return &memoryTable[i];
-      }
-    }
-    return (MMU_Tab*)0;
+    stat.blocksHighWater = stat.blocksInUse;
   }
-
-  for (i = 1; i < (MMU_TABLE_NUM - 1); i++)
+  if (stat.bytesInUse > stat.bytesHighWater)
   {
-    if (memoryTable[i].usageFlag == 0)
-    {
-      memoryTable[i].pmem =
-        memoryTable[temp_area[0]].pmem + memoryTable[temp_area[0]].memSize;
-
-      memoryTable[i].memSize   = size;
-      memoryTable[i].usageFlag = 1;
-      return &memoryTable[i];
-    }
+    stat.bytesHighWater = stat.bytesInUse;
   }
 
-  return (MMU_Tab*)0;
+  return &memoryTable[index];
+}
+
+MMUStat
+MMU::getStat() const
+{
+  return stat;
 }
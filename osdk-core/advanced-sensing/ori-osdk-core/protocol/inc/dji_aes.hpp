@@ -54,4 +54,13 @@ void aes256_done(aes256_context* ctx);
 void aes256_encrypt_ecb(aes256_context* ctx, uint8_t* buf);
 void aes256_decrypt_ecb(aes256_context* ctx, uint8_t* buf);
 
+/*! Multi-block ECB with the 32 byte key k, same output as running
+ *  aes256_encrypt_ecb/aes256_decrypt_ecb over each 16 byte block of buf.
+ *  Uses AES-NI (x86, detected at runtime) or the ARMv8 crypto extensions
+ *  (when built with them), else the byte-oriented code above.
+ */
+void aes256_encrypt_ecb_blocks(const uint8_t* k, uint8_t* buf, uint32_t blocks);
+void aes256_decrypt_ecb_blocks(const uint8_t* k, uint8_t* buf, uint32_t blocks);
+const char* aes256_backend();
+
 #endif // ONBOARDSDK_AES256_H
@@ -27,6 +27,9 @@
 #ifndef ONBOARDSDK_DJI_CRC_H
 #define ONBOARDSDK_DJI_CRC_H
 
+#include <cstddef>
+#include <stdint.h>
+
 namespace DJI
 {
 namespace OSDK
@@ -176,6 +179,23 @@ const uint8_t  CRC8_INIT  = 0x77;
 const uint16_t CRC16_INIT = 0x3692;
 const uint16_t CRC_INIT   = 0x3AA3;
 
+//----------------------------------------------------------------------
+// Block CRC
+//----------------------------------------------------------------------
+
+/*! @brief Run crc over len bytes, bit-exact with feeding them one by one
+ *  through crc_tab16/crc_tab32. No reflection or final xor is applied.
+ *
+ *  CRC16 uses slice-by-8 tables. CRC32 picks at first use the fastest of
+ *  PCLMUL folding (x86), the ARMv8 CRC32 instructions (when built with
+ *  them) and slice-by-8.
+ */
+uint16_t crc16Compute(uint16_t crc, const uint8_t* buf, size_t len);
+uint32_t crc32Compute(uint32_t crc, const uint8_t* buf, size_t len);
+
+//! Name of the CRC32 implementation in use, for logs and profiling
+const char* crc32Backend();
+
 } // OSDK
 } // DJI
 
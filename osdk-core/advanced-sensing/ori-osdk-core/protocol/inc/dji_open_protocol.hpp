@@ -185,6 +185,12 @@ private:
   //! A lot of ACK parsing logic
   bool appHandler(void* protocolHeader);
 
+  //! Bulk frame scanner hooks, replace steps 5 - 8
+  int      frameSOF();
+  uint32_t frameLength(const uint8_t* head);
+  bool     frameVerify(const uint8_t* frame, uint32_t len);
+  bool     frameHandler(uint8_t* frame, uint32_t len);
+
   //! For CMD-Frame data (push data) handling
   bool recvReqData(OpenHeader* protocolHeader);
 
@@ -159,6 +159,30 @@ protected:
   //! helper function for buffer management
   void reuseDataStream();
 
+  /************************** Bulk frame scanner ****************************/
+  /*! @note Protocols that know their SOF can skip steps 2 - 7: whole reads
+   *  land in one contiguous buffer, the next SOF is found with memchr, each
+   *  candidate header is checked once and complete frames are handed over
+   *  in place. Consumed bytes are only moved when the tail runs out of room.
+   */
+protected:
+  //! First byte of every frame, -1 keeps the byte by byte pipeline
+  virtual int frameSOF();
+
+  //! Full frame length if head holds HEADER_LEN bytes of a valid header,
+  //! 0 if the header is corrupted
+  virtual uint32_t frameLength(const uint8_t* head);
+
+  //! Verify the payload of a complete frame
+  virtual bool frameVerify(const uint8_t* frame, uint32_t len);
+
+  //! Dispatch a verified frame, return true if it filled p_recvContainer
+  virtual bool frameHandler(uint8_t* frame, uint32_t len);
+
+private:
+  bool bulkReadPoll();
+  bool scanFrames();
+
   /********************************** CRC **********************************/
 protected:
   virtual int crcHeadCheck(uint8_t* pMsg, size_t nLen) = 0;
@@ -187,6 +211,13 @@ public:
 
   int getReadLen();
 
+  //! Device reads that returned data so far, wraps around
+  uint32_t getReadCount();
+
+  //! True while received bytes are left to parse, a reader must not block
+  //! on the device then
+  bool hasPendingData();
+
   RecvContainer* getReceivedFrame();
 
   /******************************* Member variables ************************/
@@ -204,6 +235,7 @@ protected:
   //! Buffer management
   int            buf_read_pos;
   int            read_len;
+  uint32_t       read_count;
   int            BUFFER_SIZE; // this should not be changed, init this in constructor
   uint8_t*       buf;
   uint8_t        HEADER_LEN;
@@ -217,6 +249,14 @@ protected:
   //! A flag for large data protocol to avoid checking byte by byte
   bool is_large_data_protocol;
 
+  //! Bulk frame scanner state, scan_buf is allocated on first use
+  uint8_t* scan_buf;
+  uint32_t scan_cap;
+  uint32_t scan_start;     //! first byte not consumed yet
+  uint32_t scan_end;       //! one past the last byte received
+  uint32_t scan_frame_len; //! length of the checked header at scan_start
+  bool     scan_pending;   //! the last scan cut a frame, more may follow
+
 }; // class ProtocolBase
 
 } // OSDK
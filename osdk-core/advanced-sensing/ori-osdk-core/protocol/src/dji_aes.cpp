@@ -25,6 +25,17 @@
  */
 
 #include "dji_aes.hpp"
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AES_NI_BACKEND
+#include <wmmintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define AES_ARMV8_BACKEND
+#include <arm_neon.h>
+#endif
 //////////////////////////////////////////////////////////////////////////
 // BEGIN OF AES-256
 //
@@ -451,4 +462,257 @@ aes256_decrypt_ecb(aes256_context* ctx, uint8_t* buf)
   aes_addRoundKey(buf, ctx->key);
 } /* aes256_decrypt */
 
+/* -------------------------------------------------------------------------- */
+/*  Multi-block backends                                                      */
+/* -------------------------------------------------------------------------- */
+typedef void (*aes256_blocks_codec)(const uint8_t* k, uint8_t* buf,
+                                    uint32_t blocks);
+
+/* The 15 round keys of the standard schedule, built with the same
+ * aes_expandEncKey as the byte-oriented cipher */
+static void
+aes256_expandRoundKeys(const uint8_t* k, uint8_t rk[15][16])
+{
+  uint8_t key[32];
+  uint8_t rcon = 1;
+  uint8_t i;
+
+  memcpy(key, k, sizeof(key));
+  memcpy(rk[0], key, 16);
+  memcpy(rk[1], key + 16, 16);
+  for (i = 1; i < 8; i++)
+  {
+    aes_expandEncKey(key, &rcon);
+    memcpy(rk[2 * i], key, 16);
+    if (2 * i + 1 < 15)
+      memcpy(rk[2 * i + 1], key + 16, 16);
+  }
+  memset(key, 0, sizeof(key));
+} /* aes256_expandRoundKeys */
+
+static void
+aes256_encrypt_blocks_portable(const uint8_t* k, uint8_t* buf, uint32_t blocks)
+{
+  aes256_context ctx;
+  uint32_t       i;
+
+  aes256_init(&ctx, (uint8_t*)k);
+  for (i = 0; i < blocks; i++)
+    aes256_encrypt_ecb(&ctx, buf + 16 * i);
+  aes256_done(&ctx);
+} /* aes256_encrypt_blocks_portable */
+
+static void
+aes256_decrypt_blocks_portable(const uint8_t* k, uint8_t* buf, uint32_t blocks)
+{
+  aes256_context ctx;
+  uint32_t       i;
+
+  aes256_init(&ctx, (uint8_t*)k);
+  for (i = 0; i < blocks; i++)
+    aes256_decrypt_ecb(&ctx, buf + 16 * i);
+  aes256_done(&ctx);
+} /* aes256_decrypt_blocks_portable */
+
+#ifdef AES_NI_BACKEND
+/* Four blocks are kept in flight to hide the aesenc/aesdec latency */
+__attribute__((target("aes,sse2"))) static void
+aes256_encrypt_blocks_aesni(const uint8_t* k, uint8_t* buf, uint32_t blocks)
+{
+  uint8_t  rkb[15][16];
+  __m128i  rk[15];
+  uint32_t i;
+  int      r;
+
+  aes256_expandRoundKeys(k, rkb);
+  for (r = 0; r < 15; r++)
+    rk[r] = _mm_loadu_si128((const __m128i*)rkb[r]);
+  memset(rkb, 0, sizeof(rkb));
+
+  for (i = 0; i + 4 <= blocks; i += 4)
+  {
+    __m128i* p  = (__m128i*)(buf + 16 * i);
+    __m128i  b0 = _mm_xor_si128(_mm_loadu_si128(p + 0), rk[0]);
+    __m128i  b1 = _mm_xor_si128(_mm_loadu_si128(p + 1), rk[0]);
+    __m128i  b2 = _mm_xor_si128(_mm_loadu_si128(p + 2), rk[0]);
+    __m128i  b3 = _mm_xor_si128(_mm_loadu_si128(p + 3), rk[0]);
+    for (r = 1; r < 14; r++)
+    {
+      b0 = _mm_aesenc_si128(b0, rk[r]);
+      b1 = _mm_aesenc_si128(b1, rk[r]);
+      b2 = _mm_aesenc_si128(b2, rk[r]);
+      b3 = _mm_aesenc_si128(b3, rk[r]);
+    }
+    _mm_storeu_si128(p + 0, _mm_aesenclast_si128(b0, rk[14]));
+    _mm_storeu_si128(p + 1, _mm_aesenclast_si128(b1, rk[14]));
+    _mm_storeu_si128(p + 2, _mm_aesenclast_si128(b2, rk[14]));
+    _mm_storeu_si128(p + 3, _mm_aesenclast_si128(b3, rk[14]));
+  }
+  for (; i < blocks; i++)
+  {
+    __m128i* p = (__m128i*)(buf + 16 * i);
+    __m128i  b = _mm_xor_si128(_mm_loadu_si128(p), rk[0]);
+    for (r = 1; r < 14; r++)
+      b = _mm_aesenc_si128(b, rk[r]);
+    _mm_storeu_si128(p, _mm_aesenclast_si128(b, rk[14]));
+  }
+} /* aes256_encrypt_blocks_aesni */
+
+__attribute__((target("aes,sse2"))) static void
+aes256_decrypt_blocks_aesni(const uint8_t* k, uint8_t* buf, uint32_t blocks)
+{
+  uint8_t  rkb[15][16];
+  __m128i  dk[15];
+  uint32_t i;
+  int      r;
+
+  /* Equivalent inverse cipher: reversed keys, InvMixColumns on the inner
+   * ones */
+  aes256_expandRoundKeys(k, rkb);
+  dk[0]  = _mm_loadu_si128((const __m128i*)rkb[14]);
+  dk[14] = _mm_loadu_si128((const __m128i*)rkb[0]);
+  for (r = 1; r < 14; r++)
+    dk[r] = _mm_aesimc_si128(_mm_loadu_si128((const __m128i*)rkb[14 - r]));
+  memset(rkb, 0, sizeof(rkb));
+
+  for (i = 0; i + 4 <= blocks; i += 4)
+  {
+    __m128i* p  = (__m128i*)(buf + 16 * i);
+    __m128i  b0 = _mm_xor_si128(_mm_loadu_si128(p + 0), dk[0]);
+    __m128i  b1 = _mm_xor_si128(_mm_loadu_si128(p + 1), dk[0]);
+    __m128i  b2 = _mm_xor_si128(_mm_loadu_si128(p + 2), dk[0]);
+    __m128i  b3 = _mm_xor_si128(_mm_loadu_si128(p + 3), dk[0]);
+    for (r = 1; r < 14; r++)
+    {
+      b0 = _mm_aesdec_si128(b0, dk[r]);
+      b1 = _mm_aesdec_si128(b1, dk[r]);
+      b2 = _mm_aesdec_si128(b2, dk[r]);
+      b3 = _mm_aesdec_si128(b3, dk[r]);
+    }
+    _mm_storeu_si128(p + 0, _mm_aesdeclast_si128(b0, dk[14]));
+    _mm_storeu_si128(p + 1, _mm_aesdeclast_si128(b1, dk[14]));
+    _mm_storeu_si128(p + 2, _mm_aesdeclast_si128(b2, dk[14]));
+    _mm_storeu_si128(p + 3, _mm_aesdeclast_si128(b3, dk[14]));
+  }
+  for (; i < blocks; i++)
+  {
+    __m128i* p = (__m128i*)(buf + 16 * i);
+    __m128i  b = _mm_xor_si128(_mm_loadu_si128(p), dk[0]);
+    for (r = 1; r < 14; r++)
+      b = _mm_aesdec_si128(b, dk[r]);
+    _mm_storeu_si128(p, _mm_aesdeclast_si128(b, dk[14]));
+  }
+} /* aes256_decrypt_blocks_aesni */
+#endif /* AES_NI_BACKEND */
+
+#ifdef AES_ARMV8_BACKEND
+/* AESE xors the round key before SubBytes/ShiftRows, so the key order is
+ * shifted by one compared to AES-NI and the last key is a plain xor */
+static void
+aes256_encrypt_blocks_armv8(const uint8_t* k, uint8_t* buf, uint32_t blocks)
+{
+  uint8_t    rkb[15][16];
+  uint8x16_t rk[15];
+  uint32_t   i;
+  int        r;
+
+  aes256_expandRoundKeys(k, rkb);
+  for (r = 0; r < 15; r++)
+    rk[r] = vld1q_u8(rkb[r]);
+  memset(rkb, 0, sizeof(rkb));
+
+  for (i = 0; i < blocks; i++)
+  {
+    uint8x16_t b = vld1q_u8(buf + 16 * i);
+    for (r = 0; r < 13; r++)
+      b = vaesmcq_u8(vaeseq_u8(b, rk[r]));
+    b = veorq_u8(vaeseq_u8(b, rk[13]), rk[14]);
+    vst1q_u8(buf + 16 * i, b);
+  }
+} /* aes256_encrypt_blocks_armv8 */
+
+static void
+aes256_decrypt_blocks_armv8(const uint8_t* k, uint8_t* buf, uint32_t blocks)
+{
+  uint8_t    rkb[15][16];
+  uint8x16_t dk[15];
+  uint32_t   i;
+  int        r;
+
+  aes256_expandRoundKeys(k, rkb);
+  dk[0]  = vld1q_u8(rkb[14]);
+  dk[14] = vld1q_u8(rkb[0]);
+  for (r = 1; r < 14; r++)
+    dk[r] = vaesimcq_u8(vld1q_u8(rkb[14 - r]));
+  memset(rkb, 0, sizeof(rkb));
+
+  for (i = 0; i < blocks; i++)
+  {
+    uint8x16_t b = vld1q_u8(buf + 16 * i);
+    for (r = 0; r < 13; r++)
+      b = vaesimcq_u8(vaesdq_u8(b, dk[r]));
+    b = veorq_u8(vaesdq_u8(b, dk[13]), dk[14]);
+    vst1q_u8(buf + 16 * i, b);
+  }
+} /* aes256_decrypt_blocks_armv8 */
+#endif /* AES_ARMV8_BACKEND */
+
+typedef struct tagAES256Backend
+{
+  aes256_blocks_codec encrypt;
+  aes256_blocks_codec decrypt;
+  const char*         name;
+} aes256_backend_t;
+
+static aes256_backend_t
+aes256_selectBackend()
+{
+  aes256_backend_t backend = { aes256_encrypt_blocks_portable,
+                               aes256_decrypt_blocks_portable, "portable" };
+#if defined(AES_ARMV8_BACKEND)
+  backend.encrypt = aes256_encrypt_blocks_armv8;
+  backend.decrypt = aes256_decrypt_blocks_armv8;
+  backend.name    = "armv8-crypto";
+#elif defined(AES_NI_BACKEND)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2"))
+  {
+    backend.encrypt = aes256_encrypt_blocks_aesni;
+    backend.decrypt = aes256_decrypt_blocks_aesni;
+    backend.name    = "aes-ni";
+  }
+#endif
+  return backend;
+} /* aes256_selectBackend */
+
+static const aes256_backend_t&
+aes256_getBackend()
+{
+  static const aes256_backend_t backend = aes256_selectBackend();
+  return backend;
+} /* aes256_getBackend */
+
+/* -------------------------------------------------------------------------- */
+void
+aes256_encrypt_ecb_blocks(const uint8_t* k, uint8_t* buf, uint32_t blocks)
+{
+  if (blocks)
+    aes256_getBackend().encrypt(k, buf, blocks);
+} /* aes256_encrypt_ecb_blocks */
+
+/* -------------------------------------------------------------------------- */
+void
+aes256_decrypt_ecb_blocks(const uint8_t* k, uint8_t* buf, uint32_t blocks)
+{
+  if (blocks)
+    aes256_getBackend().decrypt(k, buf, blocks);
+} /* aes256_decrypt_ecb_blocks */
+
+/* -------------------------------------------------------------------------- */
+const char*
+aes256_backend()
+{
+  return aes256_getBackend().name;
+} /* aes256_backend */
+
 // END OF AES-256
@@ -0,0 +1,333 @@
+/** @file dji_crc.cpp
+ *  @version 4.0.0
+ *  @date April 2017
+ *
+ *  @brief
+ *  Block CRC16/CRC32 for the DJI OSDK open protocol
+ *
+ *  @Copyright (c) 2016-2017 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include "dji_crc.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DJI_CRC_PCLMUL
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define DJI_CRC_ARMV8
+#include <arm_acle.h>
+#endif
+
+namespace DJI
+{
+namespace OSDK
+{
+
+namespace
+{
+
+/*! Slice-by-8 tables, derived from crc_tab16/crc_tab32 so the results
+ *  can not drift from the byte-wise tables. tab[k][i] is the CRC of byte
+ *  i followed by k zero bytes.
+ */
+struct CRCTables
+{
+  uint16_t tab16[8][256];
+  uint32_t tab32[8][256];
+
+  CRCTables()
+  {
+    for (int i = 0; i < 256; i++)
+    {
+      tab16[0][i] = crc_tab16[i];
+      tab32[0][i] = crc_tab32[i];
+    }
+    for (int k = 1; k < 8; k++)
+    {
+      for (int i = 0; i < 256; i++)
+      {
+        tab16[k][i] =
+          (tab16[k - 1][i] >> 8) ^ crc_tab16[tab16[k - 1][i] & 0xff];
+        tab32[k][i] =
+          (tab32[k - 1][i] >> 8) ^ crc_tab32[tab32[k - 1][i] & 0xff];
+      }
+    }
+  }
+};
+
+const CRCTables&
+crcTables()
+{
+  static const CRCTables tables;
+  return tables;
+}
+
+uint32_t
+crc32Slice8(uint32_t crc, const uint8_t* buf, size_t len)
+{
+  const CRCTables& t = crcTables();
+
+  while (len >= 8)
+  {
+    uint32_t lo = crc ^ ((uint32_t)buf[0] | ((uint32_t)buf[1] << 8) |
+                         ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24));
+    crc = t.tab32[7][lo & 0xff] ^ t.tab32[6][(lo >> 8) & 0xff] ^
+          t.tab32[5][(lo >> 16) & 0xff] ^ t.tab32[4][lo >> 24] ^
+          t.tab32[3][buf[4]] ^ t.tab32[2][buf[5]] ^ t.tab32[1][buf[6]] ^
+          t.tab32[0][buf[7]];
+    buf += 8;
+    len -= 8;
+  }
+  while (len--)
+  {
+    crc = (crc >> 8) ^ crc_tab32[(crc ^ *buf++) & 0xff];
+  }
+  return crc;
+}
+
+#ifdef DJI_CRC_PCLMUL
+/*! Fold 64 bytes at a time with carry-less multiplies, then Barrett
+ *  reduce, after Intel's "Fast CRC Computation for Generic Polynomials
+ *  Using PCLMULQDQ". The constants are those of the bit-reflected
+ *  0x04C11DB7 polynomial, the one crc_tab32 is built from.
+ *  len must be at least 64 and a multiple of 16.
+ */
+__attribute__((target("pclmul,sse2"))) uint32_t
+crc32Pclmul(uint32_t crc, const uint8_t* buf, size_t len)
+{
+  static const uint64_t k1k2[2] __attribute__((aligned(16))) = {
+    0x0154442bd4ULL, 0x01c6e41596ULL
+  };
+  static const uint64_t k3k4[2] __attribute__((aligned(16))) = {
+    0x01751997d0ULL, 0x00ccaa009eULL
+  };
+  static const uint64_t k5k0[2] __attribute__((aligned(16))) = {
+    0x0163cd6124ULL, 0x0000000000ULL
+  };
+  static const uint64_t poly[2] __attribute__((aligned(16))) = {
+    0x01db710641ULL, 0x01f7011641ULL
+  };
+
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+  x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+  x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+  x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+  x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+  x0 = _mm_load_si128((const __m128i*)k1k2);
+  buf += 64;
+  len -= 64;
+
+  //! Four independent 128 bit lanes
+  while (len >= 64)
+  {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+    y5 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+    y6 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+    y7 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+    y8 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+    buf += 64;
+    len -= 64;
+  }
+
+  //! Fold the four lanes into one
+  x0 = _mm_load_si128((const __m128i*)k3k4);
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  //! Remaining 16 byte blocks
+  while (len >= 16)
+  {
+    x2 = _mm_loadu_si128((const __m128i*)buf);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    buf += 16;
+    len -= 16;
+  }
+
+  //! 128 -> 64 bits
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_srli_si128(x1, 8);
+  x1 = _mm_xor_si128(x1, x2);
+
+  x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  //! Barrett reduction to 32 bits
+  x0 = _mm_load_si128((const __m128i*)poly);
+
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+
+uint32_t
+crc32X86(uint32_t crc, const uint8_t* buf, size_t len)
+{
+  //! Below a few blocks the setup costs more than slice-by-8
+  if (len >= 128)
+  {
+    size_t blockLen = len & ~(size_t)15;
+    crc = crc32Pclmul(crc, buf, blockLen);
+    buf += blockLen;
+    len -= blockLen;
+  }
+  return crc32Slice8(crc, buf, len);
+}
+#endif // DJI_CRC_PCLMUL
+
+#ifdef DJI_CRC_ARMV8
+//! The ARMv8 CRC32 instructions use the crc_tab32 polynomial, unlike
+//! the CRC32C ones (and unlike x86 SSE4.2, which only has CRC32C)
+uint32_t
+crc32Armv8(uint32_t crc, const uint8_t* buf, size_t len)
+{
+  while (len && ((uintptr_t)buf & 7))
+  {
+    crc = __crc32b(crc, *buf++);
+    len--;
+  }
+  while (len >= 8)
+  {
+    crc = __crc32d(crc, *(const uint64_t*)buf);
+    buf += 8;
+    len -= 8;
+  }
+  while (len--)
+  {
+    crc = __crc32b(crc, *buf++);
+  }
+  return crc;
+}
+#endif // DJI_CRC_ARMV8
+
+typedef uint32_t (*CRC32Func)(uint32_t crc, const uint8_t* buf, size_t len);
+
+struct CRC32Impl
+{
+  CRC32Func   func;
+  const char* name;
+
+  CRC32Impl()
+    : func(crc32Slice8)
+    , name("slice-by-8")
+  {
+#if defined(DJI_CRC_ARMV8)
+    func = crc32Armv8;
+    name = "armv8-crc32";
+#elif defined(DJI_CRC_PCLMUL)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse2"))
+    {
+      func = crc32X86;
+      name = "pclmul";
+    }
+#endif
+  }
+};
+
+const CRC32Impl&
+crc32Impl()
+{
+  static const CRC32Impl impl;
+  return impl;
+}
+
+} // namespace
+
+uint16_t
+crc16Compute(uint16_t crc, const uint8_t* buf, size_t len)
+{
+  const CRCTables& t = crcTables();
+
+  while (len >= 8)
+  {
+    uint16_t lo = crc ^ (uint16_t)(buf[0] | (buf[1] << 8));
+    crc = t.tab16[7][lo & 0xff] ^ t.tab16[6][lo >> 8] ^ t.tab16[5][buf[2]] ^
+          t.tab16[4][buf[3]] ^ t.tab16[3][buf[4]] ^ t.tab16[2][buf[5]] ^
+          t.tab16[1][buf[6]] ^ t.tab16[0][buf[7]];
+    buf += 8;
+    len -= 8;
+  }
+  while (len--)
+  {
+    crc = (crc >> 8) ^ crc_tab16[(crc ^ *buf++) & 0xff];
+  }
+  return crc;
+}
+
+uint32_t
+crc32Compute(uint32_t crc, const uint8_t* buf, size_t len)
+{
+  return crc32Impl().func(crc, buf, len);
+}
+
+const char*
+crc32Backend()
+{
+  return crc32Impl().name;
+}
+
+} // namespace OSDK
+} // namespace DJI
@@ -599,6 +599,43 @@ OpenProtocol::callApp()
   return isFrame;
 }
 
+//! Bulk scanner: same checks as steps 6 - 8, on a frame in place
+int
+OpenProtocol::frameSOF()
+{
+  return OpenProtocol::SOF;
+}
+
+uint32_t
+OpenProtocol::frameLength(const uint8_t* head)
+{
+  OpenHeader* p_head = (OpenHeader*)head;
+
+  if ((p_head->version == 0) && (p_head->length >= sizeof(OpenHeader)) &&
+      (p_head->length < OpenProtocol::MAX_RECV_LEN) &&
+      (p_head->reserved0 == 0) && (p_head->reserved1 == 0) &&
+      (crcHeadCheck((uint8_t*)p_head, sizeof(OpenHeader)) == 0))
+  {
+    return p_head->length;
+  }
+  return 0;
+}
+
+bool
+OpenProtocol::frameVerify(const uint8_t* frame, uint32_t len)
+{
+  //! A bare header carries no data CRC
+  return (len == sizeof(OpenHeader)) ||
+         (crcTailCheck((uint8_t*)frame, len) == 0);
+}
+
+bool
+OpenProtocol::frameHandler(uint8_t* frame, uint32_t len)
+{
+  encodeData((OpenHeader*)frame, aes256_decrypt_ecb);
+  return appHandler((OpenHeader*)frame);
+}
+
 //! Step 9
 bool
 OpenProtocol::appHandler(void* protocolHeader)
@@ -879,32 +916,17 @@ OpenProtocol::crc32Update(uint32_t crc, uint8_t ch)
   return crc;
 }
 
+//! Same result as crc16Update() over every byte, just a block at a time
 uint16_t
 OpenProtocol::crc16Calc(const uint8_t* pMsg, size_t nLen)
 {
-  size_t   i;
-  uint16_t wCRC = CRC_INIT;
-
-  for (i = 0; i < nLen; i++)
-  {
-    wCRC = crc16Update(wCRC, pMsg[i]);
-  }
-
-  return wCRC;
+  return crc16Compute(CRC_INIT, pMsg, nLen);
 }
 
 uint32_t
 OpenProtocol::crc32Calc(const uint8_t* pMsg, size_t nLen)
 {
-  size_t   i;
-  uint32_t wCRC = CRC_INIT;
-
-  for (i = 0; i < nLen; i++)
-  {
-    wCRC = crc32Update(wCRC, pMsg[i]);
-  }
-
-  return wCRC;
+  return crc32Compute(CRC_INIT, pMsg, nLen);
 }
 
 /******************* Encryption *********************/
@@ -930,13 +952,25 @@ OpenProtocol::encodeData(OpenHeader* p_head, ptr_aes256_codec codec_func)
   loop_blk = data_len / 16;
   data_idx = 0;
 
-  aes256_init(&ctx, p_filter->sdkKey);
-  for (buf_i = 0; buf_i < loop_blk; buf_i++)
+  //! The whole payload in one call, so hardware AES can pipeline blocks
+  if (codec_func == aes256_encrypt_ecb)
   {
-    codec_func(&ctx, data_ptr + data_idx);
-    data_idx += 16;
+    aes256_encrypt_ecb_blocks(p_filter->sdkKey, data_ptr, loop_blk);
+  }
+  else if (codec_func == aes256_decrypt_ecb)
+  {
+    aes256_decrypt_ecb_blocks(p_filter->sdkKey, data_ptr, loop_blk);
+  }
+  else
+  {
+    aes256_init(&ctx, p_filter->sdkKey);
+    for (buf_i = 0; buf_i < loop_blk; buf_i++)
+    {
+      codec_func(&ctx, data_ptr + data_idx);
+      data_idx += 16;
+    }
+    aes256_done(&ctx);
   }
-  aes256_done(&ctx);
 
   if (codec_func == aes256_decrypt_ecb)
     p_head->length = p_head->length - p_head->padding; // minus padding length;
@@ -35,12 +35,21 @@ using namespace DJI::OSDK;
 ProtocolBase::ProtocolBase()
   : reuse_buffer(true)
   , is_large_data_protocol(false)
+  , read_count(0)
   , BUFFER_SIZE(1024)
 {
+  scan_buf       = NULL;
+  scan_cap       = 0;
+  scan_start     = 0;
+  scan_end       = 0;
+  scan_frame_len = 0;
+  scan_pending   = false;
 }
 
 ProtocolBase::~ProtocolBase()
 {
+  delete[] scan_buf;
+
   if (this->deviceDriver)
     delete this->deviceDriver;
 
@@ -72,11 +81,20 @@ ProtocolBase::readPoll()
   //! Bool to check if the protocol parser has finished a full frame
   bool isFrame = false;
 
+  if (frameSOF() >= 0)
+  {
+    return bulkReadPoll();
+  }
+
   //! Step 1: Check if the buffer has been consumed
   if (buf_read_pos >= read_len)
   {
     this->buf_read_pos = 0;
     this->read_len     = deviceDriver->readall(this->buf, BUFFER_SIZE);
+    if (this->read_len > 0)
+    {
+      this->read_count++;
+    }
   }
 
 #ifdef API_BUFFER_DATA
@@ -262,6 +280,128 @@ ProtocolBase::reuseDataStream()
   p_filter->reuseCount++;
 }
 
+int
+ProtocolBase::frameSOF()
+{
+  return -1;
+}
+
+uint32_t
+ProtocolBase::frameLength(const uint8_t* head)
+{
+  return 0;
+}
+
+bool
+ProtocolBase::frameVerify(const uint8_t* frame, uint32_t len)
+{
+  return false;
+}
+
+bool
+ProtocolBase::frameHandler(uint8_t* frame, uint32_t len)
+{
+  return false;
+}
+
+//! Step 1 of the bulk scanner, replaces steps 1 - 7
+bool
+ProtocolBase::bulkReadPoll()
+{
+  //! Frames left over from the last read come first
+  if (scan_pending && scanFrames())
+  {
+    return true;
+  }
+
+  if (scan_buf == NULL)
+  {
+    //! Room for a partial frame of each of two reads plus a fresh read,
+    //! so the unconsumed bytes rarely have to be moved
+    scan_cap = 2 * MAX_RECV_LEN + BUFFER_SIZE;
+    scan_buf = new uint8_t[scan_cap];
+  }
+
+  if (scan_cap - scan_end < (uint32_t)BUFFER_SIZE)
+  {
+    memmove(scan_buf, scan_buf + scan_start, scan_end - scan_start);
+    scan_end -= scan_start;
+    scan_start = 0;
+  }
+
+  //! Read straight behind the buffered bytes, no intermediate copy
+  this->read_len     = deviceDriver->readall(scan_buf + scan_end, BUFFER_SIZE);
+  this->buf_read_pos = this->read_len;
+  if (this->read_len <= 0)
+  {
+    return false;
+  }
+  this->read_count++;
+  scan_end += this->read_len;
+
+  return scanFrames();
+}
+
+bool
+ProtocolBase::scanFrames()
+{
+  const uint8_t sof = (uint8_t)frameSOF();
+
+  scan_pending = false;
+  while (scan_end - scan_start >= HEADER_LEN)
+  {
+    uint8_t* p     = scan_buf + scan_start;
+    uint32_t avail = scan_end - scan_start;
+
+    if (*p != sof)
+    {
+      uint8_t* next = (uint8_t*)memchr(p + 1, sof, avail - 1);
+      scan_start    = next ? (uint32_t)(next - scan_buf) : scan_end;
+      continue;
+    }
+
+    //! Check each candidate header only once, however the frame trickles in
+    if (scan_frame_len == 0)
+    {
+      uint32_t len = frameLength(p);
+      if (len < HEADER_LEN || len > (uint32_t)MAX_RECV_LEN)
+      {
+        scan_start++;
+        continue;
+      }
+      scan_frame_len = len;
+    }
+
+    if (avail < scan_frame_len)
+    {
+      break;
+    }
+
+    uint32_t len   = scan_frame_len;
+    scan_frame_len = 0;
+    if (!frameVerify(p, len))
+    {
+      //! A false SOF or a damaged frame, resync right behind its SOF
+      scan_start++;
+      continue;
+    }
+
+    scan_start += len;
+    if (frameHandler(p, len))
+    {
+      scan_pending = true;
+      return true;
+    }
+  }
+
+  if (scan_start == scan_end)
+  {
+    scan_start = 0;
+    scan_end   = 0;
+  }
+  return false;
+}
+
 HardDriver*
 ProtocolBase::getDriver() const
 {
@@ -310,6 +450,18 @@ ProtocolBase::getReadLen()
   return read_len;
 }
 
+uint32_t
+ProtocolBase::getReadCount()
+{
+  return read_count;
+}
+
+bool
+ProtocolBase::hasPendingData()
+{
+  return (buf_read_pos < read_len) || scan_pending;
+}
+
 RecvContainer*
 ProtocolBase::getReceivedFrame()
 {
@@ -117,6 +117,13 @@ private:
   //! A lot of ACK parsing logic
   bool appHandler(void *protocolHeader);
 
+  //! Bulk frame scanner hooks, replace steps 5 - 8. An image frame is
+  //! hundreds of KB, so this is what keeps up with the stereo stream
+  int      frameSOF();
+  uint32_t frameLength(const uint8_t* head);
+  bool     frameVerify(const uint8_t* frame, uint32_t len);
+  bool     frameHandler(uint8_t* frame, uint32_t len);
+
   /********************************** CRC **********************************/
 private:
   int crcHeadCheck(uint8_t* pMsg, size_t nLen);
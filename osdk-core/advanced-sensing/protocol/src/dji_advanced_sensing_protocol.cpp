@@ -289,6 +289,39 @@ AdvancedSensingProtocol::callApp()
   return isFrame;
 }
 
+//! Bulk scanner: same checks as steps 6 - 8, on a frame in place
+int
+AdvancedSensingProtocol::frameSOF()
+{
+  return AdvancedSensingProtocol::SOF1;
+}
+
+uint32_t
+AdvancedSensingProtocol::frameLength(const uint8_t* head)
+{
+  AdvancedSensingHeader* p_head = (AdvancedSensingHeader*)head;
+
+  if (p_head->header[1] != AdvancedSensingProtocol::SOF2 ||
+      p_head->length > (uint32_t)(MAX_RECV_LEN - sizeof(AdvancedSensingHeader)))
+  {
+    return 0;
+  }
+  return p_head->length + sizeof(AdvancedSensingHeader);
+}
+
+bool
+AdvancedSensingProtocol::frameVerify(const uint8_t* frame, uint32_t len)
+{
+  //! The link is USB bulk, the header carries no checksum to verify
+  return true;
+}
+
+bool
+AdvancedSensingProtocol::frameHandler(uint8_t* frame, uint32_t len)
+{
+  return appHandler((void *) frame);
+}
+
 //! step 9
 bool
 AdvancedSensingProtocol::appHandler(void *protocolHeader)
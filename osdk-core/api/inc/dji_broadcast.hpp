@@ -32,12 +32,47 @@
 
 #include "dji_telemetry.hpp"
 #include "dji_vehicle_callback.hpp"
+#include <atomic>
 
 namespace DJI
 {
 namespace OSDK
 {
 
+/*! @brief All broadcast telemetry as of one received frame
+ *
+ *  @details Fields the frame did not carry (see passFlag) keep the value
+ *  of the last frame that had them, as with the single getters. Data of
+ *  the Matrice 100 and old Matrice 600 firmware is converted the same way
+ *  the getters convert it.
+ */
+typedef struct BroadcastSnapshot
+{
+  uint32_t sequence;   /*!< frames received so far, 0 before the first one */
+  uint32_t recvTimeMs; /*!< host time the frame was received */
+  uint16_t passFlag;   /*!< fields carried by this frame */
+  // clang-format off
+  Telemetry::TimeStamp        timeStamp;
+  Telemetry::SyncStamp        syncStamp;
+  Telemetry::Quaternion       q;
+  Telemetry::Vector3f         a;
+  Telemetry::Vector3f         v;
+  Telemetry::Vector3f         w;
+  Telemetry::VelocityInfo     vi;
+  Telemetry::GlobalPosition   gp;
+  Telemetry::RelativePosition rp;
+  Telemetry::GPSInfo          gps;
+  Telemetry::RTK              rtk;
+  Telemetry::Mag              mag;
+  Telemetry::RC               rc;
+  Telemetry::Gimbal           gimbal;
+  Telemetry::Status           status;
+  Telemetry::Battery          battery;
+  Telemetry::SDKInfo          info;
+  Telemetry::Compass          compass;
+  // clang-format on
+} BroadcastSnapshot;
+
 /*! @brief Telemetry API through asynchronous "Broadcast"-style messages
  *
  *  @details Broadcast telemetry is sent by the FC as push data - whenever an
@@ -324,6 +359,17 @@ public:
   Telemetry::Compass     getCompassData();
     // clang-format on
 
+  /*! Get every field of the latest frame at once, without taking the lock
+   *  the single getters take. The values always come from one frame.
+   *
+   *  @platforms M210V2, M300
+   *  @note Compare BroadcastSnapshot::sequence between two calls to tell
+   *  a repeated frame (equal) from skipped ones (a gap larger than 1).
+   *
+   *  @return BroadcastSnapshot of the newest frame
+   */
+  BroadcastSnapshot snapshot();
+
 public:
   /*! Non-blocking call for Frequency setting
    *
@@ -385,11 +431,22 @@ public:
 
 public:
   void setUserBroadcastCallback(VehicleCallBack callback, UserData userData);
-  VehicleCallBackHandler unpackHandler;
+  /*! Like setUserBroadcastCallback() without copying the frame for the
+   *  call, replaces the callback set by either of them.
+   */
+  void setUserBroadcastRefCallback(VehicleCallBackRef callback,
+                                   UserData           userData);
+  VehicleCallBackHandler    unpackHandler;
+  VehicleCallBackRefHandler unpackRefHandler;
 
 public:
   static void unpackCallback(Vehicle* vehicle, RecvContainer recvFrame,
                              UserData userData);
+  /*! Same as unpackCallback() without copying the frame, this is the one
+   *  registered with the linker.
+   */
+  static void unpackRefCallback(Vehicle* vehicle, const RecvContainer& recvFrame,
+                                UserData userData);
   static void setFrequencyCallback(Vehicle* vehicle, RecvContainer recvFrame,
                                    UserData userData);
 
@@ -430,21 +487,22 @@ private:
    * @brief Extract broadcast data for A3/N3/M600
    * @param recvFrame: pointer to the raw data payload
    */
-  void unpackData(RecvContainer* recvFrame);
+  void unpackData(const RecvContainer* recvFrame);
 
   /*!
    * @brief Extract broadcast data for M100
    * @param recvFrame: pointer to the raw data payload
    */
-  void unpackM100Data(RecvContainer* pRecvFrame);
+  void unpackM100Data(const RecvContainer* pRecvFrame);
 
   /*!
    * @brief Extract broadcast data for M600 FW 3.2.41.5
    * @param recvFrame: pointer to the raw data payload
    */
-  void unpackOldM600Data(RecvContainer* recvFrame);
+  void unpackOldM600Data(const RecvContainer* recvFrame);
 
-  inline void unpackOne(FLAG flag, void* data, uint8_t*& buf, size_t size);
+  inline void unpackOne(FLAG flag, void* data, const uint8_t*& buf,
+                        size_t size);
 
 public:
   void setBroadcastLength(uint16_t length);
@@ -489,7 +547,18 @@ private:
   void lockMSG();
   void freeMSG();
 
-  VehicleCallBackHandler userCbHandler;
+  VehicleCallBackHandler    userCbHandler;
+  VehicleCallBackRefHandler userRefCbHandler;
+
+  /*
+   * @note Sequence lock around latest, odd while the receive thread
+   * is writing it
+   */
+  void publishSnapshot();
+
+  BroadcastSnapshot     latest;
+  std::atomic<uint32_t> snapshotSeq;
+  uint32_t              frameCount;
 };
 
 } // OSDK
@@ -129,7 +129,16 @@ public:
   bool registerCMDCallback(uint8_t cmdSet, uint8_t cmdID,
                            VehicleCallBack &callback, UserData &userData);
 
+  /*! Same as above, the frame is handed to the callback without a copy */
+  bool registerCMDCallback(uint8_t cmdSet, uint8_t cmdID,
+                           VehicleCallBackRef &callback, UserData &userData);
+
  private:
+  bool registerAdaptingCallback(uint8_t cmdSet, uint8_t cmdID,
+                                VehicleCallBack callback,
+                                VehicleCallBackRef refCallback,
+                                UserData userData);
+
   Vehicle* vehicle;
 
   void initX5SEnableThread();
@@ -33,6 +33,7 @@
 #include "dji_log.hpp"
 #include "dji_telemetry.hpp"
 #include "dji_vehicle_callback.hpp"
+#include <atomic>
 
 #ifdef __linux__
 #include <cstring>
@@ -50,6 +51,18 @@ namespace OSDK
 // Forward Declarations
 class Vehicle;
 
+/*! @brief One received package, as kept by the package history
+ */
+typedef struct SubscriptionSample
+{
+  uint8_t              packageID;
+  uint32_t             index;      /*!< counts received packages, gaps are drops */
+  uint32_t             recvTimeMs; /*!< host time the package was received */
+  bool                 hasFcTime;  /*!< the package was added with sendTimeStamp */
+  Telemetry::TimeStamp fcTime;     /*!< FC time stamp, if hasFcTime */
+  const uint8_t*       data;       /*!< package payload, laid out as the live one */
+} SubscriptionSample;
+
 /*! @brief Package class to support Subscribe-style telemetry
  *
  *  @details Use the DJI_DataSubscription class to access telemetry.
@@ -103,6 +116,8 @@ public:
 
   void setUserUnpackCallback(VehicleCallBack userFunctionAfterPackageExtraction,
                              UserData        userData);
+  void setUserUnpackRefCallback(
+    VehicleCallBackRef userFunctionAfterPackageExtraction, UserData userData);
 
   bool isOccupied();
   void setOccupied(bool status);
@@ -118,6 +133,40 @@ public:
   uint8_t*               getDataBuffer();
   uint32_t               getBufferSize();
   VehicleCallBackHandler getUnpackHandler();
+  VehicleCallBackRefHandler getUnpackRefHandler();
+
+  /*!
+   * @brief Sequence lock around the data buffer. The receive thread copies
+   *        a package in between two increments of the sequence, so it is
+   *        odd while the buffer is being written. Readers copy without a
+   *        lock and retry when the sequence was odd or has moved.
+   *
+   * @platforms M210V2, M300
+   */
+  void     writeData(const uint8_t* data);
+  uint32_t readBegin() const;
+  bool     readRetry(uint32_t sequence) const;
+
+  /*!
+   * @brief Optional history of received packages. The receive thread adds
+   *        every package it writes, one consumer drains the oldest ones
+   *        through historyFront()/historyRelease(). Packages arriving
+   *        while the history is full are dropped and counted.
+   *
+   * @platforms M210V2, M300
+   * @param depth: samples to keep, 0 to disable. Applies to the data
+   *        buffer allocated next, i.e. when the package is started.
+   */
+  void     setHistoryDepth(uint16_t depth);
+  uint16_t getHistoryDepth();
+  bool     historyFront(SubscriptionSample* sample);
+  void     historyRelease();
+  uint32_t getHistorySize();
+  uint32_t getHistoryDrops();
+  //! Copy one topic of a sample of this package, false if not in it
+  bool     readSampleTopic(const SubscriptionSample& sample,
+                           Telemetry::TopicName topic, void* dst,
+                           size_t size);
 
   /*!
   * @brief Helper function to do post processing when adding package is
@@ -164,8 +213,28 @@ private: // Private variables
    * @brief Advanced users can optionally register a callback function
    *        (for each package) to run after every package is received.
    *        This function is called in the end of decodeCallback function.
+   *        At most one of the two handlers is set.
    */
-  VehicleCallBackHandler userUnpackHandler;
+  VehicleCallBackHandler    userUnpackHandler;
+  VehicleCallBackRefHandler userUnpackRefHandler;
+
+  std::atomic<uint32_t> sequence;
+
+  typedef struct HistoryMeta
+  {
+    uint32_t recvTimeMs;
+    uint32_t index;
+  } HistoryMeta;
+
+  void pushHistory(const uint8_t* data);
+
+  uint16_t              historyDepth;
+  uint32_t              historyStride;  // meta and payload of one slot
+  uint8_t*              historyBuffer;  // historyDepth + 1 slots
+  uint32_t              receivedCount;
+  std::atomic<uint32_t> historyHead;    // written by the receive thread
+  std::atomic<uint32_t> historyTail;    // written by the consumer
+  std::atomic<uint32_t> historyDrops;
 }; // class SubscriptionPackage
 
 /*! @brief Telemetry API through asynchronous "Subscribe"-style messages
@@ -221,6 +290,8 @@ public: // public methods
   *
   * @platforms M210V2, M300
   * @param packageID
+  * @note On a DataSubscription created without a vehicle the package is
+  *       started locally, nothing is sent.
   */
   void startPackage(int packageID);
 
@@ -253,6 +324,56 @@ public: // public methods
    */
   ACK::ErrorCode removePackage(int packageID, int timeout); // blocking call
 
+  /*!
+   * @brief Keep every received sample of a package, not just the latest.
+   *        Call it after initPackageFromTopicList() and before
+   *        startPackage(), removing the package disables it again.
+   *
+   * @platforms M210V2, M300
+   * @param packageID
+   * @param depth: samples kept until they are drained, 0 to disable
+   * @return false if the package is already started
+   */
+  bool enablePackageHistory(int packageID, uint16_t depth);
+
+  /*!
+   * @brief Oldest sample not drained yet. sample->data stays valid until
+   *        releaseHistorySample(). Only one thread may drain a package.
+   *
+   * @platforms M210V2, M300
+   * @param packageID
+   * @param sample
+   * @return false if there is none
+   */
+  bool getHistorySample(int packageID, SubscriptionSample* sample);
+  void releaseHistorySample(int packageID);
+
+  /*!
+   * @brief Samples dropped because the history of the package was full
+   *
+   * @platforms M210V2, M300
+   * @param packageID
+   */
+  uint32_t getHistoryDrops(int packageID);
+
+  /*!
+   * @brief Value of a topic in a sample from getHistorySample()
+   *
+   * @platforms M210V2, M300
+   * @return false if the topic is not part of the sample's package
+   */
+  template <Telemetry::TopicName topic>
+  bool getSampleValue(const SubscriptionSample&                 sample,
+                      typename Telemetry::TypeMap<topic>::type& value)
+  {
+    if (sample.packageID >= MAX_NUMBER_OF_PACKAGE)
+    {
+      return false;
+    }
+    return package[sample.packageID].readSampleTopic(sample, topic, &value,
+                                                     sizeof(value));
+  }
+
   /*!
    * @brief Remove leftover incoming telemetry data due to unclean quit
    *
@@ -296,6 +417,18 @@ public: // public methods
     int packageID, VehicleCallBack userFunctionAfterPackageExtraction,
     UserData userData = NULL);
 
+  /*!
+   * @brief Same as registerUserPackageUnpackCallback(), but the received
+   *        frame is passed by reference instead of being copied for the call
+   *
+   * @platforms M210V2, M300
+   * @param packageID
+   * @param userFunctionAfterPackageExtraction
+   */
+  void registerUserPackageUnpackRefCallback(
+    int packageID, VehicleCallBackRef userFunctionAfterPackageExtraction,
+    UserData userData = NULL);
+
   // Not implemented yet
   // bool pausePackage(int packageID);
   // bool resumePackage(int packageID);
@@ -333,41 +466,63 @@ public: // public methods
   static void decodeCallback(Vehicle* vehiclePtr, RecvContainer rcvContainer,
                              UserData subscriptionPtr);
 
+  /*!
+   * @brief Same as decodeCallback() without copying the frame, this is the
+   *        one registered with the linker.
+   */
+  static void decodeRefCallback(Vehicle*             vehiclePtr,
+                                const RecvContainer& rcvContainer,
+                                UserData             subscriptionPtr);
+
   template <Telemetry::TopicName           topic>
   typename Telemetry::TypeMap<topic>::type getValue()
   {
     typename Telemetry::TypeMap<topic>::type ans;
 
-    void* p = Telemetry::TopicDataBase[topic].latest;
-
-    lockMSG();
-    if (p)
-    {
-      ans = *reinterpret_cast<typename Telemetry::TypeMap<topic>::type*>(p);
-      freeMSG();
-      return ans;
-    }
-    else
+    Telemetry::TopicName name = topic;
+    void*                dst  = &ans;
+    size_t               size = sizeof(ans);
+    if (!readTopics(1, &name, &dst, &size))
     {
       DERROR("Topic 0x%X value memory not initialized, return default", topic);
     }
-    freeMSG();
-
-    memset(&ans, 0xFF, sizeof(ans));
     return ans;
   }
 
+  /*!
+   * @brief Read several topics at once, without waiting for the receive
+   *        thread. All values come from the same received package when
+   *        the topics share one, and from packages that were all current
+   *        at the same moment otherwise.
+   *
+   * @platforms M210V2, M300
+   * @param values: one variable per topic, in the order of the topics
+   * @return false if any topic is not subscribed, its value is then filled
+   *         with 0xFF like getValue() does
+   */
+  template <Telemetry::TopicName... topics>
+  bool getValues(typename Telemetry::TypeMap<topics>::type&... values)
+  {
+    const Telemetry::TopicName names[] = { topics... };
+    void* const                dst[]   = { &values... };
+    const size_t               sizes[] = { sizeof(values)... };
+    return readTopics(sizeof...(topics), names, dst, sizes);
+  }
+
 public: // public variables
-  const static uint8_t   MAX_NUMBER_OF_PACKAGE = 7;
-  VehicleCallBackHandler subscriptionDataDecodeHandler;
+  const static uint8_t      MAX_NUMBER_OF_PACKAGE = 7;
+  VehicleCallBackHandler    subscriptionDataDecodeHandler;
+  VehicleCallBackRefHandler subscriptionDataDecodeRefHandler;
 
 private: // private variables
   Vehicle*            vehicle;
   SubscriptionPackage package[MAX_NUMBER_OF_PACKAGE];
 
 private: // private methods
-  void extractOnePackage(RecvContainer*       pRcvContainer,
+  void extractOnePackage(const RecvContainer* pRcvContainer,
                          SubscriptionPackage* pkg);
+  bool readTopics(int num, const Telemetry::TopicName* topics,
+                  void* const* dst, const size_t* sizes);
   T_OsdkMutexHandle m_msgLock;
   void lockMSG();
   void freeMSG();
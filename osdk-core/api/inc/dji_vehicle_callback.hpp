@@ -86,6 +86,37 @@ typedef struct VehicleCallBackHandler
   UserData        userData;
 } VehicleCallBackHandler;
 
+/*! Same as VehicleCallBack without copying the frame for every call.
+ *  recvFrame is only valid until the callback returns.
+ */
+typedef void (*VehicleCallBackRef)(Vehicle* vehicle,
+                                   const RecvContainer& recvFrame,
+                                   UserData userData);
+
+typedef struct VehicleCallBackRefHandler
+{
+  VehicleCallBackRef callback;
+  UserData           userData;
+} VehicleCallBackRefHandler;
+
+/*! Dispatch points keep one handler of each kind, at most one of them set.
+ *  A VehicleCallBackRef gets the frame as is, a VehicleCallBack its own copy.
+ */
+inline void
+callVehicleCallBack(const VehicleCallBackRefHandler& refHandler,
+                    const VehicleCallBackHandler&    handler,
+                    Vehicle* vehicle, const RecvContainer& recvFrame)
+{
+  if (refHandler.callback)
+  {
+    refHandler.callback(vehicle, recvFrame, refHandler.userData);
+  }
+  else if (handler.callback)
+  {
+    handler.callback(vehicle, recvFrame, handler.userData);
+  }
+}
+
 /*! @brief The CallBackHandler struct allows users to encapsulate callbacks and
  * data in one struct. This is a more common method.
  *
@@ -36,6 +36,13 @@ using namespace DJI::OSDK;
 void
 DataBroadcast::unpackCallback(Vehicle* vehicle, RecvContainer recvFrame,
                               UserData data)
+{
+  unpackRefCallback(vehicle, recvFrame, data);
+}
+
+void
+DataBroadcast::unpackRefCallback(Vehicle*             vehicle,
+                                 const RecvContainer& recvFrame, UserData data)
 {
   DataBroadcast* broadcastPtr = (DataBroadcast*)data;
 
@@ -51,21 +58,27 @@ DataBroadcast::unpackCallback(Vehicle* vehicle, RecvContainer recvFrame,
   {
     broadcastPtr->unpackM100Data(&recvFrame);
   }
+  broadcastPtr->publishSnapshot();
 
-  if (broadcastPtr->userCbHandler.callback)
-  {
-    broadcastPtr->userCbHandler.callback(vehicle, recvFrame,
-                                         broadcastPtr->userCbHandler.userData);
-  }
+  callVehicleCallBack(broadcastPtr->userRefCbHandler,
+                      broadcastPtr->userCbHandler, vehicle, recvFrame);
 }
 
 DataBroadcast::DataBroadcast(Vehicle* vehiclePtr)
 {
-  unpackHandler.callback = unpackCallback;
-  unpackHandler.userData = this;
+  unpackHandler.callback    = unpackCallback;
+  unpackHandler.userData    = this;
+  unpackRefHandler.callback = unpackRefCallback;
+  unpackRefHandler.userData = this;
+
+  userCbHandler.callback    = 0;
+  userCbHandler.userData    = 0;
+  userRefCbHandler.callback = 0;
+  userRefCbHandler.userData = 0;
 
-  userCbHandler.callback = 0;
-  userCbHandler.userData = 0;
+  memset(&latest, 0, sizeof(latest));
+  snapshotSeq = 0;
+  frameCount  = 0;
 
   Platform::instance().mutexCreate(&m_msgLock);
   if (vehiclePtr)
@@ -77,8 +90,10 @@ DataBroadcast::DataBroadcast(Vehicle* vehiclePtr)
 DataBroadcast::~DataBroadcast()
 {
   this->setUserBroadcastCallback(0, NULL);
-  unpackHandler.callback = 0;
-  unpackHandler.userData = 0;
+  unpackHandler.callback    = 0;
+  unpackHandler.userData    = 0;
+  unpackRefHandler.callback = 0;
+  unpackRefHandler.userData = 0;
 }
 
 // clang-format off
@@ -364,6 +379,34 @@ DataBroadcast::getCompassData()
     freeMSG();
     return data;
 }
+
+BroadcastSnapshot
+DataBroadcast::snapshot()
+{
+  BroadcastSnapshot data;
+  uint32_t          seq;
+  int               spins = 0;
+  for (;;)
+  {
+    seq = snapshotSeq.load(std::memory_order_acquire);
+    if (seq & 1)
+    {
+      //! Copying a frame is short, only a preempted writer takes longer
+      if (++spins >= 1000)
+      {
+        Platform::instance().taskSleepMs(1);
+        spins = 0;
+      }
+      continue;
+    }
+    data = latest;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (snapshotSeq.load(std::memory_order_relaxed) == seq)
+    {
+      return data;
+    }
+  }
+}
 // clang-format on
 
 Vehicle*
@@ -422,11 +465,11 @@ DataBroadcast::setBroadcastFreq(uint8_t* dataLenIs16, int timeout)
 }
 
 void
-DataBroadcast::unpackData(RecvContainer* pRecvFrame)
+DataBroadcast::unpackData(const RecvContainer* pRecvFrame)
 {
-  uint8_t* pdata = pRecvFrame->recvData.raw_ack_array;
+  const uint8_t* pdata = pRecvFrame->recvData.raw_ack_array;
   lockMSG();
-  passFlag = *(uint16_t*)pdata;
+  passFlag = *(const uint16_t*)pdata;
   pdata += sizeof(uint16_t);
   // clang-format off
   unpackOne(FLAG_TIME        ,&timeStamp ,pdata,sizeof(timeStamp ));
@@ -452,11 +495,11 @@ DataBroadcast::unpackData(RecvContainer* pRecvFrame)
 }
 
 void
-DataBroadcast::unpackM100Data(RecvContainer* pRecvFrame)
+DataBroadcast::unpackM100Data(const RecvContainer* pRecvFrame)
 {
-  uint8_t* pdata = pRecvFrame->recvData.raw_ack_array;
+  const uint8_t* pdata = pRecvFrame->recvData.raw_ack_array;
   lockMSG();
-  passFlag = *(uint16_t*)pdata;
+  passFlag = *(const uint16_t*)pdata;
   pdata += sizeof(uint16_t);
   // clang-format off
   unpackOne(FLAG_TIME        ,&legacyTimeStamp   ,pdata,sizeof(legacyTimeStamp ));
@@ -476,11 +519,11 @@ DataBroadcast::unpackM100Data(RecvContainer* pRecvFrame)
 }
 
 void
-DataBroadcast::unpackOldM600Data(RecvContainer* pRecvFrame)
+DataBroadcast::unpackOldM600Data(const RecvContainer* pRecvFrame)
 {
-  uint8_t* pdata = pRecvFrame->recvData.raw_ack_array;
+  const uint8_t* pdata = pRecvFrame->recvData.raw_ack_array;
   lockMSG();
-  passFlag = *(uint16_t*)pdata;
+  passFlag = *(const uint16_t*)pdata;
   pdata += sizeof(uint16_t);
   // clang-format off
   unpackOne(FLAG_TIME        ,&legacyTimeStamp   ,pdata,sizeof(legacyTimeStamp ));
@@ -502,12 +545,78 @@ DataBroadcast::unpackOldM600Data(RecvContainer* pRecvFrame)
 }
 
 void
-DataBroadcast::unpackOne(DataBroadcast::FLAG flag, void* data, uint8_t*& buf,
-                         size_t size)
+DataBroadcast::publishSnapshot()
+{
+  //! Only the receive thread changes the fields, no need for lockMSG()
+  BroadcastSnapshot data;
+  memset(&data, 0, sizeof(data));
+  data.sequence = ++frameCount;
+  Platform::instance().getTimeMs(&data.recvTimeMs);
+  data.passFlag = passFlag;
+
+  // clang-format off
+  data.q       = q;
+  data.a       = a;
+  data.w       = w;
+  data.gp      = gp;
+  data.rp      = rp;
+  data.rtk     = rtk;
+  data.mag     = mag;
+  data.rc      = rc;
+  data.gimbal  = gimbal;
+  data.info    = info;
+  data.compass = compass;
+  // clang-format on
+  if (vehicle->isLegacyM600() || vehicle->isM100())
+  {
+    data.timeStamp.time_ms  = legacyTimeStamp.time;
+    data.timeStamp.time_ns  = legacyTimeStamp.nanoTime;
+    data.syncStamp.flag     = legacyTimeStamp.syncFlag;
+    data.v.x                = legacyVelocity.x;
+    data.v.y                = legacyVelocity.y;
+    data.v.z                = legacyVelocity.z;
+    data.vi.health          = legacyVelocity.health;
+    data.vi.reserve         = legacyVelocity.reserve;
+    data.status.flight      = legacyStatus;
+    data.battery.percentage = legacyBattery;
+    if (vehicle->isLegacyM600())
+    {
+      data.gps.latitude    = legacyGPSInfo.latitude;
+      data.gps.longitude   = legacyGPSInfo.longitude;
+      data.gps.HFSL        = legacyGPSInfo.HFSL;
+      data.gps.velocityNED = legacyGPSInfo.velocityNED;
+      data.gps.time        = legacyGPSInfo.time;
+    }
+    else
+    {
+      data.gps = gps;
+    }
+  }
+  else
+  {
+    data.timeStamp = timeStamp;
+    data.syncStamp = syncStamp;
+    data.v         = v;
+    data.vi        = vi;
+    data.gps       = gps;
+    data.status    = status;
+    data.battery   = battery;
+  }
+
+  uint32_t seq = snapshotSeq.load(std::memory_order_relaxed);
+  snapshotSeq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  latest = data;
+  snapshotSeq.store(seq + 2, std::memory_order_release);
+}
+
+void
+DataBroadcast::unpackOne(DataBroadcast::FLAG flag, void* data,
+                         const uint8_t*& buf, size_t size)
 {
   if (flag & passFlag)
   {
-    memcpy((uint8_t*)data, (uint8_t*)buf, size);
+    memcpy((uint8_t*)data, buf, size);
     buf += size;
   }
 }
@@ -657,8 +766,18 @@ void
 DataBroadcast::setUserBroadcastCallback(VehicleCallBack callback,
                                         UserData        userData)
 {
-  userCbHandler.callback = callback;
-  userCbHandler.userData = userData;
+  userRefCbHandler.callback = 0;
+  userCbHandler.callback    = callback;
+  userCbHandler.userData    = userData;
+}
+
+void
+DataBroadcast::setUserBroadcastRefCallback(VehicleCallBackRef callback,
+                                           UserData           userData)
+{
+  userCbHandler.callback    = 0;
+  userRefCbHandler.callback = callback;
+  userRefCbHandler.userData = userData;
 }
 
 uint16_t
@@ -45,6 +45,7 @@ typedef struct legacyAdaptingData {
   VehicleCallBack cb;
   UserData udata;
   Vehicle *vehicle;
+  VehicleCallBackRef refCb;
 } legacyAdaptingData;
 
 typedef struct CmdListData {
@@ -134,7 +135,10 @@ E_OsdkStat legacyAdaptingRegisterCB(
     const uint8_t *cmdData, void *userData) {
   legacyAdaptingData *legacyData = (legacyAdaptingData *)userData;
   if (cmdInfo && legacyData && legacyData->vehicle) {
-    if (legacyData->cb) {
+    if (legacyData->refCb) {
+      RecvContainer recvFrame = recvFrameAdapting(*cmdInfo, cmdData);
+      legacyData->refCb(legacyData->vehicle, recvFrame, legacyData->udata);
+    } else if (legacyData->cb) {
       RecvContainer recvFrame = recvFrameAdapting(*cmdInfo, cmdData);
       legacyData->cb(legacyData->vehicle, recvFrame, legacyData->udata);
     }
@@ -417,11 +421,25 @@ void* LegacyLinker::sendSync(const uint8_t cmd[], void *pdata,
 bool LegacyLinker::registerCMDCallback(uint8_t cmdSet, uint8_t cmdID,
                                        VehicleCallBack &callback,
                                        UserData &userData) {
+  return registerAdaptingCallback(cmdSet, cmdID, callback, NULL, userData);
+}
+
+bool LegacyLinker::registerCMDCallback(uint8_t cmdSet, uint8_t cmdID,
+                                       VehicleCallBackRef &callback,
+                                       UserData &userData) {
+  return registerAdaptingCallback(cmdSet, cmdID, NULL, callback, userData);
+}
+
+bool LegacyLinker::registerAdaptingCallback(uint8_t cmdSet, uint8_t cmdID,
+                                            VehicleCallBack callback,
+                                            VehicleCallBackRef refCallback,
+                                            UserData userData) {
   for (int i = 0; i < sizeof(cmdListData) / sizeof(CmdListData); i++) {
     if ((cmdListData[i].cmdItemList.cmdSet == cmdSet)
         && (cmdListData[i].cmdItemList.cmdId == cmdID)) {
       legacyAdaptingData *handler = (legacyAdaptingData *)(cmdListData[i].cmdItemList.userData);
       handler->cb = callback;
+      handler->refCb = refCallback;
       handler->udata = userData;
       handler->vehicle = vehicle;
       cmdListData[i].cmdItemList.pFunc = legacyAdaptingRegisterCB;
@@ -104,15 +104,19 @@ DataSubscription::DataSubscription(Vehicle* vehiclePtr)
     package[i].setPackageID(i);
   }
 
-  subscriptionDataDecodeHandler.callback = decodeCallback;
-  subscriptionDataDecodeHandler.userData = this;
+  subscriptionDataDecodeHandler.callback    = decodeCallback;
+  subscriptionDataDecodeHandler.userData    = this;
+  subscriptionDataDecodeRefHandler.callback = decodeRefCallback;
+  subscriptionDataDecodeRefHandler.userData = this;
   Platform::instance().mutexCreate(&m_msgLock);
 }
 
 DataSubscription::~DataSubscription()
 {
-  subscriptionDataDecodeHandler.callback = 0;
-  subscriptionDataDecodeHandler.userData = 0;
+  subscriptionDataDecodeHandler.callback    = 0;
+  subscriptionDataDecodeHandler.userData    = 0;
+  subscriptionDataDecodeRefHandler.callback = 0;
+  subscriptionDataDecodeRefHandler.userData = 0;
 }
 
 Vehicle*
@@ -130,6 +134,14 @@ DataSubscription::getVehicle()
 void
 DataSubscription::decodeCallback(Vehicle*      vehiclePtr,
                                  RecvContainer rcvContainer, UserData subPtr)
+{
+  decodeRefCallback(vehiclePtr, rcvContainer, subPtr);
+}
+
+void
+DataSubscription::decodeRefCallback(Vehicle*             vehiclePtr,
+                                    const RecvContainer& rcvContainer,
+                                    UserData             subPtr)
 {
   DataSubscription* subscriptionHandle = (DataSubscription*)subPtr;
 
@@ -151,11 +163,8 @@ DataSubscription::decodeCallback(Vehicle*      vehiclePtr,
 
   subscriptionHandle->extractOnePackage(&rcvContainer, p);
 
-  VehicleCallBackHandler h = p->getUnpackHandler();
-  if (NULL != h.callback)
-  {
-    (*(h.callback))(vehiclePtr, rcvContainer, h.userData);
-  }
+  callVehicleCallBack(p->getUnpackRefHandler(), p->getUnpackHandler(),
+                      vehiclePtr, rcvContainer);
 }
 
 /*!
@@ -186,6 +195,15 @@ DataSubscription::registerUserPackageUnpackCallback(
                                            userData);
 }
 
+void
+DataSubscription::registerUserPackageUnpackRefCallback(
+  int packageID, VehicleCallBackRef userFunctionAfterPackageExtraction,
+  UserData userData)
+{
+  package[packageID].setUserUnpackRefCallback(
+    userFunctionAfterPackageExtraction, userData);
+}
+
 //bool
 //DataSubscription::pausePackage(int packageID)
 //{
@@ -272,6 +290,14 @@ DataSubscription::startPackage(int packageID)
   int bufferLength = package[packageID].serializePackageInfo(buffer);
   package[packageID].allocateDataBuffer();
 
+  // Without a vehicle there is no FC to ask, the package is only set up here
+  // so that recorded frames can be fed to subscriptionDataDecodeHandler
+  if (vehicle == NULL)
+  {
+    package[packageID].packageAddSuccessHandler();
+    return;
+  }
+
   // Register Callback
   VehicleCallBack cb = DataSubscription::addPackageCallback;
   UserData udata = &package[packageID];
@@ -364,7 +390,7 @@ DataSubscription::startPackage(int packageID, int timeout)
 
 // adapted from DataSubscribe::Package::unpack
 void
-DataSubscription::extractOnePackage(RecvContainer*       pRcvContainer,
+DataSubscription::extractOnePackage(const RecvContainer* pRcvContainer,
                                     SubscriptionPackage* pkg)
 {
   //  uint8_t *data = ((uint8_t *)header) + sizeof(OpenHeader) + 2;
@@ -374,7 +400,7 @@ DataSubscription::extractOnePackage(RecvContainer*       pRcvContainer,
   //          *((uint32_t *)data), *((uint32_t *)data + 1));
   //  data++;
 
-  uint8_t* data = pRcvContainer->recvData.raw_ack_array;
+  const uint8_t* data = pRcvContainer->recvData.raw_ack_array;
   data++; // skip the package ID
 
   /*
@@ -385,7 +411,7 @@ DataSubscription::extractOnePackage(RecvContainer*       pRcvContainer,
   if (pkg->getDataBuffer())
   {
     // TODO: the length needs to come from the header, not package
-    memcpy(pkg->getDataBuffer(), data, pkg->getBufferSize());
+    pkg->writeData(data);
     // memcpy(pkg->getDataBuffer(), data, header->length - CoreAPI::PackageMin -
     // 3);
   }
@@ -402,6 +428,102 @@ DataSubscription::extractOnePackage(RecvContainer*       pRcvContainer,
   freeMSG();
 }
 
+bool
+DataSubscription::readTopics(int num, const Telemetry::TopicName* topics,
+                             void* const* dst, const size_t* sizes)
+{
+  SubscriptionPackage* pkgs[MAX_NUMBER_OF_PACKAGE];
+  uint32_t             sequences[MAX_NUMBER_OF_PACKAGE];
+  bool                 allValid;
+
+  for (;;)
+  {
+    int pkgNum = 0;
+    allValid   = true;
+    for (int i = 0; i < num; i++)
+    {
+      const TopicInfo& topic = TopicDataBase[topics[i]];
+      if (topic.latest == NULL || topic.pkgID >= MAX_NUMBER_OF_PACKAGE)
+      {
+        memset(dst[i], 0xFF, sizes[i]);
+        allValid = false;
+        continue;
+      }
+
+      //! Enter every package once, before its first topic is copied
+      SubscriptionPackage* pkg = &package[topic.pkgID];
+      int                  j   = 0;
+      while (j < pkgNum && pkgs[j] != pkg)
+      {
+        j++;
+      }
+      if (j == pkgNum)
+      {
+        pkgs[pkgNum]      = pkg;
+        sequences[pkgNum] = pkg->readBegin();
+        pkgNum++;
+      }
+      memcpy(dst[i], topic.latest, sizes[i]);
+    }
+
+    bool retry = false;
+    for (int j = 0; j < pkgNum; j++)
+    {
+      retry = retry || pkgs[j]->readRetry(sequences[j]);
+    }
+    if (!retry)
+    {
+      return allValid;
+    }
+  }
+}
+
+bool
+DataSubscription::enablePackageHistory(int packageID, uint16_t depth)
+{
+  if (packageID < 0 || packageID >= MAX_NUMBER_OF_PACKAGE)
+  {
+    return false;
+  }
+  if (package[packageID].isOccupied())
+  {
+    DERROR("package [%d] is already started, enable its history before.\n",
+           packageID);
+    return false;
+  }
+  package[packageID].setHistoryDepth(depth);
+  return true;
+}
+
+bool
+DataSubscription::getHistorySample(int packageID, SubscriptionSample* sample)
+{
+  if (packageID < 0 || packageID >= MAX_NUMBER_OF_PACKAGE || sample == NULL)
+  {
+    return false;
+  }
+  return package[packageID].historyFront(sample);
+}
+
+void
+DataSubscription::releaseHistorySample(int packageID)
+{
+  if (packageID >= 0 && packageID < MAX_NUMBER_OF_PACKAGE)
+  {
+    package[packageID].historyRelease();
+  }
+}
+
+uint32_t
+DataSubscription::getHistoryDrops(int packageID)
+{
+  if (packageID < 0 || packageID >= MAX_NUMBER_OF_PACKAGE)
+  {
+    return 0;
+  }
+  return package[packageID].getHistoryDrops();
+}
+
 void
 DataSubscription::removePackage(int packageID)
 {
@@ -574,9 +696,19 @@ SubscriptionPackage::SubscriptionPackage()
   , leftOverDataFlag(false)
   , incomingDataBuffer(NULL)
   , packageDataSize(0)
+  , sequence(0)
+  , historyDepth(0)
+  , historyStride(0)
+  , historyBuffer(NULL)
+  , receivedCount(0)
+  , historyHead(0)
+  , historyTail(0)
+  , historyDrops(0)
 {
-  userUnpackHandler.callback = NULL;
-  userUnpackHandler.userData = NULL;
+  userUnpackHandler.callback    = NULL;
+  userUnpackHandler.userData    = NULL;
+  userUnpackRefHandler.callback = NULL;
+  userUnpackRefHandler.userData = NULL;
 }
 
 SubscriptionPackage::~SubscriptionPackage()
@@ -680,6 +812,22 @@ SubscriptionPackage::allocateDataBuffer()
   }
 
   incomingDataBuffer = new uint8_t[packageDataSize];
+
+  if (historyBuffer)
+  {
+    delete[] historyBuffer;
+    historyBuffer = NULL;
+  }
+  receivedCount = 0;
+  historyHead.store(0, std::memory_order_relaxed);
+  historyTail.store(0, std::memory_order_relaxed);
+  historyDrops.store(0, std::memory_order_relaxed);
+  if (historyDepth > 0)
+  {
+    //! Keep the payload of every slot 8-byte aligned
+    historyStride = (sizeof(HistoryMeta) + packageDataSize + 7) & ~7u;
+    historyBuffer = new uint8_t[historyStride * (historyDepth + 1)];
+  }
 }
 
 void
@@ -693,9 +841,12 @@ SubscriptionPackage::cleanUpPackage()
   memset(topicList, 0xFF, sizeof(topicList));
   memset(offsetList, 0, sizeof(offsetList));
 
-  packageDataSize            = 0;
-  userUnpackHandler.callback = NULL;
-  userUnpackHandler.userData = NULL;
+  packageDataSize               = 0;
+  userUnpackHandler.callback    = NULL;
+  userUnpackHandler.userData    = NULL;
+  userUnpackRefHandler.callback = NULL;
+  userUnpackRefHandler.userData = NULL;
+  historyDepth                  = 0;
   clearDataBuffer();
 }
 
@@ -707,6 +858,11 @@ SubscriptionPackage::clearDataBuffer()
     delete[] incomingDataBuffer;
     incomingDataBuffer = NULL;
   }
+  if (historyBuffer)
+  {
+    delete[] historyBuffer;
+    historyBuffer = NULL;
+  }
 }
 
 int
@@ -726,8 +882,18 @@ void
 SubscriptionPackage::setUserUnpackCallback(
   VehicleCallBack userFunctionAfterPackageExtraction, UserData userData)
 {
-  userUnpackHandler.callback = userFunctionAfterPackageExtraction;
-  userUnpackHandler.userData = userData;
+  userUnpackRefHandler.callback = NULL;
+  userUnpackHandler.callback    = userFunctionAfterPackageExtraction;
+  userUnpackHandler.userData    = userData;
+}
+
+void
+SubscriptionPackage::setUserUnpackRefCallback(
+  VehicleCallBackRef userFunctionAfterPackageExtraction, UserData userData)
+{
+  userUnpackHandler.callback    = NULL;
+  userUnpackRefHandler.callback = userFunctionAfterPackageExtraction;
+  userUnpackRefHandler.userData = userData;
 }
 
 SubscriptionPackage::PackageInfo
@@ -772,6 +938,157 @@ SubscriptionPackage::getUnpackHandler()
   return userUnpackHandler;
 }
 
+VehicleCallBackRefHandler
+SubscriptionPackage::getUnpackRefHandler()
+{
+  return userUnpackRefHandler;
+}
+
+void
+SubscriptionPackage::writeData(const uint8_t* data)
+{
+  uint32_t seq = sequence.load(std::memory_order_relaxed);
+  sequence.store(seq + 1, std::memory_order_relaxed);
+  //! Readers must not see the new bytes before the odd sequence
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(incomingDataBuffer, data, packageDataSize);
+  sequence.store(seq + 2, std::memory_order_release);
+
+  if (historyBuffer)
+  {
+    pushHistory(data);
+  }
+}
+
+void
+SubscriptionPackage::pushHistory(const uint8_t* data)
+{
+  uint32_t index = receivedCount++;
+  uint32_t head  = historyHead.load(std::memory_order_relaxed);
+  uint32_t next  = (head == historyDepth) ? 0 : head + 1;
+  if (next == historyTail.load(std::memory_order_acquire))
+  {
+    historyDrops.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  uint8_t*     slot = historyBuffer + head * historyStride;
+  HistoryMeta* meta = (HistoryMeta*)slot;
+  meta->index       = index;
+  meta->recvTimeMs  = 0;
+  Platform::instance().getTimeMs(&meta->recvTimeMs);
+  memcpy(slot + sizeof(HistoryMeta), data, packageDataSize);
+
+  historyHead.store(next, std::memory_order_release);
+}
+
+void
+SubscriptionPackage::setHistoryDepth(uint16_t depth)
+{
+  historyDepth = depth;
+}
+
+uint16_t
+SubscriptionPackage::getHistoryDepth()
+{
+  return historyDepth;
+}
+
+bool
+SubscriptionPackage::historyFront(SubscriptionSample* sample)
+{
+  uint32_t tail = historyTail.load(std::memory_order_relaxed);
+  if (historyBuffer == NULL ||
+      tail == historyHead.load(std::memory_order_acquire))
+  {
+    return false;
+  }
+
+  const uint8_t*     slot = historyBuffer + tail * historyStride;
+  const HistoryMeta* meta = (const HistoryMeta*)slot;
+  sample->packageID       = info.packageID;
+  sample->index           = meta->index;
+  sample->recvTimeMs      = meta->recvTimeMs;
+  sample->data            = slot + sizeof(HistoryMeta);
+  sample->hasFcTime       = (info.config == 1);
+  if (sample->hasFcTime)
+  {
+    //! The FC puts its time stamp in front of the topics
+    memcpy(&sample->fcTime, sample->data, sizeof(sample->fcTime));
+  }
+  else
+  {
+    memset(&sample->fcTime, 0, sizeof(sample->fcTime));
+  }
+  return true;
+}
+
+void
+SubscriptionPackage::historyRelease()
+{
+  uint32_t tail = historyTail.load(std::memory_order_relaxed);
+  if (historyBuffer == NULL ||
+      tail == historyHead.load(std::memory_order_acquire))
+  {
+    return;
+  }
+  historyTail.store((tail == historyDepth) ? 0 : tail + 1,
+                    std::memory_order_release);
+}
+
+uint32_t
+SubscriptionPackage::getHistorySize()
+{
+  uint32_t head = historyHead.load(std::memory_order_acquire);
+  uint32_t tail = historyTail.load(std::memory_order_acquire);
+  return (head >= tail) ? head - tail : head + historyDepth + 1 - tail;
+}
+
+uint32_t
+SubscriptionPackage::getHistoryDrops()
+{
+  return historyDrops.load(std::memory_order_relaxed);
+}
+
+bool
+SubscriptionPackage::readSampleTopic(const SubscriptionSample& sample,
+                                     TopicName topic, void* dst, size_t size)
+{
+  for (int i = 0; i < info.numberOfTopics; i++)
+  {
+    if (topicList[i] == topic)
+    {
+      memcpy(dst, sample.data + offsetList[i], size);
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t
+SubscriptionPackage::readBegin() const
+{
+  uint32_t seq;
+  int      spins = 0;
+  while ((seq = sequence.load(std::memory_order_acquire)) & 1)
+  {
+    //! A package copy is short, only a preempted writer takes longer
+    if (++spins >= 1000)
+    {
+      Platform::instance().taskSleepMs(1);
+      spins = 0;
+    }
+  }
+  return seq;
+}
+
+bool
+SubscriptionPackage::readRetry(uint32_t seq) const
+{
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return sequence.load(std::memory_order_relaxed) != seq;
+}
+
 void
 SubscriptionPackage::packageAddSuccessHandler()
 {
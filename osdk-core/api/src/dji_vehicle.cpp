@@ -495,8 +495,8 @@ Vehicle::initSubscriber()
     bool ret = this->legacyLinker->registerCMDCallback(
         OpenProtocolCMD::CMDSet::Broadcast::subscribe[0],
         OpenProtocolCMD::CMDSet::Broadcast::subscribe[1],
-        this->subscribe->subscriptionDataDecodeHandler.callback,
-        this->subscribe->subscriptionDataDecodeHandler.userData);
+        this->subscribe->subscriptionDataDecodeRefHandler.callback,
+        this->subscribe->subscriptionDataDecodeRefHandler.userData);
     /*
      * Wait for 1.2 seconds, so we can detect all leftover
      * packages from unclean quit, and remove them properly
@@ -537,8 +537,8 @@ Vehicle::initBroadcast()
     bool ret = this->legacyLinker->registerCMDCallback(
         OpenProtocolCMD::CMDSet::Broadcast::broadcast[0],
         OpenProtocolCMD::CMDSet::Broadcast::broadcast[1],
-        this->broadcast->unpackHandler.callback,
-        this->broadcast->unpackHandler.userData);
+        this->broadcast->unpackRefHandler.callback,
+        this->broadcast->unpackRefHandler.userData);
     if (!ret) DERROR("Register broadcast callback fail.");
     return ret;
   }
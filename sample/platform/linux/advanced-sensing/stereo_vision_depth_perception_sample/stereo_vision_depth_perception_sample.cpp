@@ -57,15 +57,18 @@ main(int argc, char** argv)
   vehicle->control->obtainCtrlAuthority(functionTimeout);
 
   /*! get stereo camera parameters */
+  std::string yaml_file_path;
   if (vehicle->isM210V2()) {
-    std::string yaml_file_path = argv[2];
+    yaml_file_path = argv[2];
     M210_STEREO::Config::setParamFile(yaml_file_path);
   } else if (vehicle->isM300()) {
     M300StereoParamTool *tool = new M300StereoParamTool(vehicle);
     Perception::CamParamType stereoParam =
         tool->getM300stereoParams(Perception::DirectionType::RECTIFY_FRONT);
-    if (tool->createStereoParamsYamlFile(M300_FRONT_STEREO_PARAM_YAML_NAME, stereoParam))
-      tool->setParamFileForM300(M300_FRONT_STEREO_PARAM_YAML_NAME);
+    if (tool->createStereoParamsYamlFile(M300_FRONT_STEREO_PARAM_YAML_NAME, stereoParam)) {
+      yaml_file_path = M300_FRONT_STEREO_PARAM_YAML_NAME;
+      tool->setParamFileForM300(yaml_file_path);
+    }
     else
       return -1;
   }
@@ -83,6 +86,7 @@ main(int argc, char** argv)
     << "| [c] Display filtered disparity map                             |\n"
     << "| [d] Display point cloud                                        |\n"
     << "| [e] Unsubscribe to VGA front stereo images                     |\n"
+    << "| [f] Compute front depth maps with the depth engine             |\n"
     << std::endl;
   char inputChar = ' ';
   std::cin >> inputChar;
@@ -132,6 +136,19 @@ main(int argc, char** argv)
       vehicle->advancedSensing->unsubscribeVGAImages();
     }
       break;
+    case 'f':
+    {
+      // rectify, match and depth of consecutive frames run in parallel on
+      // the engine's worker threads, off the reading thread
+      depth_engine_ptr = new M210_STEREO::StereoDepthEngine();
+      if (!depth_engine_ptr->addDirection(Perception::DirectionType::RECTIFY_FRONT, yaml_file_path)) {
+        DERROR("Failed to create the front depth pipeline\n");
+        return -1;
+      }
+      depth_engine_ptr->setDepthCallback(&displayDepthCallback, NULL);
+      vehicle->advancedSensing->subscribeFrontStereoVGA(AdvancedSensingProtocol::FREQ_20HZ, &submitStereoImgVGACallback, NULL);
+    }
+      break;
     default:
       break;
   }
@@ -145,6 +162,17 @@ main(int argc, char** argv)
   sleep(1);
   DSTATUS("waited 1 second for the image subscription to stop completely\n");
 
+  if (depth_engine_ptr) {
+    M210_STEREO::StereoDepthEngine::DirectionStat stat =
+        depth_engine_ptr->getStat(Perception::DirectionType::RECTIFY_FRONT);
+    DSTATUS("depth engine: %llu pairs, %llu depth maps, %llu replaced, "
+            "rectify %.1f ms, match %.1f ms, depth %.1f ms, latency %.1f ms (max %.1f ms)",
+            (unsigned long long)stat.submitted, (unsigned long long)stat.published,
+            (unsigned long long)stat.replaced, stat.rectify_ms, stat.match_ms,
+            stat.depth_ms, stat.latency_ms, stat.max_latency_ms);
+    delete depth_engine_ptr;
+  }
+
   return 0;
 }
 
@@ -163,3 +191,22 @@ void storeStereoImgVGACallback(Vehicle *vehiclePtr, RecvContainer recvFrame, Use
   // mechanism in image process thread
   image_process_container_ptr->copyVGAImg(recvFrame.recvData.stereoVGAImgData);
 }
+
+//! @note This callback is running on reading thread, it only copies the
+//! pair into the depth engine
+void submitStereoImgVGACallback(Vehicle *vehiclePtr, RecvContainer recvFrame, UserData userData)
+{
+  const ACK::StereoVGAImgData *imgs = recvFrame.recvData.stereoVGAImgData;
+  depth_engine_ptr->submit(Perception::DirectionType::RECTIFY_FRONT,
+                           imgs->img_vec[0], imgs->img_vec[1],
+                           imgs->frame_index, imgs->time_stamp);
+}
+
+//! @note This callback is running on a depth engine worker
+void displayDepthCallback(const M210_STEREO::StereoDepthEngine::DepthResult &result, void *userData)
+{
+  double min_depth, max_depth;
+  cv::minMaxLoc(result.depth, &min_depth, &max_depth);
+  DSTATUS("depth map of frame %llu, max depth %.1f m, latency %.1f ms",
+          (unsigned long long)result.frame_id, max_depth, result.latency_ms);
+}
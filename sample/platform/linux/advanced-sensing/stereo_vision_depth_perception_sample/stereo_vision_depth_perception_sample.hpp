@@ -18,10 +18,16 @@
 // Utility
 #include "utility_thread.hpp"
 #include "stereo_process_container.hpp"
+#include "stereo_depth_engine.hpp"
 
 ImageProcessContainer* image_process_container_ptr;
+M210_STEREO::StereoDepthEngine* depth_engine_ptr = NULL;
 
 static void storeStereoImgVGACallback(DJI::OSDK::Vehicle *vehiclePtr, DJI::OSDK::RecvContainer recvFrame, DJI::OSDK::UserData userData);
 
+static void submitStereoImgVGACallback(DJI::OSDK::Vehicle *vehiclePtr, DJI::OSDK::RecvContainer recvFrame, DJI::OSDK::UserData userData);
+
+static void displayDepthCallback(const M210_STEREO::StereoDepthEngine::DepthResult &result, void *userData);
+
 
 #endif //ONBOARDSDK_ADVANCED_SENSING_DEPTH_PERCEPTION_SAMPLE_HPP
@@ -49,7 +49,7 @@ Config::instancePtr()
   return Config::single_instance_;
 }
 
-void
+bool
 Config::setParamFile(const std::string& file_name)
 {
   if(!Config::single_instance_)
@@ -63,5 +63,7 @@ Config::setParamFile(const std::string& file_name)
   {
     std::cerr << "Failed to open " << file_name << " file\n";
     Config::instancePtr()->file_.release();
+    return false;
   }
+  return true;
 }
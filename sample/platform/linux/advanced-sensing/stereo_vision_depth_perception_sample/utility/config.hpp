@@ -19,7 +19,8 @@ public:
 
   static Config* instancePtr();
 
-  static void setParamFile(const std::string& file_name);
+  //! Returns false when the file could not be opened
+  static bool setParamFile(const std::string& file_name);
 
   template <typename T>
   static T get(const std::string& key)
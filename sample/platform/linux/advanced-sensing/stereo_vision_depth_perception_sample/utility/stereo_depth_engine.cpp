@@ -0,0 +1,323 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "stereo_depth_engine.hpp"
+#include "config.hpp"
+
+using namespace M210_STEREO;
+using namespace cv;
+
+StereoDepthEngine::StereoDepthEngine(int thread_num)
+  : cb_(NULL)
+  , cb_user_data_(NULL)
+  , pool_(thread_num)
+{
+}
+
+StereoDepthEngine::~StereoDepthEngine()
+{
+}
+
+bool
+StereoDepthEngine::addDirection(DirectionType direction, const std::string &param_file)
+{
+  if((int)direction >= DIRECTION_NUM)
+  {
+    DERROR("Invalid stereo direction %d\n", direction);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(config_mutex_);
+  if(pipelines_[direction])
+  {
+    DERROR("Stereo direction %d is already added\n", direction);
+    return false;
+  }
+
+  // CameraParam and StereoFrame read their parameters from the Config singleton
+  if(!Config::setParamFile(param_file))
+  {
+    DERROR("Failed to load the parameters of stereo direction %d\n", direction);
+    return false;
+  }
+
+  std::unique_ptr<Pipeline> pipe(new Pipeline());
+  pipe->direction = direction;
+  CameraParam::Ptr left_cam  = CameraParam::createCameraParam(CameraParam::FRONT_LEFT);
+  CameraParam::Ptr right_cam = CameraParam::createCameraParam(CameraParam::FRONT_RIGHT);
+  for(int i = 0; i < SLOT_NUM; ++i)
+  {
+    pipe->slots[i].frame = StereoFrame::createStereoFrame(left_cam, right_cam);
+    pipe->slots[i].busy  = false;
+    if(!pipe->slots[i].frame->isValid())
+    {
+      DERROR("Failed to build the pipeline of stereo direction %d\n", direction);
+      return false;
+    }
+  }
+  pipe->has_waiting   = false;
+  pipe->waiting_left.resize(VGA_WIDTH*VGA_HEIGHT);
+  pipe->waiting_right.resize(VGA_WIDTH*VGA_HEIGHT);
+  pipe->has_published = false;
+  pipe->last_published_id = 0;
+  pipe->latest.direction  = direction;
+  pipe->latest.frame_id   = 0;
+  pipe->latest.time_stamp = 0;
+  pipe->latest.latency_ms = 0;
+  memset(&pipe->stat, 0, sizeof(pipe->stat));
+
+  pipelines_[direction] = std::move(pipe);
+  return true;
+}
+
+void
+StereoDepthEngine::setDepthCallback(DepthCallback cb, void *user_data)
+{
+  std::lock_guard<std::mutex> lock(config_mutex_);
+  cb_           = cb;
+  cb_user_data_ = user_data;
+}
+
+StereoDepthEngine::Pipeline *
+StereoDepthEngine::getPipeline(DirectionType direction)
+{
+  if((int)direction >= DIRECTION_NUM)
+  {
+    return NULL;
+  }
+  std::lock_guard<std::mutex> lock(config_mutex_);
+  return pipelines_[direction].get();
+}
+
+bool
+StereoDepthEngine::submit(DirectionType direction, const uint8_t *left_img,
+                          const uint8_t *right_img, uint64_t frame_id,
+                          uint32_t time_stamp)
+{
+  Pipeline *pipe = getPipeline(direction);
+  if(!pipe || !left_img || !right_img)
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(pipe->mutex);
+  pipe->stat.submitted++;
+
+  for(int i = 0; i < SLOT_NUM; ++i)
+  {
+    Slot &slot = pipe->slots[i];
+    if(!slot.busy)
+    {
+      slot.busy        = true;
+      slot.frame_id    = frame_id;
+      slot.time_stamp  = time_stamp;
+      slot.submit_time = Clock::now();
+      slot.frame->readStereoImgs(left_img, right_img, frame_id, time_stamp);
+      startSlot(pipe, &slot);
+      return true;
+    }
+  }
+
+  // every slot is in flight, keep the newest pair for the first one to free up
+  if(pipe->has_waiting)
+  {
+    pipe->stat.replaced++;
+  }
+  memcpy(&pipe->waiting_left[0], left_img, VGA_WIDTH*VGA_HEIGHT);
+  memcpy(&pipe->waiting_right[0], right_img, VGA_WIDTH*VGA_HEIGHT);
+  pipe->waiting_id          = frame_id;
+  pipe->waiting_time_stamp  = time_stamp;
+  pipe->waiting_submit_time = Clock::now();
+  pipe->has_waiting         = true;
+  return true;
+}
+
+void
+StereoDepthEngine::startSlot(Pipeline *pipe, Slot *slot)
+{
+  // new frames queue up oldest first behind the other directions, a
+  // worker's own deque would run this direction's next frame first
+  pool_.post([this, pipe, slot] { runRectify(pipe, slot); });
+}
+
+void
+StereoDepthEngine::runRectify(Pipeline *pipe, Slot *slot)
+{
+  Clock::time_point start = Clock::now();
+  slot->frame->rectifyImgs();
+  double ms = elapsedMs(start);
+  {
+    std::lock_guard<std::mutex> lock(pipe->mutex);
+    updateAverage(pipe->stat.rectify_ms, ms);
+  }
+  // posted to this worker's own deque, idle workers steal it if this one
+  // picks up the rectification of the next frame first
+  pool_.submit([this, pipe, slot] { runMatch(pipe, slot); });
+}
+
+void
+StereoDepthEngine::runMatch(Pipeline *pipe, Slot *slot)
+{
+  Clock::time_point start = Clock::now();
+  slot->frame->computeDisparityMap();
+  slot->frame->filterDisparityMap();
+  double ms = elapsedMs(start);
+  {
+    std::lock_guard<std::mutex> lock(pipe->mutex);
+    updateAverage(pipe->stat.match_ms, ms);
+  }
+  runDepth(pipe, slot);
+}
+
+void
+StereoDepthEngine::runDepth(Pipeline *pipe, Slot *slot)
+{
+  Clock::time_point start = Clock::now();
+
+  // disparity comes in 1/16 px, anything below 6 px (8.6m) is dropped
+  slot->frame->getRawDisparityMap().convertTo(slot->disparity_px, CV_32F, 0.0625);
+  divide(slot->frame->getBaselineXFx(), slot->disparity_px, slot->depth);
+  compare(slot->disparity_px, 6, slot->invalid_mask, CMP_LT);
+  slot->depth.setTo(0, slot->invalid_mask);
+
+  double ms = elapsedMs(start);
+  {
+    std::lock_guard<std::mutex> lock(pipe->mutex);
+    updateAverage(pipe->stat.depth_ms, ms);
+  }
+  publish(pipe, slot);
+}
+
+void
+StereoDepthEngine::publish(Pipeline *pipe, Slot *slot)
+{
+  DepthResult result;
+  result.direction  = pipe->direction;
+  result.frame_id   = slot->frame_id;
+  result.time_stamp = slot->time_stamp;
+  result.depth      = slot->depth;
+  result.latency_ms = elapsedMs(slot->submit_time);
+
+  bool in_order;
+  {
+    std::lock_guard<std::mutex> lock(pipe->mutex);
+    in_order = !pipe->has_published || (slot->frame_id > pipe->last_published_id);
+    if(in_order)
+    {
+      pipe->has_published     = true;
+      pipe->last_published_id = slot->frame_id;
+      pipe->latest.frame_id   = result.frame_id;
+      pipe->latest.time_stamp = result.time_stamp;
+      pipe->latest.latency_ms = result.latency_ms;
+      slot->depth.copyTo(pipe->latest.depth);
+
+      DirectionStat &stat = pipe->stat;
+      stat.published++;
+      updateAverage(stat.latency_ms, result.latency_ms);
+      stat.max_latency_ms = std::max(stat.max_latency_ms, result.latency_ms);
+    }
+    else
+    {
+      pipe->stat.out_of_order++;
+    }
+  }
+
+  if(in_order)
+  {
+    DepthCallback cb;
+    void *user_data;
+    {
+      std::lock_guard<std::mutex> lock(config_mutex_);
+      cb        = cb_;
+      user_data = cb_user_data_;
+    }
+    if(cb)
+    {
+      cb(result, user_data);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(pipe->mutex);
+  if(pipe->has_waiting)
+  {
+    pipe->has_waiting = false;
+    slot->frame_id    = pipe->waiting_id;
+    slot->time_stamp  = pipe->waiting_time_stamp;
+    slot->submit_time = pipe->waiting_submit_time;
+    slot->frame->readStereoImgs(&pipe->waiting_left[0], &pipe->waiting_right[0],
+                                pipe->waiting_id, pipe->waiting_time_stamp);
+    startSlot(pipe, slot);
+  }
+  else
+  {
+    slot->busy = false;
+  }
+}
+
+bool
+StereoDepthEngine::getLatestDepth(DirectionType direction, DepthResult &result)
+{
+  Pipeline *pipe = getPipeline(direction);
+  if(!pipe)
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(pipe->mutex);
+  if(!pipe->has_published)
+  {
+    return false;
+  }
+  result.direction  = pipe->latest.direction;
+  result.frame_id   = pipe->latest.frame_id;
+  result.time_stamp = pipe->latest.time_stamp;
+  result.latency_ms = pipe->latest.latency_ms;
+  pipe->latest.depth.copyTo(result.depth);
+  return true;
+}
+
+StereoDepthEngine::DirectionStat
+StereoDepthEngine::getStat(DirectionType direction)
+{
+  DirectionStat stat;
+  memset(&stat, 0, sizeof(stat));
+
+  Pipeline *pipe = getPipeline(direction);
+  if(pipe)
+  {
+    std::lock_guard<std::mutex> lock(pipe->mutex);
+    stat = pipe->stat;
+  }
+  return stat;
+}
+
+double
+StereoDepthEngine::elapsedMs(Clock::time_point from)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - from).count();
+}
+
+void
+StereoDepthEngine::updateAverage(double &average, double sample)
+{
+  // exponential moving average over roughly the last 16 frames
+  average = (average == 0) ? sample : average + (sample - average) / 16.0;
+}
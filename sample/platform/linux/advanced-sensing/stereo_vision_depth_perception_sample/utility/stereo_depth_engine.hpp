@@ -0,0 +1,129 @@
+#ifndef ONBOARDSDK_STEREO_DEPTH_ENGINE_H
+#define ONBOARDSDK_STEREO_DEPTH_ENGINE_H
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "dji_perception.hpp"
+#include "stereo_frame.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace M210_STEREO
+{
+
+//! Runs one StereoFrame pipeline per perception direction on a shared
+//! WorkStealingPool. Every direction owns SLOT_NUM StereoFrames, so while
+//! frame N is being matched, frame N+1 can already be rectified. The
+//! depth maps are published per direction, in frame order.
+class StereoDepthEngine
+{
+public:
+  typedef std::shared_ptr<StereoDepthEngine> Ptr;
+  typedef DJI::OSDK::Perception::DirectionType DirectionType;
+
+  static const int DIRECTION_NUM = IMAGE_MAX_DIRECTION_NUM;
+  static const int SLOT_NUM      = 2;
+
+  struct DepthResult
+  {
+    DirectionType direction;
+    uint64_t      frame_id;
+    uint32_t      time_stamp;
+    cv::Mat       depth;        // CV_32FC1 in meters, 0 where there is no disparity
+    double        latency_ms;   // from submit() to publishing
+  };
+
+  struct DirectionStat
+  {
+    uint64_t submitted;     // pairs passed to submit()
+    uint64_t replaced;      // waiting pairs replaced by a newer one
+    uint64_t published;     // depth maps published
+    uint64_t out_of_order;  // results dropped because a newer one was out first
+    double   rectify_ms;    // moving averages of the stages
+    double   match_ms;
+    double   depth_ms;
+    double   latency_ms;
+    double   max_latency_ms;
+  };
+
+  //! Called on a pool thread, result.depth is only valid inside the callback
+  typedef void (*DepthCallback)(const DepthResult &result, void *user_data);
+
+  explicit StereoDepthEngine(int thread_num = 0);
+  ~StereoDepthEngine();
+
+  //! Load the stereo parameters of a direction from its yaml file and build
+  //! its pipeline. Config is process wide, so it is pointed at param_file.
+  bool addDirection(DirectionType direction, const std::string &param_file);
+
+  void setDepthCallback(DepthCallback cb, void *user_data);
+
+  //! Copy one rectifiable VGA pair in. When every slot of the direction is
+  //! busy, only the newest pair is kept until one is free.
+  bool submit(DirectionType direction, const uint8_t *left_img,
+              const uint8_t *right_img, uint64_t frame_id, uint32_t time_stamp);
+
+  //! Copy of the last published depth map of a direction
+  bool getLatestDepth(DirectionType direction, DepthResult &result);
+
+  DirectionStat getStat(DirectionType direction);
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Slot
+  {
+    StereoFrame::Ptr  frame;
+    bool              busy;
+    uint64_t          frame_id;
+    uint32_t          time_stamp;
+    Clock::time_point submit_time;
+    cv::Mat           disparity_px;
+    cv::Mat           invalid_mask;
+    cv::Mat           depth;
+  };
+
+  struct Pipeline
+  {
+    DirectionType         direction;
+    std::mutex            mutex;
+    Slot                  slots[SLOT_NUM];
+
+    bool                  has_waiting;
+    std::vector<uint8_t>  waiting_left;
+    std::vector<uint8_t>  waiting_right;
+    uint64_t              waiting_id;
+    uint32_t              waiting_time_stamp;
+    Clock::time_point     waiting_submit_time;
+
+    bool                  has_published;
+    uint64_t              last_published_id;
+    DepthResult           latest;
+    DirectionStat         stat;
+  };
+
+  Pipeline *getPipeline(DirectionType direction);
+  void startSlot(Pipeline *pipe, Slot *slot);
+  void runRectify(Pipeline *pipe, Slot *slot);
+  void runMatch(Pipeline *pipe, Slot *slot);
+  void runDepth(Pipeline *pipe, Slot *slot);
+  void publish(Pipeline *pipe, Slot *slot);
+
+  static double elapsedMs(Clock::time_point from);
+  static void updateAverage(double &average, double sample);
+
+  std::mutex                      config_mutex_;
+  std::unique_ptr<Pipeline>       pipelines_[DIRECTION_NUM];
+  DepthCallback                   cb_;
+  void                           *cb_user_data_;
+
+  // declared last, so its workers are joined before the pipelines go away
+  WorkStealingPool                pool_;
+};
+
+} // namespace M210_STEREO
+
+#endif //ONBOARDSDK_STEREO_DEPTH_ENGINE_H
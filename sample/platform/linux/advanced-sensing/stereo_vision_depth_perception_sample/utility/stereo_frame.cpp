@@ -20,10 +20,133 @@
  */
 
 #include "stereo_frame.hpp"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+  #include <immintrin.h>
+#elif defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
 
 using namespace M210_STEREO;
 using namespace cv;
 
+std::string StereoFrame::rect_map_cache_dir_;
+
+// Fixed-point maps: remap does integer bilinear interpolation with
+// them and they take half the memory of two CV_32FC1 maps
+static const int RECTIFY_MAP_TYPE = CV_16SC2;
+
+// StereoBM outputs disparities in 1/16 px, 96 is the 6 px (8.6m) cut-off
+static const short MIN_RAW_DISPARITY = 6 * 16;
+
+static inline int
+packValidLanes(int mask, const float *xs, const float *ys, const float *zs,
+               const uint8_t *gray, Vec3f *out_pts, uint8_t *out_colors)
+{
+  int n = 0;
+  while(mask)
+  {
+    int i = __builtin_ctz(mask);
+    mask &= mask - 1;
+    out_pts[n]    = Vec3f(xs[i], ys[i], zs[i]);
+    out_colors[n] = gray[i];
+    ++n;
+  }
+  return n;
+}
+
+/*! Unproject the pixels [u_begin, u_end) of one row and write the valid
+ *  ones back to back. bf16 is baseline * fx * 16, so z = bf16 / raw disparity.
+ *  Returns the number of points written.
+ */
+static int
+unprojectRow(const short *disp, const uint8_t *gray, const float *x_lut,
+             float y_k, float bf16, int u_begin, int u_end,
+             Vec3f *out_pts, uint8_t *out_colors)
+{
+  int n = 0;
+  int u = u_begin;
+
+#if defined(__AVX2__)
+  alignas(32) float xs[8], ys[8], zs[8];
+  const __m256  bf  = _mm256_set1_ps(bf16);
+  const __m256  yk  = _mm256_set1_ps(y_k);
+  const __m256i thr = _mm256_set1_epi32(MIN_RAW_DISPARITY - 1);
+  for(; u + 8 <= u_end; u += 8)
+  {
+    __m256i d = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(disp + u)));
+    int mask  = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(d, thr)));
+    if(!mask) continue;
+
+    __m256 z = _mm256_div_ps(bf, _mm256_cvtepi32_ps(d));
+    _mm256_store_ps(zs, z);
+    _mm256_store_ps(xs, _mm256_mul_ps(_mm256_loadu_ps(x_lut + u), z));
+    _mm256_store_ps(ys, _mm256_mul_ps(yk, z));
+    n += packValidLanes(mask, xs, ys, zs, gray + u, out_pts + n, out_colors + n);
+  }
+#elif defined(__SSE2__)
+  alignas(16) float xs[4], ys[4], zs[4];
+  const __m128  bf  = _mm_set1_ps(bf16);
+  const __m128  yk  = _mm_set1_ps(y_k);
+  const __m128i thr = _mm_set1_epi32(MIN_RAW_DISPARITY - 1);
+  for(; u + 4 <= u_end; u += 4)
+  {
+    __m128i d16 = _mm_loadl_epi64((const __m128i *)(disp + u));
+    __m128i d   = _mm_srai_epi32(_mm_unpacklo_epi16(d16, d16), 16);
+    int mask    = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(d, thr)));
+    if(!mask) continue;
+
+    __m128 z = _mm_div_ps(bf, _mm_cvtepi32_ps(d));
+    _mm_store_ps(zs, z);
+    _mm_store_ps(xs, _mm_mul_ps(_mm_loadu_ps(x_lut + u), z));
+    _mm_store_ps(ys, _mm_mul_ps(yk, z));
+    n += packValidLanes(mask, xs, ys, zs, gray + u, out_pts + n, out_colors + n);
+  }
+#elif defined(__ARM_NEON)
+  float xs[4], ys[4], zs[4];
+  uint32_t valid[4];
+  const float32x4_t bf  = vdupq_n_f32(bf16);
+  const int32x4_t   thr = vdupq_n_s32(MIN_RAW_DISPARITY - 1);
+  for(; u + 4 <= u_end; u += 4)
+  {
+    int32x4_t d = vmovl_s16(vld1_s16(disp + u));
+    vst1q_u32(valid, vcgtq_s32(d, thr));
+    int mask = (valid[0] & 1) | (valid[1] & 2) | (valid[2] & 4) | (valid[3] & 8);
+    if(!mask) continue;
+
+    float32x4_t df = vcvtq_f32_s32(d);
+  #if defined(__aarch64__)
+    float32x4_t z = vdivq_f32(bf, df);
+  #else
+    // ARMv7 has no vector divide, refine the reciprocal estimate twice
+    float32x4_t r = vrecpeq_f32(df);
+    r = vmulq_f32(vrecpsq_f32(df, r), r);
+    r = vmulq_f32(vrecpsq_f32(df, r), r);
+    float32x4_t z = vmulq_f32(bf, r);
+  #endif
+    vst1q_f32(zs, z);
+    vst1q_f32(xs, vmulq_f32(vld1q_f32(x_lut + u), z));
+    vst1q_f32(ys, vmulq_n_f32(z, y_k));
+    n += packValidLanes(mask, xs, ys, zs, gray + u, out_pts + n, out_colors + n);
+  }
+#endif
+
+  for(; u < u_end; ++u)
+  {
+    if(disp[u] >= MIN_RAW_DISPARITY)
+    {
+      float z = bf16 / disp[u];
+      out_pts[n]    = Vec3f(x_lut[u] * z, y_k * z, z);
+      out_colors[n] = gray[u];
+      ++n;
+    }
+  }
+  return n;
+}
+
 StereoFrame::StereoFrame(CameraParam::Ptr left_cam,
                          CameraParam::Ptr right_cam,
                          int num_disp, int block_size)
@@ -31,13 +154,17 @@ StereoFrame::StereoFrame(CameraParam::Ptr left_cam,
   , camera_right_ptr_(right_cam)
   , num_disp_(num_disp)
   , block_size_(block_size)
-  , color_buffer_(VGA_WIDTH*VGA_HEIGHT)
-  , mat_vec3_pt_(VGA_HEIGHT, VGA_WIDTH, Vec3f(0, 0, 0))
-  , color_mat_(VGA_HEIGHT, VGA_WIDTH, CV_8UC1, &color_buffer_[0])
-  , pt_cloud_(mat_vec3_pt_, color_mat_)
+  , unproject_x_lut_(VGA_WIDTH)
+  , unproject_y_lut_(VGA_HEIGHT)
+  , packed_pts_(VGA_WIDTH*VGA_HEIGHT, Vec3f(NAN, NAN, NAN))
+  , packed_colors_(VGA_WIDTH*VGA_HEIGHT)
+  , row_pt_num_(VGA_HEIGHT)
+  , packed_pt_num_(0)
+  , pt_cloud_(Mat(1, 1, CV_32FC3, &packed_pts_[0]), Mat(1, 1, CV_8UC1, &packed_colors_[0]))
   , raw_disparity_map_(Mat(VGA_HEIGHT, VGA_WIDTH, CV_16SC1))
 {
-  if(!this->initStereoParam())
+  param_valid_ = this->initStereoParam();
+  if(!param_valid_)
   {
     DERROR("Failed to init stereo parameters\n");
   }
@@ -62,30 +189,39 @@ StereoFrame::initStereoParam()
   param_proj_left_ =  Config::get<Mat>("leftProjectionMatrix");
   param_proj_right_ = Config::get<Mat>("rightProjectionMatrix");
 
+  if(param_rect_left_.empty() || param_rect_right_.empty() ||
+     param_proj_left_.empty() || param_proj_right_.empty() ||
+     camera_left_ptr_->getIntrinsic().empty() ||
+     camera_right_ptr_->getIntrinsic().empty())
+  {
+    return false;
+  }
+
   principal_x_ = param_proj_left_.at<double>(0, 2);
   principal_y_ = param_proj_left_.at<double>(1, 2);
   fx_ = param_proj_left_.at<double>(0, 0);
   fy_ = param_proj_left_.at<double>(1, 1);
   baseline_x_fx_ = -param_proj_right_.at<double>(0, 3);
 
-  initUndistortRectifyMap(camera_left_ptr_->getIntrinsic(),
-                              camera_left_ptr_->getDistortion(),
-                              param_rect_left_,
-                              param_proj_left_,
-                              Size(VGA_WIDTH, VGA_HEIGHT), CV_32F,
-                              rectified_mapping_[0][0], rectified_mapping_[0][1]);
-  initUndistortRectifyMap(camera_right_ptr_->getIntrinsic(),
-                              camera_right_ptr_->getDistortion(),
-                              param_rect_right_,
-                              param_proj_right_,
-                              Size(VGA_WIDTH, VGA_HEIGHT), CV_32F,
-                              rectified_mapping_[1][0], rectified_mapping_[1][1]);
+  for(int u = 0; u < VGA_WIDTH; ++u)
+  {
+    unproject_x_lut_[u] = (float)((u - principal_x_) / fx_);
+  }
+  for(int v = 0; v < VGA_HEIGHT; ++v)
+  {
+    unproject_y_lut_[v] = (float)((v - principal_y_) / fy_);
+  }
+
+  initRectifyMaps();
 
 #ifdef USE_GPU
+  // cuda::remap only takes floating point maps
   for (int k = 0; k < 2; ++k) {
-    for (int i = 0; i < 2; ++i) {
-      cuda_rectified_mapping_[k][i].upload(rectified_mapping_[k][i]);
-    }
+    Mat map_x, map_y;
+    convertMaps(rectified_mapping_[k][0], rectified_mapping_[k][1],
+                map_x, map_y, CV_32FC1);
+    cuda_rectified_mapping_[k][0].upload(map_x);
+    cuda_rectified_mapping_[k][1].upload(map_y);
   }
 
   block_matcher_ = cuda::createStereoBM(num_disp_, block_size_);
@@ -104,6 +240,185 @@ StereoFrame::initStereoParam()
   return true;
 }
 
+void
+StereoFrame::initRectifyMaps()
+{
+  uint64_t key = rectifyParamKey();
+  if(loadRectifyMaps(key))
+  {
+    return;
+  }
+
+  initUndistortRectifyMap(camera_left_ptr_->getIntrinsic(),
+                          camera_left_ptr_->getDistortion(),
+                          param_rect_left_,
+                          param_proj_left_,
+                          Size(VGA_WIDTH, VGA_HEIGHT), RECTIFY_MAP_TYPE,
+                          rectified_mapping_[0][0], rectified_mapping_[0][1]);
+  initUndistortRectifyMap(camera_right_ptr_->getIntrinsic(),
+                          camera_right_ptr_->getDistortion(),
+                          param_rect_right_,
+                          param_proj_right_,
+                          Size(VGA_WIDTH, VGA_HEIGHT), RECTIFY_MAP_TYPE,
+                          rectified_mapping_[1][0], rectified_mapping_[1][1]);
+
+  if(!rect_map_cache_dir_.empty() && !saveRectifyMaps(key))
+  {
+    DSTATUS("Could not cache the rectification maps in %s\n",
+            rectifyMapCachePath(key).c_str());
+  }
+}
+
+static void
+hashBytes(uint64_t &hash, const void *data, size_t len)
+{
+  // FNV-1a
+  const uint8_t *bytes = (const uint8_t *)data;
+  for(size_t i = 0; i < len; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+}
+
+static void
+hashMat(uint64_t &hash, const Mat &mat)
+{
+  // the shape and the values
+  Mat data = mat.isContinuous() ? mat : mat.clone();
+  int shape[3] = {data.rows, data.cols, data.type()};
+  hashBytes(hash, shape, sizeof(shape));
+  hashBytes(hash, data.data, data.total() * data.elemSize());
+}
+
+uint64_t
+StereoFrame::rectifyParamKey()
+{
+  uint64_t hash = 14695981039346656037ULL;
+  // maps written by another OpenCV version or of another type are rebuilt
+  hashBytes(hash, CV_VERSION, sizeof(CV_VERSION));
+  hashBytes(hash, &RECTIFY_MAP_TYPE, sizeof(RECTIFY_MAP_TYPE));
+  hashMat(hash, camera_left_ptr_->getIntrinsic());
+  hashMat(hash, camera_left_ptr_->getDistortion());
+  hashMat(hash, camera_right_ptr_->getIntrinsic());
+  hashMat(hash, camera_right_ptr_->getDistortion());
+  hashMat(hash, param_rect_left_);
+  hashMat(hash, param_rect_right_);
+  hashMat(hash, param_proj_left_);
+  hashMat(hash, param_proj_right_);
+  return hash;
+}
+
+std::string
+StereoFrame::rectifyMapCachePath(uint64_t key)
+{
+  char name[64];
+  snprintf(name, sizeof(name), "/stereo_rect_%016llx.bin", (unsigned long long)key);
+  return rect_map_cache_dir_ + name;
+}
+
+namespace
+{
+struct RectifyMapFileHeader
+{
+  char      magic[8];
+  uint64_t  key;
+  int32_t   width;
+  int32_t   height;
+};
+
+const char RECTIFY_MAP_MAGIC[8] = {'D', 'J', 'I', 'R', 'E', 'C', 'T', '1'};
+}
+
+bool
+StereoFrame::loadRectifyMaps(uint64_t key)
+{
+  if(rect_map_cache_dir_.empty())
+  {
+    return false;
+  }
+
+  std::ifstream file(rectifyMapCachePath(key).c_str(), std::ios::binary);
+  if(!file)
+  {
+    return false;
+  }
+
+  RectifyMapFileHeader header;
+  file.read((char *)&header, sizeof(header));
+  if(!file || memcmp(header.magic, RECTIFY_MAP_MAGIC, sizeof(header.magic)) != 0
+     || header.key != key || header.width != VGA_WIDTH || header.height != VGA_HEIGHT)
+  {
+    return false;
+  }
+
+  for(int k = 0; k < 2; ++k)
+  {
+    rectified_mapping_[k][0].create(VGA_HEIGHT, VGA_WIDTH, CV_16SC2);
+    rectified_mapping_[k][1].create(VGA_HEIGHT, VGA_WIDTH, CV_16UC1);
+    for(int i = 0; i < 2; ++i)
+    {
+      Mat &map = rectified_mapping_[k][i];
+      file.read((char *)map.data, map.total() * map.elemSize());
+    }
+  }
+  if(!file)
+  {
+    return false;
+  }
+
+  DSTATUS("Loaded the rectification maps from %s\n", rectifyMapCachePath(key).c_str());
+  return true;
+}
+
+bool
+StereoFrame::saveRectifyMaps(uint64_t key)
+{
+  if(rect_map_cache_dir_.empty())
+  {
+    return true;
+  }
+
+  // write to a temporary file first, a reader never sees a partial cache
+  std::string path = rectifyMapCachePath(key);
+  std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path.c_str(), std::ios::binary | std::ios::trunc);
+    if(!file)
+    {
+      return false;
+    }
+
+    RectifyMapFileHeader header;
+    memcpy(header.magic, RECTIFY_MAP_MAGIC, sizeof(header.magic));
+    header.key    = key;
+    header.width  = VGA_WIDTH;
+    header.height = VGA_HEIGHT;
+    file.write((const char *)&header, sizeof(header));
+
+    for(int k = 0; k < 2; ++k)
+    {
+      for(int i = 0; i < 2; ++i)
+      {
+        const Mat &map = rectified_mapping_[k][i];
+        file.write((const char *)map.data, map.total() * map.elemSize());
+      }
+    }
+    if(!file)
+    {
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+  }
+  return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+void
+StereoFrame::setRectifyMapCacheDir(const std::string &dir)
+{
+  rect_map_cache_dir_ = dir;
+}
+
 StereoFrame::Ptr
 StereoFrame::createStereoFrame(CameraParam::Ptr left_cam, CameraParam::Ptr right_cam)
 {
@@ -112,16 +427,24 @@ StereoFrame::createStereoFrame(CameraParam::Ptr left_cam, CameraParam::Ptr right
 
 void
 StereoFrame::readStereoImgs(const DJI::OSDK::ACK::StereoVGAImgData &imgs)
+{
+  readStereoImgs(imgs.img_vec[0], imgs.img_vec[1],
+                 imgs.frame_index, imgs.time_stamp);
+}
+
+void
+StereoFrame::readStereoImgs(const uint8_t *left_img, const uint8_t *right_img,
+                            uint64_t frame_id, uint32_t time_stamp)
 {
   memcpy(frame_left_ptr_->raw_image.data,
-         imgs.img_vec[0], sizeof(char)*VGA_HEIGHT*VGA_WIDTH);
+         left_img, sizeof(char)*VGA_HEIGHT*VGA_WIDTH);
   memcpy(frame_right_ptr_->raw_image.data,
-         imgs.img_vec[1], sizeof(char)*VGA_HEIGHT*VGA_WIDTH);
+         right_img, sizeof(char)*VGA_HEIGHT*VGA_WIDTH);
 
-  frame_left_ptr_-> id  = imgs.frame_index;
-  frame_right_ptr_->id  = imgs.frame_index;
-  frame_left_ptr_-> time_stamp  = imgs.time_stamp;
-  frame_right_ptr_->time_stamp  = imgs.time_stamp;
+  frame_left_ptr_-> id  = frame_id;
+  frame_right_ptr_->id  = frame_id;
+  frame_left_ptr_-> time_stamp  = time_stamp;
+  frame_right_ptr_->time_stamp  = time_stamp;
 }
 
 void
@@ -194,7 +517,7 @@ StereoFrame::filterDisparityMap()
 }
 
 void
-StereoFrame::unprojectPtCloud()
+StereoFrame::unprojectPtCloud(bool row_parallel)
 {
   // due to rectification, the image boarder are blank
   // we cut them out
@@ -202,37 +525,63 @@ StereoFrame::unprojectPtCloud()
   const int trunc_img_width_end = VGA_WIDTH - border_size;
   const int trunc_img_height_end = VGA_HEIGHT - border_size;
 
-  mat_vec3_pt_ = Mat_<Vec3f>(VGA_HEIGHT, VGA_WIDTH, Vec3f(0, 0, 0));
-
-  for(int v = border_size; v < trunc_img_height_end; ++v)
-  {
-    for(int u = border_size; u < trunc_img_width_end; ++u)
-    {
-      Vec3f &point = mat_vec3_pt_.at<Vec3f>(v, u);
-
 #ifdef USE_OPEN_CV_CONTRIB
-      float disparity = (float)(filtered_disparity_map_.at<short int>(v, u)*0.0625);
+  const Mat &disparity = filtered_disparity_map_;
 #else
-      float disparity = (float)(raw_disparity_map_.at<short int>(v, u)*0.0625);
+  const Mat &disparity = raw_disparity_map_;
 #endif
+  const float bf16     = (float)(baseline_x_fx_ * 16.0);
+  const float *x_lut   = &unproject_x_lut_[0];
+  Vec3f *pts           = &packed_pts_[0];
+  uint8_t *colors      = &packed_colors_[0];
+  int pt_num           = 0;
+
+  if(!row_parallel)
+  {
+    for(int v = border_size; v < trunc_img_height_end; ++v)
+    {
+      pt_num += unprojectRow(disparity.ptr<short>(v),
+                             rectified_img_left_.ptr<uint8_t>(v),
+                             x_lut, unproject_y_lut_[v], bf16,
+                             border_size, trunc_img_width_end,
+                             pts + pt_num, colors + pt_num);
+    }
+  }
+  else
+  {
+    // every row writes at its own offset, they are packed afterwards
+    parallel_for_(Range(border_size, trunc_img_height_end), [&](const Range &rows)
+    {
+      for(int v = rows.start; v < rows.end; ++v)
+      {
+        row_pt_num_[v] = unprojectRow(disparity.ptr<short>(v),
+                                      rectified_img_left_.ptr<uint8_t>(v),
+                                      x_lut, unproject_y_lut_[v], bf16,
+                                      border_size, trunc_img_width_end,
+                                      pts + v*VGA_WIDTH, colors + v*VGA_WIDTH);
+      }
+    });
 
-      // do not consider pts that are farther than 8.6m, i.e. disparity < 6
-      if(disparity >= 6)
+    for(int v = border_size; v < trunc_img_height_end; ++v)
+    {
+      const int row_num = row_pt_num_[v];
+      if(pt_num != v*VGA_WIDTH)
       {
-        point[2] = baseline_x_fx_/disparity;
-        point[0] = (u-principal_x_)*point[2]/fx_;
-        point[1] = (v-principal_y_)*point[2]/fy_;
+        memmove(pts + pt_num, pts + v*VGA_WIDTH, row_num*sizeof(Vec3f));
+        memmove(colors + pt_num, colors + v*VGA_WIDTH, row_num);
       }
-      color_buffer_[v*VGA_WIDTH+u] = rectified_img_left_.at<uint8_t>(v, u);
+      pt_num += row_num;
     }
   }
+  packed_pt_num_ = pt_num;
 
-  color_mat_ = cv::Mat(VGA_HEIGHT, VGA_WIDTH, CV_8UC1, &color_buffer_[0]).clone();
-
-  // @note Unfortunately, calling this WCloud constructor costs about the same amount
-  // of time as we go through each pixel and unproject the pt cloud. Because there's
-  // another nested for-loop inside WCloud implementation
-  // Ideally these can be done in one shot but it involves changing openCV implementation
-  // TODO maybe opencv projectPoints() is a good alternative
-  pt_cloud_ = viz::WCloud(mat_vec3_pt_, color_mat_);
-}
\ No newline at end of file
+  // WCloud only gets the valid points now, instead of walking the whole
+  // image again. It does not accept an empty cloud, so give it one NaN point
+  if(pt_num == 0)
+  {
+    pts[0] = Vec3f(NAN, NAN, NAN);
+  }
+  const int cloud_size = std::max(pt_num, 1);
+  pt_cloud_ = viz::WCloud(Mat(1, cloud_size, CV_32FC3, pts),
+                          Mat(1, cloud_size, CV_8UC1, colors));
+}
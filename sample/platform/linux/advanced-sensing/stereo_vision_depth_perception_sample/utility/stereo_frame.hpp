@@ -34,15 +34,24 @@ public:
   static StereoFrame::Ptr createStereoFrame(CameraParam::Ptr left_cam,
                                             CameraParam::Ptr right_cam);
 
+  //! Directory where the rectification maps are cached between runs, keyed
+  //! by the stereo parameters. Empty by default, which disables the cache
+  static void setRectifyMapCacheDir(const std::string &dir);
+
   void readStereoImgs(const DJI::OSDK::ACK::StereoVGAImgData &imgs);
 
+  void readStereoImgs(const uint8_t *left_img, const uint8_t *right_img,
+                      uint64_t frame_id, uint32_t time_stamp);
+
   void rectifyImgs();
 
   void computeDisparityMap();
 
   void filterDisparityMap();
 
-  void unprojectPtCloud();
+  //! Only keeps the pixels with a disparity of at least 6 px. With
+  //! row_parallel the rows are split over cv::parallel_for_ workers
+  void unprojectPtCloud(bool row_parallel = false);
 
   inline cv::Mat getRectLeftImg() { return this->rectified_img_left_; }
 
@@ -50,15 +59,52 @@ public:
 
   inline cv::Mat getDisparityMap() { return this->disparity_map_8u_; }
 
+  //! CV_16SC1 disparity in 1/16 px, the filtered one when ximgproc is found
+#ifdef USE_OPEN_CV_CONTRIB
+  inline cv::Mat getRawDisparityMap() { return this->filtered_disparity_map_; }
+#else
+  inline cv::Mat getRawDisparityMap() { return this->raw_disparity_map_; }
+#endif
+
+  //! depth = baseline * fx / disparity in px
+  inline double getBaselineXFx() { return this->baseline_x_fx_; }
+
   inline cv::viz::WCloud getPtCloud() { return this->pt_cloud_; }
 
+  //! 1xN CV_32FC3 view of the valid points of the last unprojection, no copy
+  inline cv::Mat getPackedPtCloud()
+  {
+    return cv::Mat(1, this->packed_pt_num_, CV_32FC3, &this->packed_pts_[0]);
+  }
+
+  //! 1xN CV_8UC1 view of the gray level of each packed point, no copy
+  inline cv::Mat getPackedPtColors()
+  {
+    return cv::Mat(1, this->packed_pt_num_, CV_8UC1, &this->packed_colors_[0]);
+  }
+
 #ifdef USE_OPEN_CV_CONTRIB
   inline cv::Mat getFilteredDispMap() { return this->filtered_disparity_map_8u_; }
 #endif
 
+  //! False when the stereo parameters could not be read from Config
+  inline bool isValid() { return this->param_valid_; }
+
 protected:
   bool initStereoParam();
 
+  void initRectifyMaps();
+
+  uint64_t rectifyParamKey();
+
+  std::string rectifyMapCachePath(uint64_t key);
+
+  bool loadRectifyMaps(uint64_t key);
+
+  bool saveRectifyMaps(uint64_t key);
+
+  static std::string rect_map_cache_dir_;
+
 protected:
   //! Image frames
   Frame::Ptr frame_left_ptr_;
@@ -74,6 +120,8 @@ protected:
   cv::Mat param_proj_left_;
   cv::Mat param_proj_right_;
 
+  //! [camera][0] is CV_16SC2 integer coordinates, [camera][1] the CV_16UC1
+  //! interpolation table, as produced by convertMaps
   cv::Mat rectified_mapping_[2][2];
 
   //! Rectified images
@@ -93,10 +141,14 @@ protected:
   double fx_;
   double fy_;
   double baseline_x_fx_;
-  std::vector<uint8_t>  color_buffer_;
-  cv::Mat               color_mat_;
-  cv::Mat_<cv::Vec3f>   mat_vec3_pt_;
-  cv::viz::WCloud       pt_cloud_;
+  std::vector<float>      unproject_x_lut_;  // (u - cx) / fx of each column
+  std::vector<float>      unproject_y_lut_;  // (v - cy) / fy of each row
+  std::vector<cv::Vec3f>  packed_pts_;       // valid points first, sized for a full image
+  std::vector<uint8_t>    packed_colors_;
+  std::vector<int>        row_pt_num_;       // points of each row in row parallel mode
+  int                     packed_pt_num_;
+  cv::viz::WCloud         pt_cloud_;
+  bool                    param_valid_;
 
 #ifdef USE_GPU
   cv::cuda::GpuMat  cuda_rectified_mapping_[2][2];
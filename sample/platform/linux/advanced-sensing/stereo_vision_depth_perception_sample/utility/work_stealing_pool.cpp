@@ -0,0 +1,171 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "work_stealing_pool.hpp"
+#include <algorithm>
+
+using namespace M210_STEREO;
+
+// Which pool and deque the current thread works for, -1 outside any pool
+static thread_local WorkStealingPool *tls_pool = NULL;
+static thread_local int tls_queue_index = -1;
+
+WorkStealingPool::WorkStealingPool(int thread_num)
+  : pending_(0)
+  , stop_(false)
+{
+  if(thread_num <= 0)
+  {
+    thread_num = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for(int i = 0; i < thread_num; ++i)
+  {
+    queues_.emplace_back(new TaskQueue());
+  }
+  for(int i = 0; i < thread_num; ++i)
+  {
+    threads_.emplace_back(&WorkStealingPool::workerLoop, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    stop_ = true;
+  }
+  wake_cv_.notify_all();
+
+  // the workers drain the queued tasks before leaving
+  for(size_t i = 0; i < threads_.size(); ++i)
+  {
+    threads_[i].join();
+  }
+}
+
+void
+WorkStealingPool::submit(Task task)
+{
+  if(tls_pool == this)
+  {
+    push(*queues_[tls_queue_index], std::move(task));
+  }
+  else
+  {
+    push(shared_, std::move(task));
+  }
+}
+
+void
+WorkStealingPool::post(Task task)
+{
+  push(shared_, std::move(task));
+}
+
+void
+WorkStealingPool::push(TaskQueue &queue, Task task)
+{
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    ++pending_;
+  }
+  wake_cv_.notify_one();
+}
+
+bool
+WorkStealingPool::popLocal(int index, Task &task)
+{
+  TaskQueue &queue = *queues_[index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if(queue.tasks.empty())
+  {
+    return false;
+  }
+  task = std::move(queue.tasks.back());
+  queue.tasks.pop_back();
+  return true;
+}
+
+bool
+WorkStealingPool::popShared(Task &task)
+{
+  std::lock_guard<std::mutex> lock(shared_.mutex);
+  if(shared_.tasks.empty())
+  {
+    return false;
+  }
+  task = std::move(shared_.tasks.front());
+  shared_.tasks.pop_front();
+  return true;
+}
+
+bool
+WorkStealingPool::steal(int index, Task &task)
+{
+  const int queue_num = (int)queues_.size();
+  for(int i = 1; i < queue_num; ++i)
+  {
+    TaskQueue &victim = *queues_[(index + i) % queue_num];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if(!victim.tasks.empty())
+    {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+WorkStealingPool::workerLoop(int index)
+{
+  tls_pool = this;
+  tls_queue_index = index;
+
+  while(true)
+  {
+    Task task;
+    if(popLocal(index, task) || popShared(task) || steal(index, task))
+    {
+      {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        --pending_;
+      }
+      task();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    // a task counted in pending_ may still be on its way into a deque,
+    // so only sleep when nothing is announced at all
+    wake_cv_.wait(lock, [this] { return stop_ || pending_ > 0; });
+    if(stop_ && pending_ == 0)
+    {
+      break;
+    }
+  }
+}
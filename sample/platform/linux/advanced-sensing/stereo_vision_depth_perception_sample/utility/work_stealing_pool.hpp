@@ -0,0 +1,65 @@
+#ifndef ONBOARDSDK_WORK_STEALING_POOL_H
+#define ONBOARDSDK_WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace M210_STEREO
+{
+
+//! Fixed set of worker threads, each with its own task deque. A worker
+//! runs its newest task first and steals the oldest task of another worker
+//! when its own deque is empty, so stages posted by a task tend to stay on
+//! the core that holds their data.
+class WorkStealingPool
+{
+public:
+  typedef std::function<void()> Task;
+
+  //! thread_num <= 0 uses one thread per hardware core
+  explicit WorkStealingPool(int thread_num = 0);
+  ~WorkStealingPool();
+
+  //! From a worker the task goes to its own deque, otherwise to the
+  //! shared queue
+  void submit(Task task);
+
+  //! Always goes to the shared queue, which workers serve oldest first
+  //! once their own deque is empty. New work posted here can't starve
+  //! older work the way a worker's newest-first deque can.
+  void post(Task task);
+
+  inline int size() const { return (int)this->threads_.size(); }
+
+private:
+  struct TaskQueue
+  {
+    std::mutex        mutex;
+    std::deque<Task>  tasks;
+  };
+
+  void push(TaskQueue &queue, Task task);
+  void workerLoop(int index);
+  bool popLocal(int index, Task &task);
+  bool popShared(Task &task);
+  bool steal(int index, Task &task);
+
+  std::vector<std::unique_ptr<TaskQueue>> queues_;
+  TaskQueue                               shared_;
+  std::vector<std::thread>                threads_;
+
+  std::mutex                wake_mutex_;
+  std::condition_variable   wake_cv_;
+  int                       pending_;   // queued tasks, guarded by wake_mutex_
+  bool                      stop_;
+};
+
+} // namespace M210_STEREO
+
+#endif //ONBOARDSDK_WORK_STEALING_POOL_H
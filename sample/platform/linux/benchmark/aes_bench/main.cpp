@@ -0,0 +1,177 @@
+/*! @file benchmark/aes_bench/main.cpp
+ *  @version 4.0.0
+ *  @date Jan 2020
+ *
+ *  @brief
+ *  Known-answer test of the multi-block AES-256 ECB functions, cross-checked
+ *  against the byte-oriented cipher, then a throughput comparison.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "dji_aes.hpp"
+
+/* FIPS-197 appendix C.3 */
+static const uint8_t fipsKey[32] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a,
+    0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+    0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f};
+static const uint8_t fipsPlain[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55,
+                                      0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb,
+                                      0xcc, 0xdd, 0xee, 0xff};
+static const uint8_t fipsCipher[16] = {0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67,
+                                       0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90,
+                                       0x4b, 0x49, 0x60, 0x89};
+
+/* SP 800-38A F.1.5 ECB-AES256, four blocks in one call */
+static const uint8_t ecbKey[32] = {
+    0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae,
+    0xf0, 0x85, 0x7d, 0x77, 0x81, 0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61,
+    0x08, 0xd7, 0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4};
+static const uint8_t ecbPlain[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73,
+    0x93, 0x17, 0x2a, 0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7,
+    0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51, 0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4,
+    0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef, 0xf6, 0x9f, 0x24, 0x45,
+    0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10};
+static const uint8_t ecbCipher[64] = {
+    0xf3, 0xee, 0xd1, 0xbd, 0xb5, 0xd2, 0xa0, 0x3c, 0x06, 0x4b, 0x5a, 0x7e, 0x3d,
+    0xb1, 0x81, 0xf8, 0x59, 0x1c, 0xcb, 0x10, 0xd4, 0x10, 0xed, 0x26, 0xdc, 0x5b,
+    0xa7, 0x4a, 0x31, 0x36, 0x28, 0x70, 0xb6, 0xed, 0x21, 0xb9, 0x9c, 0xa6, 0xf4,
+    0xf9, 0xf1, 0x53, 0xe7, 0xb1, 0xbe, 0xaf, 0xed, 0x1d, 0x23, 0x30, 0x4b, 0x7a,
+    0x39, 0xf9, 0xf3, 0xff, 0x06, 0x7d, 0x8d, 0x8f, 0x9e, 0x24, 0xec, 0xc7};
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what, size_t detail) {
+  if (!ok) {
+    printf("FAIL: %s (%zu)\n", what, detail);
+    failures++;
+  }
+}
+
+/* What OpenProtocol::encodeData ran before, one block at a time */
+static void portableEcb(const uint8_t *key, uint8_t *buf, uint32_t blocks, bool encrypt) {
+  aes256_context ctx;
+  aes256_init(&ctx, (uint8_t *)key);
+  for (uint32_t i = 0; i < blocks; i++) {
+    if (encrypt)
+      aes256_encrypt_ecb(&ctx, buf + i * 16);
+    else
+      aes256_decrypt_ecb(&ctx, buf + i * 16);
+  }
+  aes256_done(&ctx);
+}
+
+static void checkKnownAnswers() {
+  uint8_t buf[64];
+
+  memcpy(buf, fipsPlain, 16);
+  portableEcb(fipsKey, buf, 1, true);
+  expect(memcmp(buf, fipsCipher, 16) == 0, "FIPS-197 C.3 portable encrypt", 0);
+  portableEcb(fipsKey, buf, 1, false);
+  expect(memcmp(buf, fipsPlain, 16) == 0, "FIPS-197 C.3 portable decrypt", 0);
+
+  memcpy(buf, fipsPlain, 16);
+  aes256_encrypt_ecb_blocks(fipsKey, buf, 1);
+  expect(memcmp(buf, fipsCipher, 16) == 0, "FIPS-197 C.3 encrypt", 0);
+  aes256_decrypt_ecb_blocks(fipsKey, buf, 1);
+  expect(memcmp(buf, fipsPlain, 16) == 0, "FIPS-197 C.3 decrypt", 0);
+
+  memcpy(buf, ecbPlain, 64);
+  aes256_encrypt_ecb_blocks(ecbKey, buf, 4);
+  expect(memcmp(buf, ecbCipher, 64) == 0, "SP 800-38A F.1.5 encrypt", 0);
+  aes256_decrypt_ecb_blocks(ecbKey, buf, 4);
+  expect(memcmp(buf, ecbPlain, 64) == 0, "SP 800-38A F.1.5 decrypt", 0);
+}
+
+/* Random keys and buffers, block counts around the four-block pipeline */
+static void checkAgainstPortable(int rounds) {
+  std::mt19937 rng(2020);
+  std::vector<uint8_t> plain(70 * 16), fast(plain.size()), slow(plain.size());
+  uint8_t key[32];
+
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < 32; i++) key[i] = rng();
+    for (size_t i = 0; i < plain.size(); i++) plain[i] = rng();
+    uint32_t blocks = (r < 70) ? r : rng() % 70;
+
+    memcpy(&fast[0], &plain[0], plain.size());
+    memcpy(&slow[0], &plain[0], plain.size());
+    aes256_encrypt_ecb_blocks(key, &fast[0], blocks);
+    portableEcb(key, &slow[0], blocks, true);
+    expect(memcmp(&fast[0], &slow[0], plain.size()) == 0, "encrypt differs from portable",
+           blocks);
+
+    aes256_decrypt_ecb_blocks(key, &fast[0], blocks);
+    portableEcb(key, &slow[0], blocks, false);
+    expect(memcmp(&fast[0], &slow[0], plain.size()) == 0, "decrypt differs from portable",
+           blocks);
+    expect(memcmp(&fast[0], &plain[0], plain.size()) == 0, "round trip", blocks);
+  }
+}
+
+typedef void (*EcbFunc)(const uint8_t *key, uint8_t *buf, uint32_t blocks);
+
+static void portableDecrypt(const uint8_t *key, uint8_t *buf, uint32_t blocks) {
+  portableEcb(key, buf, blocks, false);
+}
+
+static double megabytesPerSecond(EcbFunc func, std::vector<uint8_t> &buf, uint32_t blocks,
+                                 size_t total) {
+  size_t loops = total / (blocks * 16);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < loops; i++) func(ecbKey, &buf[0], blocks);
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return (double)loops * blocks * 16 / (1024.0 * 1024.0) / sec;
+}
+
+static void benchmark() {
+  std::vector<uint8_t> buf(64 * 1024);
+  /* One block, the largest open protocol payload, a bulk buffer */
+  static const uint32_t blockNums[] = {1, 63, 4096};
+  printf("%10s %16s %16s  (decrypt MB/s)\n", "bytes", "portable", aes256_backend());
+  for (size_t i = 0; i < sizeof(blockNums) / sizeof(blockNums[0]); i++) {
+    uint32_t blocks = blockNums[i];
+    printf("%10u %16.1f %16.1f\n", blocks * 16,
+           megabytesPerSecond(portableDecrypt, buf, blocks, 4 * 1024 * 1024),
+           megabytesPerSecond(aes256_decrypt_ecb_blocks, buf, blocks, 256 * 1024 * 1024));
+  }
+}
+
+int main(int argc, char **argv) {
+  printf("aes backend: %s\n", aes256_backend());
+
+  checkKnownAnswers();
+  checkAgainstPortable(1000);
+  printf("%d check failures\n", failures);
+
+  if (argc < 2 || strcmp(argv[1], "--check-only") != 0) benchmark();
+
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,445 @@
+/*! @file benchmark/frame_scanner_bench/main.cpp
+ *  @version 4.0.0
+ *  @date Jan 2020
+ *
+ *  @brief
+ *  Fuzz and throughput harness of the ProtocolBase bulk frame scanner.
+ *  Replays synthetic or captured UART and USB byte streams in random chunks.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "dji_crc.hpp"
+#include "dji_protocol_base.hpp"
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+/* Usage:
+ *   djiosdk-frame-scanner-bench
+ *       fuzz both framings with synthetic streams, then measure throughput
+ *   djiosdk-frame-scanner-bench uart|usb capture...
+ *       replay raw captures of the serial or the USB bulk link. There is no
+ *       ground truth for a capture, so every replay in random chunks has to
+ *       return exactly the frames a replay in whole reads returned.
+ *
+ * The probe below implements the scanner hooks the same way OpenProtocol
+ * (UART) and AdvancedSensingProtocol (USB) do. The protocols themselves need
+ * a serial port or a libusb device to be constructed.
+ */
+
+enum Framing { FRAMING_UART, FRAMING_USB };
+
+#pragma pack(1)
+/* Same layout as in dji_advanced_sensing_protocol.cpp */
+typedef struct UsbHeader {
+  uint8_t header[2];
+  uint8_t cmd_id;
+  uint8_t check_sum;
+  uint32_t length;
+  uint32_t reserved;
+} UsbHeader;
+#pragma pack()
+
+static const uint8_t UART_SOF = 0xAA;
+static const int UART_READ_LEN = 1024; /* OpenProtocol BUFFER_SIZE */
+static const uint8_t USB_SOF1 = 0x55;
+static const uint8_t USB_SOF2 = 0xAA;
+static const int USB_READ_LEN = 1024 * 600;
+static const int USB_MAX_RECV = 5 * (2 + 1) * 240 * 320 + 12 + 8 + 200;
+static const uint32_t VGA_PAIR_LEN = 2 * 480 * 640;
+
+/*! Serves a byte stream, in random chunks or in reads as large as asked */
+class MemoryDriver : public HardDriver {
+ public:
+  MemoryDriver(const std::vector<uint8_t> &stream, uint32_t seed, bool randomChunks)
+      : stream(stream), pos(0), rng(seed), randomChunks(randomChunks) {}
+
+  void init() {}
+  time_ms getTimeStamp() { return 0; }
+  size_t send(const uint8_t *buf, size_t len) { return len; }
+
+  size_t readall(uint8_t *buf, size_t maxlen) {
+    size_t left = stream.size() - pos;
+    size_t len = (left < maxlen) ? left : maxlen;
+    if (randomChunks && len > 0) {
+      /* Mostly short reads, sometimes a byte at a time */
+      size_t limit = (rng() % 4 == 0) ? 16 : len;
+      len = 1 + rng() % (limit < len ? limit : len);
+    }
+    memcpy(buf, &stream[pos], len);
+    pos += len;
+    return len;
+  }
+
+  bool exhausted() const { return pos == stream.size(); }
+
+ private:
+  const std::vector<uint8_t> &stream;
+  size_t pos;
+  std::mt19937 rng;
+  bool randomChunks;
+};
+
+typedef struct FrameRecord {
+  uint32_t len;
+  uint64_t hash;
+} FrameRecord;
+
+static uint64_t fnv1a(const uint8_t *p, uint32_t len) {
+  uint64_t h = 1469598103934665603ULL;
+  for (uint32_t i = 0; i < len; i++) h = (h ^ p[i]) * 1099511628211ULL;
+  return h;
+}
+
+/*! ProtocolBase with only the bulk scanner hooks, records every frame */
+class ScanProbe : public ProtocolBase {
+ public:
+  ScanProbe(Framing framing, MemoryDriver *driver, bool hashFrames)
+      : framing(framing), hashFrames(hashFrames), frames(0), frameBytes(0) {
+    deviceDriver = driver;
+    threadHandle = NULL;
+    p_recvContainer = new RecvContainer();
+    p_filter = NULL;
+    buf = NULL;
+    read_len = 0;
+    buf_read_pos = 0;
+    if (framing == FRAMING_UART) {
+      setHeaderLength(sizeof(OpenHeader));
+      BUFFER_SIZE = UART_READ_LEN;
+      setMaxRecvLength(UART_READ_LEN);
+    } else {
+      setHeaderLength(sizeof(UsbHeader));
+      BUFFER_SIZE = USB_READ_LEN;
+      setMaxRecvLength(USB_MAX_RECV);
+    }
+  }
+
+  ~ScanProbe() { delete p_recvContainer; }
+
+  /* Runs the stream to its end */
+  void drain() {
+    MemoryDriver *driver = (MemoryDriver *)deviceDriver;
+    do {
+      receive();
+    } while (!driver->exhausted() || hasPendingData());
+  }
+
+  void init(HardDriver *Driver, MMU *mmuPtr, bool userCallbackThread) {}
+
+  Framing framing;
+  bool hashFrames;
+  std::vector<FrameRecord> records;
+  uint64_t frames;
+  uint64_t frameBytes;
+
+ protected:
+  int sendInterface(void *cmdContainer) { return 0; }
+  int sendData(uint8_t *buf) { return 0; }
+  bool checkStream() { return false; }
+  bool verifyHead() { return false; }
+  bool verifyData() { return false; }
+  bool callApp() { return false; }
+  bool appHandler(void *protocolHeader) { return false; }
+
+  int crcHeadCheck(uint8_t *pMsg, size_t nLen) {
+    return crc16Compute(CRC_INIT, pMsg, nLen);
+  }
+
+  int crcTailCheck(uint8_t *pMsg, size_t nLen) {
+    return crc32Compute(CRC_INIT, pMsg, nLen);
+  }
+
+  int frameSOF() { return (framing == FRAMING_UART) ? UART_SOF : USB_SOF1; }
+
+  uint32_t frameLength(const uint8_t *head) {
+    if (framing == FRAMING_UART) {
+      OpenHeader *p_head = (OpenHeader *)head;
+      if ((p_head->version == 0) && (p_head->length >= sizeof(OpenHeader)) &&
+          (p_head->length < (uint32_t)MAX_RECV_LEN) && (p_head->reserved0 == 0) &&
+          (p_head->reserved1 == 0) &&
+          (crcHeadCheck((uint8_t *)p_head, sizeof(OpenHeader)) == 0)) {
+        return p_head->length;
+      }
+      return 0;
+    }
+
+    UsbHeader *p_head = (UsbHeader *)head;
+    if (p_head->header[1] != USB_SOF2 ||
+        p_head->length > (uint32_t)(MAX_RECV_LEN - sizeof(UsbHeader))) {
+      return 0;
+    }
+    return p_head->length + sizeof(UsbHeader);
+  }
+
+  bool frameVerify(const uint8_t *frame, uint32_t len) {
+    if (framing == FRAMING_USB) return true;
+    return (len == sizeof(OpenHeader)) || (crcTailCheck((uint8_t *)frame, len) == 0);
+  }
+
+  bool frameHandler(uint8_t *frame, uint32_t len) {
+    frames++;
+    frameBytes += len;
+    if (hashFrames) {
+      FrameRecord r = {len, fnv1a(frame, len)};
+      records.push_back(r);
+    }
+    return true;
+  }
+};
+
+/*! A synthetic stream and the frames a correct scanner returns from it */
+typedef struct Stream {
+  std::vector<uint8_t> bytes;
+  std::vector<FrameRecord> expected;
+} Stream;
+
+static void putUartFrame(std::vector<uint8_t> &out, std::mt19937 &rng,
+                         uint32_t payloadLen, uint16_t seq) {
+  uint32_t len = sizeof(OpenHeader) + payloadLen + (payloadLen ? 4 : 0);
+  size_t at = out.size();
+  out.resize(at + len);
+  uint8_t *frame = &out[at];
+  memset(frame, 0, sizeof(OpenHeader));
+
+  OpenHeader *head = (OpenHeader *)frame;
+  head->sof = UART_SOF;
+  head->length = len;
+  head->sessionID = rng() % 32;
+  head->sequenceNumber = seq;
+  uint16_t crc16 = crc16Compute(CRC_INIT, frame, sizeof(OpenHeader) - 2);
+  head->crc = crc16;
+
+  for (uint32_t i = 0; i < payloadLen; i++) frame[sizeof(OpenHeader) + i] = rng();
+  if (payloadLen) {
+    uint32_t crc32 = crc32Compute(CRC_INIT, frame, len - 4);
+    memcpy(frame + len - 4, &crc32, 4);
+  }
+}
+
+static void putUsbFrame(std::vector<uint8_t> &out, std::mt19937 &rng,
+                        uint32_t payloadLen, uint8_t cmdId) {
+  UsbHeader head = {{USB_SOF1, USB_SOF2}, cmdId, 0, payloadLen, 0};
+  size_t at = out.size();
+  out.resize(at + sizeof(head) + payloadLen);
+  memcpy(&out[at], &head, sizeof(head));
+  uint8_t *payload = &out[at + sizeof(head)];
+  for (uint32_t i = 0; i < payloadLen; i++) payload[i] = rng();
+}
+
+static void expectLast(Stream &s, size_t at) {
+  FrameRecord r = {(uint32_t)(s.bytes.size() - at), fnv1a(&s.bytes[at], s.bytes.size() - at)};
+  s.expected.push_back(r);
+}
+
+/* Valid frames mixed with noise, stray SOFs, bad headers, truncated and
+ * corrupted frames. Only the valid frames may come out. */
+static Stream buildUartFuzzStream(uint32_t frameNum, uint32_t seed) {
+  std::mt19937 rng(seed);
+  Stream s;
+  for (uint32_t n = 0; n < frameNum; n++) {
+    switch (rng() % 8) {
+      case 0: { /* noise, SOF bytes included */
+        uint32_t len = rng() % 64;
+        for (uint32_t i = 0; i < len; i++)
+          s.bytes.push_back((rng() % 4 == 0) ? UART_SOF : (uint8_t)rng());
+        break;
+      }
+      case 1: { /* a frame cut short by the next one. Cutting a few bytes
+                 * only could let the next SOF complete it by chance. */
+        std::vector<uint8_t> tmp;
+        putUartFrame(tmp, rng, 16 + rng() % 200, n);
+        tmp.resize(1 + rng() % (tmp.size() - 8));
+        s.bytes.insert(s.bytes.end(), tmp.begin(), tmp.end());
+        break;
+      }
+      case 2: { /* a payload bit flip, the data CRC has to catch it */
+        size_t at = s.bytes.size();
+        putUartFrame(s.bytes, rng, 1 + rng() % 200, n);
+        s.bytes[at + sizeof(OpenHeader) + rng() % (s.bytes.size() - at - sizeof(OpenHeader))] ^=
+            1 << (rng() % 8);
+        break;
+      }
+      case 3: { /* a header bit flip, the head CRC has to catch it */
+        size_t at = s.bytes.size();
+        putUartFrame(s.bytes, rng, rng() % 200, n);
+        s.bytes[at + 1 + rng() % (sizeof(OpenHeader) - 1)] ^= 1 << (rng() % 8);
+        break;
+      }
+      default: {
+        size_t at = s.bytes.size();
+        uint32_t maxPayload = UART_READ_LEN - 1 - sizeof(OpenHeader) - 4;
+        uint32_t payload = (rng() % 8 == 0) ? 0 : rng() % maxPayload;
+        putUartFrame(s.bytes, rng, payload, n);
+        expectLast(s, at);
+        break;
+      }
+    }
+  }
+  return s;
+}
+
+/* The USB header carries no checksum, any SOF pair with a plausible length
+ * is taken as a frame. The noise therefore never holds the SOF. */
+static Stream buildUsbFuzzStream(uint32_t frameNum, uint32_t seed) {
+  std::mt19937 rng(seed);
+  Stream s;
+  for (uint32_t n = 0; n < frameNum; n++) {
+    if (rng() % 4 == 0) {
+      uint32_t len = rng() % 4096;
+      for (uint32_t i = 0; i < len; i++) {
+        uint8_t b = rng();
+        s.bytes.push_back(b == USB_SOF1 ? 0 : b);
+      }
+    }
+    size_t at = s.bytes.size();
+    uint32_t payload = (rng() % 16 == 0) ? VGA_PAIR_LEN : rng() % 20000;
+    putUsbFrame(s.bytes, rng, payload, n);
+    expectLast(s, at);
+  }
+  return s;
+}
+
+static bool sameFrames(const std::vector<FrameRecord> &a, const std::vector<FrameRecord> &b,
+                       size_t *firstDiff) {
+  size_t n = (a.size() < b.size()) ? a.size() : b.size();
+  for (size_t i = 0; i < n; i++) {
+    if (a[i].len != b[i].len || a[i].hash != b[i].hash) {
+      *firstDiff = i;
+      return false;
+    }
+  }
+  *firstDiff = n;
+  return a.size() == b.size();
+}
+
+static std::vector<FrameRecord> replay(Framing framing, const std::vector<uint8_t> &bytes,
+                                       uint32_t seed, bool randomChunks) {
+  ScanProbe probe(framing, new MemoryDriver(bytes, seed, randomChunks), true);
+  probe.drain();
+  return probe.records;
+}
+
+static const char *framingName(Framing framing) {
+  return (framing == FRAMING_UART) ? "uart" : "usb";
+}
+
+static bool fuzz(Framing framing, uint32_t rounds) {
+  bool pass = true;
+  uint64_t frames = 0;
+  for (uint32_t round = 0; round < rounds; round++) {
+    Stream s = (framing == FRAMING_UART) ? buildUartFuzzStream(5000, round)
+                                         : buildUsbFuzzStream(300, round);
+    for (int whole = 0; whole < 2; whole++) {
+      std::vector<FrameRecord> got = replay(framing, s.bytes, round * 7 + 1, !whole);
+      size_t diff;
+      if (!sameFrames(s.expected, got, &diff)) {
+        printf("%s fuzz round %u (%s reads): frame %zu differs, %zu expected, %zu scanned\n",
+               framingName(framing), round, whole ? "whole" : "random", diff,
+               s.expected.size(), got.size());
+        pass = false;
+      }
+    }
+    frames += s.expected.size();
+  }
+  printf("%-4s fuzz: %u rounds, %llu valid frames, %s\n", framingName(framing), rounds,
+         (unsigned long long)frames, pass ? "all found in order" : "FAILED");
+  return pass;
+}
+
+static void throughput(const char *name, Framing framing, const std::vector<uint8_t> &bytes,
+                       int repeat) {
+  uint64_t frames = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; i++) {
+    ScanProbe probe(framing, new MemoryDriver(bytes, 0, false), false);
+    probe.drain();
+    frames += probe.frames;
+  }
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double mb = (double)bytes.size() * repeat / (1024.0 * 1024.0);
+  printf("%-28s %9.1f MB/s  %11.0f frames/s\n", name, mb / sec, frames / sec);
+}
+
+static bool replayCaptures(Framing framing, int fileNum, char **files) {
+  bool pass = true;
+  for (int f = 0; f < fileNum; f++) {
+    FILE *fp = fopen(files[f], "rb");
+    if (!fp) {
+      printf("%s: can not open\n", files[f]);
+      pass = false;
+      continue;
+    }
+    std::vector<uint8_t> bytes;
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) bytes.insert(bytes.end(), chunk, chunk + n);
+    fclose(fp);
+
+    std::vector<FrameRecord> reference = replay(framing, bytes, 0, false);
+    bool same = true;
+    for (uint32_t seed = 1; seed <= 20 && same; seed++) {
+      size_t diff;
+      if (!sameFrames(reference, replay(framing, bytes, seed, true), &diff)) {
+        printf("%s: random chunks (seed %u) differ from whole reads at frame %zu\n", files[f],
+               seed, diff);
+        same = false;
+      }
+    }
+    printf("%s: %zu bytes, %zu frames, %s\n", files[f], bytes.size(), reference.size(),
+           same ? "chunking independent" : "FAILED");
+    throughput(files[f], framing, bytes, 20);
+    pass = pass && same;
+  }
+  return pass;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 2) {
+    Framing framing = (std::string(argv[1]) == "usb") ? FRAMING_USB : FRAMING_UART;
+    bool pass = replayCaptures(framing, argc - 2, argv + 2);
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+  }
+
+  bool pass = fuzz(FRAMING_UART, 20);
+  pass = fuzz(FRAMING_USB, 10) && pass;
+
+  /* Telemetry sized serial frames, and VGA stereo pairs on the USB link */
+  std::mt19937 rng(1);
+  std::vector<uint8_t> uart;
+  for (uint16_t n = 0; uart.size() < 16 * 1024 * 1024; n++) putUartFrame(uart, rng, 60 + rng() % 40, n);
+  std::vector<uint8_t> usb;
+  for (uint8_t n = 0; usb.size() < 64 * 1024 * 1024; n++) putUsbFrame(usb, rng, VGA_PAIR_LEN, n);
+  throughput("uart 100 byte frames", FRAMING_UART, uart, 4);
+  throughput("usb VGA stereo pairs", FRAMING_USB, usb, 4);
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
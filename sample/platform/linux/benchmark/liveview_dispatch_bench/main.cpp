@@ -0,0 +1,209 @@
+/*! @file benchmark/liveview_dispatch_bench/main.cpp
+ *  @version 4.0.0
+ *  @date Jan 2020
+ *
+ *  @brief
+ *  Microbenchmark of the LiveView H.264 dispatch path.
+ *  Feeds packets straight into the callback table and counts heap allocations.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+#include "dji_liveview_impl.hpp"
+#include "dji_platform.hpp"
+#include "osdkosal_linux.h"
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+/* Heap allocations made by the calling thread */
+static thread_local uint64_t threadAllocs = 0;
+
+void* operator new(size_t size)
+{
+  threadAllocs++;
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+/* The callback table LiveViewImpl dispatches its H.264 packets through,
+ * driven here without a vehicle or linker. */
+static const H264CallbackTable::Handler defaultHandlers[H264CallbackTable::SLOT_NUM] = {{0}};
+static H264CallbackTable table(defaultHandlers);
+
+typedef struct StreamCounter {
+  int tag;
+  uint64_t packets;
+  uint64_t bytes;
+  uint64_t mismatches;
+} StreamCounter;
+
+/* Two callbacks that only accept their own user data, a handler published
+ * half way would show up as a mismatch. */
+static void countStreamA(uint8_t *buf, int bufLen, void *userData) {
+  StreamCounter *c = (StreamCounter *)userData;
+  if (c->tag != 'A') c->mismatches++;
+  c->packets++;
+  c->bytes += bufLen;
+}
+
+static void countStreamB(uint8_t *buf, int bufLen, void *userData) {
+  StreamCounter *c = (StreamCounter *)userData;
+  if (c->tag != 'B') c->mismatches++;
+  c->packets++;
+  c->bytes += bufLen;
+}
+
+static const LiveView::LiveViewCameraPosition positions[] = {
+    LiveView::OSDK_CAMERA_POSITION_FPV, LiveView::OSDK_CAMERA_POSITION_NO_1,
+    LiveView::OSDK_CAMERA_POSITION_NO_2, LiveView::OSDK_CAMERA_POSITION_NO_3};
+static const int streamNum = sizeof(positions) / sizeof(positions[0]);
+
+typedef struct RunResult {
+  double nsPerPacket;
+  uint64_t allocs;
+  uint64_t packets;
+  uint64_t mismatches;
+} RunResult;
+
+static RunResult runDispatch(uint64_t packetNum, StreamCounter *counters) {
+  std::vector<uint8_t> chunk(1400, 0x5A);
+  RunResult r = {0};
+
+  for (int i = 0; i < streamNum * 2; i++) {
+    counters[i].packets = counters[i].bytes = counters[i].mismatches = 0;
+  }
+
+  uint64_t allocsBefore = threadAllocs;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (uint64_t n = 0; n < packetNum; n++) {
+    table.dispatch(positions[n % streamNum], chunk.data(), chunk.size());
+  }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  r.allocs = threadAllocs - allocsBefore;
+
+  r.nsPerPacket =
+      std::chrono::duration<double, std::nano>(end - start).count() / packetNum;
+  for (int i = 0; i < streamNum * 2; i++) {
+    r.packets += counters[i].packets;
+    r.mismatches += counters[i].mismatches;
+  }
+  return r;
+}
+
+static void printResult(const char *name, const RunResult &r) {
+  printf("%-34s %8.1f ns/packet  %llu packets  %llu allocations  %llu mismatches\n",
+         name, r.nsPerPacket, (unsigned long long)r.packets,
+         (unsigned long long)r.allocs, (unsigned long long)r.mismatches);
+}
+
+/* H264CallbackTable::set sleeps through the OSAL while a dispatch is running */
+static bool registerOsal() {
+  static T_OsdkOsalHandler osalHandler = {
+      .TaskCreate = OsdkLinux_TaskCreate,
+      .TaskDestroy = OsdkLinux_TaskDestroy,
+      .TaskSleepMs = OsdkLinux_TaskSleepMs,
+      .MutexCreate = OsdkLinux_MutexCreate,
+      .MutexDestroy = OsdkLinux_MutexDestroy,
+      .MutexLock = OsdkLinux_MutexLock,
+      .MutexUnlock = OsdkLinux_MutexUnlock,
+      .SemaphoreCreate = OsdkLinux_SemaphoreCreate,
+      .SemaphoreDestroy = OsdkLinux_SemaphoreDestroy,
+      .SemaphoreWait = OsdkLinux_SemaphoreWait,
+      .SemaphoreTimedWait = OsdkLinux_SemaphoreTimedWait,
+      .SemaphorePost = OsdkLinux_SemaphorePost,
+      .GetTimeMs = OsdkLinux_GetTimeMs,
+#ifdef OS_DEBUG
+      .GetTimeUs = OsdkLinux_GetTimeUs,
+#endif
+      .Malloc = OsdkLinux_Malloc,
+      .Free = OsdkLinux_Free,
+  };
+  return DJI_REG_OSAL_HANDLER(&osalHandler);
+}
+
+int main(int argc, char **argv) {
+  uint64_t packetNum = (argc > 1) ? strtoull(argv[1], NULL, 10) : 4000000;
+
+  if (!registerOsal()) {
+    printf("Osal handler register fail\n");
+    return 1;
+  }
+
+  /* counters[i] is stream i with callback A, counters[streamNum + i] with B */
+  StreamCounter counters[streamNum * 2];
+  for (int i = 0; i < streamNum; i++) {
+    counters[i].tag = 'A';
+    counters[streamNum + i].tag = 'B';
+    table.set(positions[i], countStreamA, &counters[i]);
+  }
+
+  /* Warm up, so lazily initialized runtime state is not counted */
+  runDispatch(1000, counters);
+
+  RunResult steady = runDispatch(packetNum, counters);
+  printResult("4 streams", steady);
+
+  /* Same load while another thread keeps replacing the FPV callback */
+  std::atomic<bool> stop(false);
+  std::atomic<uint64_t> swaps(0);
+  std::thread swapper([&]() {
+    bool useB = false;
+    while (!stop.load()) {
+      useB = !useB;
+      if (useB)
+        table.set(positions[0], countStreamB, &counters[streamNum]);
+      else
+        table.set(positions[0], countStreamA, &counters[0]);
+      swaps++;
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  });
+  RunResult swapping = runDispatch(packetNum, counters);
+  stop = true;
+  swapper.join();
+  printResult("4 streams, FPV callback swapping", swapping);
+  printf("%llu FPV callback swaps\n", (unsigned long long)swaps.load());
+
+  for (int i = 0; i < streamNum; i++) {
+    table.set(positions[i], NULL, NULL);
+  }
+
+  bool pass = (steady.allocs == 0) && (swapping.allocs == 0) &&
+              (steady.mismatches == 0) && (swapping.mismatches == 0) &&
+              (steady.packets == packetNum) && (swapping.packets == packetNum);
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,350 @@
+/*! @file benchmark/session_memory_bench/main.cpp
+ *  @version 4.0.0
+ *  @date Jan 2020
+ *
+ *  @brief
+ *  Replays the allocSession/freeSession/allocACK pattern of OpenProtocol on
+ *  the session memory pool and on the previous compacting allocator.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include "dji_memory.hpp"
+
+using namespace DJI::OSDK;
+
+/*! The allocator MMU replaced: one 1 KB arena, live buffers are compacted
+ *  with memmove when no single gap fits the request. Kept verbatim so the
+ *  replay can compare both on the same operation sequence.
+ */
+class CompactingMMU {
+ public:
+  static const int MMU_TABLE_NUM = 32;
+  static const int MEMORY_SIZE = 1024;
+
+  void setupMMU() {
+    uint32_t i;
+    memoryTable[0].tabIndex = 0;
+    memoryTable[0].usageFlag = 1;
+    memoryTable[0].pmem = memory;
+    memoryTable[0].memSize = 0;
+    for (i = 1; i < (MMU_TABLE_NUM - 1); i++) {
+      memoryTable[i].tabIndex = i;
+      memoryTable[i].usageFlag = 0;
+    }
+    memoryTable[MMU_TABLE_NUM - 1].tabIndex = MMU_TABLE_NUM - 1;
+    memoryTable[MMU_TABLE_NUM - 1].usageFlag = 1;
+    memoryTable[MMU_TABLE_NUM - 1].pmem = memory + MEMORY_SIZE;
+    memoryTable[MMU_TABLE_NUM - 1].memSize = 0;
+  }
+
+  void freeMemory(MMU_Tab *mmu_tab) {
+    if (mmu_tab == (MMU_Tab *)0) return;
+    if (mmu_tab->tabIndex == 0 || mmu_tab->tabIndex == (MMU_TABLE_NUM - 1)) return;
+    mmu_tab->usageFlag = 0;
+  }
+
+  MMU_Tab *allocMemory(uint16_t size) {
+    uint32_t mem_used = 0;
+    uint8_t i;
+    uint8_t j = 0;
+    uint8_t mmu_tab_used_num = 0;
+    uint8_t mmu_tab_used_index[MMU_TABLE_NUM];
+    uint32_t temp32;
+    uint32_t temp_area[2] = {0xFFFFFFFF, 0xFFFFFFFF};
+    uint32_t record_temp32 = 0;
+    uint8_t magic_flag = 0;
+
+    if (size > PRO_PURE_DATA_MAX_SIZE || size > MEMORY_SIZE) return (MMU_Tab *)0;
+
+    for (i = 0; i < MMU_TABLE_NUM; i++) {
+      if (memoryTable[i].usageFlag == 1) {
+        mem_used += memoryTable[i].memSize;
+        mmu_tab_used_index[mmu_tab_used_num++] = memoryTable[i].tabIndex;
+      }
+    }
+    if (MEMORY_SIZE < (mem_used + size)) return (MMU_Tab *)0;
+
+    if (mem_used == 0) {
+      memoryTable[1].pmem = memoryTable[0].pmem;
+      memoryTable[1].memSize = size;
+      memoryTable[1].usageFlag = 1;
+      return &memoryTable[1];
+    }
+
+    for (i = 0; i < (mmu_tab_used_num - 1); i++) {
+      for (j = 0; j < (mmu_tab_used_num - i - 1); j++) {
+        if (memoryTable[mmu_tab_used_index[j]].pmem >
+            memoryTable[mmu_tab_used_index[j + 1]].pmem) {
+          mmu_tab_used_index[j + 1] ^= mmu_tab_used_index[j];
+          mmu_tab_used_index[j] ^= mmu_tab_used_index[j + 1];
+          mmu_tab_used_index[j + 1] ^= mmu_tab_used_index[j];
+        }
+      }
+    }
+    for (i = 0; i < (mmu_tab_used_num - 1); i++) {
+      temp32 = static_cast<uint32_t>(memoryTable[mmu_tab_used_index[i + 1]].pmem -
+                                     memoryTable[mmu_tab_used_index[i]].pmem);
+      if ((temp32 - memoryTable[mmu_tab_used_index[i]].memSize) >= size) {
+        if (temp_area[1] > (temp32 - memoryTable[mmu_tab_used_index[i]].memSize)) {
+          temp_area[0] = memoryTable[mmu_tab_used_index[i]].tabIndex;
+          temp_area[1] = temp32 - memoryTable[mmu_tab_used_index[i]].memSize;
+        }
+      }
+      record_temp32 += temp32 - memoryTable[mmu_tab_used_index[i]].memSize;
+      if (record_temp32 >= size && magic_flag == 0) {
+        j = i;
+        magic_flag = 1;
+      }
+    }
+
+    if (temp_area[0] == 0xFFFFFFFF && temp_area[1] == 0xFFFFFFFF) {
+      for (i = 0; i < j; i++) {
+        if (memoryTable[mmu_tab_used_index[i + 1]].pmem >
+            (memoryTable[mmu_tab_used_index[i]].pmem +
+             memoryTable[mmu_tab_used_index[i]].memSize)) {
+          memmove(memoryTable[mmu_tab_used_index[i]].pmem +
+                      memoryTable[mmu_tab_used_index[i]].memSize,
+                  memoryTable[mmu_tab_used_index[i + 1]].pmem,
+                  memoryTable[mmu_tab_used_index[i + 1]].memSize);
+          memoryTable[mmu_tab_used_index[i + 1]].pmem =
+              memoryTable[mmu_tab_used_index[i]].pmem +
+              memoryTable[mmu_tab_used_index[i]].memSize;
+        }
+      }
+      for (i = 1; i < (MMU_TABLE_NUM - 1); i++) {
+        if (memoryTable[i].usageFlag == 0) {
+          memoryTable[i].pmem = memoryTable[mmu_tab_used_index[j]].pmem +
+                                memoryTable[mmu_tab_used_index[j]].memSize;
+          memoryTable[i].memSize = size;
+          memoryTable[i].usageFlag = 1;
+          return &memoryTable[i];
+        }
+      }
+      return (MMU_Tab *)0;
+    }
+
+    for (i = 1; i < (MMU_TABLE_NUM - 1); i++) {
+      if (memoryTable[i].usageFlag == 0) {
+        memoryTable[i].pmem =
+            memoryTable[temp_area[0]].pmem + memoryTable[temp_area[0]].memSize;
+        memoryTable[i].memSize = size;
+        memoryTable[i].usageFlag = 1;
+        return &memoryTable[i];
+      }
+    }
+    return (MMU_Tab *)0;
+  }
+
+ private:
+  MMU_Tab memoryTable[MMU_TABLE_NUM];
+  uint8_t memory[MEMORY_SIZE];
+};
+
+/* A buffer handed out to a session, with what the sender wrote into it */
+typedef struct LiveBuffer {
+  MMU_Tab *tab;
+  uint8_t *pmem;
+  uint8_t fill;
+} LiveBuffer;
+
+typedef struct ReplayResult {
+  double nsPerOp;
+  uint64_t ops;
+  uint64_t allocs;
+  uint64_t nulls;    /* every NULL allocMemory returned */
+  uint64_t failures; /* NULL after the clearTimeoutSession retry */
+  uint64_t moved;    /* live buffers found at another address */
+  uint64_t corrupted;
+  uint64_t leaked;
+} ReplayResult;
+
+/*! Session tables of OpenProtocol, sessions 0 and 1 are fixed, 2..31 are
+ *  taken in order by CMD_SESSION_AUTO. ACK slots are replaced by allocACK.
+ */
+template <class Pool>
+class SessionReplay {
+ public:
+  static const int CMD_NUM = 32;
+  static const int ACK_NUM = 3;
+
+  SessionReplay(Pool *pool) : pool(pool) {
+    memset(cmd, 0, sizeof(cmd));
+    memset(ack, 0, sizeof(ack));
+    memset(&result, 0, sizeof(result));
+    pool->setupMMU();
+  }
+
+  /* Same calculation as OpenProtocol::calculateLength */
+  static uint16_t frameLength(uint16_t size, bool encrypt) {
+    if (encrypt) return size + sizeof(OpenHeader) + 4 + (16 - size % 16);
+    return size + sizeof(OpenHeader) + 4;
+  }
+
+  /* Payload sizes, mostly short commands with some uploads */
+  static uint16_t payloadSize(std::mt19937 &rng) {
+    uint32_t r = rng() % 100;
+    if (r < 70) return 1 + rng() % 32;
+    if (r < 95) return 33 + rng() % 168;
+    return 201 + rng() % 760;
+  }
+
+  void run(uint64_t opNum, uint32_t seed) {
+    std::mt19937 rng(seed);
+    uint8_t fill = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint64_t n = 0; n < opNum; n++) {
+      uint32_t r = rng() % 100;
+      uint16_t len = frameLength(payloadSize(rng), rng() & 1);
+      fill++;
+      if (r < 10) {
+        /* Session mode 0, sent and freed right away */
+        LiveBuffer b = {0};
+        if (alloc(b, len, fill)) release(b);
+      } else if (r < 20) {
+        /* Session mode 1, a busy session 1 is cleared as timed out */
+        if (!cmd[1].tab || (release(cmd[1]), true)) alloc(cmd[1], len, fill);
+      } else if (r < 50) {
+        /* Session mode 2, the oldest session is cleared when none fits */
+        int i = 2;
+        while (i < CMD_NUM && cmd[i].tab) i++;
+        if (i == CMD_NUM || !alloc(cmd[i], len, fill, false)) {
+          clearOldest();
+          i = 2;
+          while (i < CMD_NUM && cmd[i].tab) i++;
+          if (i < CMD_NUM) alloc(cmd[i], len, fill);
+        }
+      } else if (r < 90) {
+        /* ACK of a pending command */
+        int first = 1 + rng() % (CMD_NUM - 1);
+        for (int k = 0; k < CMD_NUM - 1; k++) {
+          int i = 1 + (first - 1 + k) % (CMD_NUM - 1);
+          if (cmd[i].tab) {
+            release(cmd[i]);
+            break;
+          }
+        }
+      } else {
+        /* allocACK frees what the slot held before */
+        LiveBuffer &a = ack[rng() % ACK_NUM];
+        if (a.tab) release(a);
+        alloc(a, frameLength(1 + rng() % 16, false), fill);
+      }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < CMD_NUM; i++) {
+      if (cmd[i].tab) release(cmd[i]);
+    }
+    for (int i = 0; i < ACK_NUM; i++) {
+      if (ack[i].tab) release(ack[i]);
+    }
+    /* Everything is back, a full size buffer must fit again */
+    LiveBuffer b = {0};
+    if (!alloc(b, PRO_PURE_DATA_MAX_SIZE, 0, false))
+      result.leaked++;
+    else
+      release(b);
+
+    result.ops = opNum;
+    result.nsPerOp = std::chrono::duration<double, std::nano>(end - start).count() / opNum;
+  }
+
+  ReplayResult result;
+
+ private:
+  bool alloc(LiveBuffer &b, uint16_t len, uint8_t fill, bool countFailure = true) {
+    b.tab = pool->allocMemory(len);
+    if (!b.tab) {
+      result.nulls++;
+      if (countFailure) result.failures++;
+      return false;
+    }
+    result.allocs++;
+    b.pmem = b.tab->pmem;
+    b.fill = fill;
+    memset(b.pmem, fill, len);
+    return true;
+  }
+
+  void release(LiveBuffer &b) {
+    if (b.tab->pmem != b.pmem) result.moved++;
+    for (uint32_t i = 0; i < b.tab->memSize; i++) {
+      if (b.tab->pmem[i] != b.fill) {
+        result.corrupted++;
+        break;
+      }
+    }
+    pool->freeMemory(b.tab);
+    b.tab = NULL;
+  }
+
+  void clearOldest() {
+    for (int i = 2; i < CMD_NUM; i++) {
+      if (cmd[i].tab) {
+        release(cmd[i]);
+        return;
+      }
+    }
+  }
+
+  Pool *pool;
+  LiveBuffer cmd[CMD_NUM];
+  LiveBuffer ack[ACK_NUM];
+};
+
+static void printResult(const char *name, const ReplayResult &r) {
+  printf("%-12s %8.1f ns/op  %llu allocs  %llu failures  %llu moved  %llu corrupted\n",
+         name, r.nsPerOp, (unsigned long long)r.allocs, (unsigned long long)r.failures,
+         (unsigned long long)r.moved, (unsigned long long)r.corrupted);
+}
+
+int main(int argc, char **argv) {
+  uint64_t opNum = (argc > 1) ? strtoull(argv[1], NULL, 10) : 2000000;
+
+  static CompactingMMU compacting;
+  SessionReplay<CompactingMMU> before(&compacting);
+  before.run(opNum, 2020);
+  printResult("compacting", before.result);
+
+  static MMU pool;
+  SessionReplay<MMU> after(&pool);
+  after.run(opNum, 2020);
+  printResult("size class", after.result);
+
+  MMUStat stat = pool.getStat();
+  printf("pool: %u spills, %u blocks / %u bytes high water, %u in use\n", stat.spills,
+         stat.blocksHighWater, stat.bytesHighWater, stat.blocksInUse);
+
+  bool pass = (after.result.moved == 0) && (after.result.corrupted == 0) &&
+              (after.result.leaked == 0) && (stat.blocksInUse == 0) &&
+              (stat.bytesInUse == 0) && (stat.allocs == stat.frees) &&
+              (stat.failures == after.result.nulls);
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
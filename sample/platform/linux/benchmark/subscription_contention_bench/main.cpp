@@ -0,0 +1,215 @@
+/*! @file benchmark/subscription_contention_bench/main.cpp
+ *  @version 4.0.0
+ *  @date Jan 2020
+ *
+ *  @brief
+ *  Several threads read subscribed topics while the receive thread decodes a
+ *  200 Hz package, through the sequence lock and through the message mutex.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "dji_subscription.hpp"
+#include "dji_platform.hpp"
+#include "osdkosal_linux.h"
+
+using namespace DJI;
+using namespace DJI::OSDK;
+using namespace DJI::OSDK::Telemetry;
+
+/* A DataSubscription without a vehicle starts its packages locally */
+static bool startPackage(DataSubscription *sub, int packageID, TopicName *topics, int topicNum,
+                         uint16_t freq) {
+  if (!sub->initPackageFromTopicList(packageID, topicNum, topics, false, freq)) {
+    return false;
+  }
+  sub->startPackage(packageID);
+  return true;
+}
+
+static uint32_t packageSize(const TopicName *topics, int topicNum) {
+  uint32_t size = 0;
+  for (int i = 0; i < topicNum; i++) size += TopicDataBase[topics[i]].size;
+  return size;
+}
+
+/* Before the sequence lock, getValue() and the decode held the same mutex */
+static std::mutex messageLock;
+
+static void lockedRead(Quaternion &q, Velocity &v) {
+  std::lock_guard<std::mutex> lock(messageLock);
+  q = *(Quaternion *)TopicDataBase[TOPIC_QUATERNION].latest;
+  v = *(Velocity *)TopicDataBase[TOPIC_VELOCITY].latest;
+}
+
+/* Every byte of a decoded package is the same, a read mixing two packages
+ * shows up as differing bytes. */
+static bool uniform(const uint8_t *p, size_t len, uint8_t value) {
+  for (size_t i = 0; i < len; i++) {
+    if (p[i] != value) return false;
+  }
+  return true;
+}
+
+typedef struct RunResult {
+  uint64_t reads;
+  uint64_t torn;
+  uint64_t frames;
+  double writerP50Us;
+  double writerP99Us;
+  double writerMaxUs;
+} RunResult;
+
+static RunResult runContention(DataSubscription *sub, uint32_t size, bool useMutex,
+                               int readerNum, int durationMs) {
+  std::atomic<bool> stop(false);
+  std::atomic<uint64_t> reads(0), torn(0);
+  std::vector<std::thread> readers;
+
+  for (int r = 0; r < readerNum; r++) {
+    readers.push_back(std::thread([&]() {
+      uint64_t myReads = 0, myTorn = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        Quaternion q;
+        Velocity v;
+        if (useMutex)
+          lockedRead(q, v);
+        else
+          sub->getValues<TOPIC_QUATERNION, TOPIC_VELOCITY>(q, v);
+        uint8_t value = *(uint8_t *)&q;
+        if (!uniform((uint8_t *)&q, sizeof(q), value) ||
+            !uniform((uint8_t *)&v, sizeof(v), value)) {
+          myTorn++;
+        }
+        myReads++;
+      }
+      reads += myReads;
+      torn += myTorn;
+    }));
+  }
+
+  /* The receive thread, one 200 Hz package every 5 ms */
+  RecvContainer frame;
+  memset(&frame, 0, sizeof(frame));
+  std::vector<double> decodeUs;
+  std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+  for (int tick = 0; tick < durationMs / 5; tick++) {
+    frame.recvData.raw_ack_array[0] = 0;
+    memset(frame.recvData.raw_ack_array + 1, (uint8_t)tick, size);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (useMutex) messageLock.lock();
+    sub->subscriptionDataDecodeRefHandler.callback(NULL, frame,
+                                                   sub->subscriptionDataDecodeRefHandler.userData);
+    if (useMutex) messageLock.unlock();
+    decodeUs.push_back(
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start)
+            .count());
+
+    next += std::chrono::milliseconds(5);
+    std::this_thread::sleep_until(next);
+  }
+
+  stop = true;
+  for (size_t r = 0; r < readers.size(); r++) readers[r].join();
+
+  std::sort(decodeUs.begin(), decodeUs.end());
+  RunResult res;
+  res.reads = reads.load();
+  res.torn = torn.load();
+  res.frames = decodeUs.size();
+  res.writerP50Us = decodeUs[decodeUs.size() / 2];
+  res.writerP99Us = decodeUs[decodeUs.size() * 99 / 100];
+  res.writerMaxUs = decodeUs.back();
+  return res;
+}
+
+static bool registerOsal() {
+  static T_OsdkOsalHandler osalHandler = {
+      .TaskCreate = OsdkLinux_TaskCreate,
+      .TaskDestroy = OsdkLinux_TaskDestroy,
+      .TaskSleepMs = OsdkLinux_TaskSleepMs,
+      .MutexCreate = OsdkLinux_MutexCreate,
+      .MutexDestroy = OsdkLinux_MutexDestroy,
+      .MutexLock = OsdkLinux_MutexLock,
+      .MutexUnlock = OsdkLinux_MutexUnlock,
+      .SemaphoreCreate = OsdkLinux_SemaphoreCreate,
+      .SemaphoreDestroy = OsdkLinux_SemaphoreDestroy,
+      .SemaphoreWait = OsdkLinux_SemaphoreWait,
+      .SemaphoreTimedWait = OsdkLinux_SemaphoreTimedWait,
+      .SemaphorePost = OsdkLinux_SemaphorePost,
+      .GetTimeMs = OsdkLinux_GetTimeMs,
+#ifdef OS_DEBUG
+      .GetTimeUs = OsdkLinux_GetTimeUs,
+#endif
+      .Malloc = OsdkLinux_Malloc,
+      .Free = OsdkLinux_Free,
+  };
+  return DJI_REG_OSAL_HANDLER(&osalHandler);
+}
+
+int main(int argc, char **argv) {
+  int durationMs = (argc > 1) ? atoi(argv[1]) : 2000;
+
+  if (!registerOsal()) {
+    printf("Osal handler register fail\n");
+    return 1;
+  }
+
+  DataSubscription sub(NULL);
+  TopicName topics[] = {TOPIC_QUATERNION, TOPIC_ACCELERATION_GROUND, TOPIC_VELOCITY,
+                        TOPIC_ANGULAR_RATE_FUSIONED};
+  if (!startPackage(&sub, 0, topics, 4, 200)) {
+    printf("Package setup fail\n");
+    return 1;
+  }
+  uint32_t size = packageSize(topics, 4);
+  printf("%d ms per run, %u hardware threads\n", durationMs,
+         std::thread::hardware_concurrency());
+  printf("%-8s %7s %14s %8s %28s\n", "lock", "readers", "reads/s", "torn",
+         "decode p50/p99/max (us)");
+
+  bool pass = true;
+  static const int readerNums[] = {1, 2, 4, 8};
+  for (int m = 0; m < 2; m++) {
+    bool useMutex = (m == 0);
+    for (size_t i = 0; i < sizeof(readerNums) / sizeof(readerNums[0]); i++) {
+      RunResult r = runContention(&sub, size, useMutex, readerNums[i], durationMs);
+      printf("%-8s %7d %14.0f %8llu %10.1f %8.1f %8.1f\n", useMutex ? "mutex" : "seqlock",
+             readerNums[i], r.reads * 1000.0 / durationMs, (unsigned long long)r.torn,
+             r.writerP50Us, r.writerP99Us, r.writerMaxUs);
+      pass = pass && (r.torn == 0) && (r.reads > 0);
+    }
+  }
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
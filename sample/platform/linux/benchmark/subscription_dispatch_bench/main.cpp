@@ -0,0 +1,236 @@
+/*! @file benchmark/subscription_dispatch_bench/main.cpp
+ *  @version 4.0.0
+ *  @date Jan 2020
+ *
+ *  @brief
+ *  Counts the RecvContainer copies between the frame adapter and the user
+ *  callback for a 200/50/5 Hz telemetry subscription.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "dji_subscription.hpp"
+#include "dji_platform.hpp"
+#include "osdkosal_linux.h"
+
+using namespace DJI;
+using namespace DJI::OSDK;
+using namespace DJI::OSDK::Telemetry;
+
+/* A DataSubscription without a vehicle starts its packages locally */
+static bool startPackage(DataSubscription *sub, int packageID, TopicName *topics, int topicNum,
+                         uint16_t freq) {
+  if (!sub->initPackageFromTopicList(packageID, topicNum, topics, false, freq)) {
+    return false;
+  }
+  sub->startPackage(packageID);
+  return true;
+}
+
+static uint32_t packageSize(const TopicName *topics, int topicNum) {
+  uint32_t size = 0;
+  for (int i = 0; i < topicNum; i++) size += TopicDataBase[topics[i]].size;
+  return size;
+}
+
+/* The frame the adapter built, and the distinct copies of it seen so far */
+static const RecvContainer *sourceFrame = NULL;
+static const RecvContainer *seenFrames[4];
+static int seenNum = 0;
+static uint64_t copies = 0;
+static uint64_t userCalls = 0;
+static uint64_t badFrames = 0;
+
+static void noteFrame(const RecvContainer *frame) {
+  if (frame == sourceFrame) return;
+  for (int i = 0; i < seenNum; i++) {
+    if (seenFrames[i] == frame) return;
+  }
+  if (seenNum < 4) seenFrames[seenNum++] = frame;
+  copies++;
+}
+
+static void checkFrame(const RecvContainer &recvFrame) {
+  noteFrame(&recvFrame);
+  userCalls++;
+  if (memcmp(&recvFrame.recvData, &sourceFrame->recvData, sizeof(recvFrame.recvData)) != 0) {
+    badFrames++;
+  }
+}
+
+static void userCallback(Vehicle *vehicle, RecvContainer recvFrame, UserData userData) {
+  checkFrame(recvFrame);
+}
+
+static void userRefCallback(Vehicle *vehicle, const RecvContainer &recvFrame,
+                            UserData userData) {
+  checkFrame(recvFrame);
+}
+
+/* What decodeCallback does for the linker that still copies the frame */
+static void byValueDecode(Vehicle *vehicle, RecvContainer recvFrame, UserData userData) {
+  noteFrame(&recvFrame);
+  DataSubscription::decodeRefCallback(vehicle, recvFrame, userData);
+}
+
+typedef struct Schedule {
+  int packageID;
+  uint16_t freq;
+  uint32_t size;
+} Schedule;
+
+/* A flight controller pushing one 200 Hz, one 50 Hz and one 5 Hz package */
+static Schedule schedule[] = {{0, 200, 0}, {1, 50, 0}, {2, 5, 0}};
+static const int scheduleNum = sizeof(schedule) / sizeof(schedule[0]);
+
+typedef struct RunResult {
+  uint64_t frames;
+  double nsPerFrame;
+  double copiesPerFrame;
+  uint64_t badFrames;
+} RunResult;
+
+static RunResult runFlight(DataSubscription *sub, bool byValue, uint32_t seconds) {
+  RecvContainer frame;
+  memset(&frame, 0, sizeof(frame));
+  sourceFrame = &frame;
+  copies = userCalls = badFrames = 0;
+
+  uint64_t frames = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (uint32_t tick = 0; tick < seconds * 200; tick++) {
+    for (int s = 0; s < scheduleNum; s++) {
+      if (tick % (200 / schedule[s].freq) != 0) continue;
+
+      /* Fresh payload every time, as the adapter writes it */
+      frame.recvData.raw_ack_array[0] = schedule[s].packageID;
+      for (uint32_t i = 0; i < schedule[s].size; i++) {
+        frame.recvData.raw_ack_array[1 + i] = (uint8_t)(tick + i);
+      }
+
+      seenNum = 0;
+      if (byValue)
+        byValueDecode(NULL, frame, sub);
+      else
+        sub->subscriptionDataDecodeRefHandler.callback(
+            NULL, frame, sub->subscriptionDataDecodeRefHandler.userData);
+      frames++;
+    }
+  }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  RunResult r;
+  r.frames = frames;
+  r.nsPerFrame = std::chrono::duration<double, std::nano>(end - start).count() / frames;
+  r.copiesPerFrame = (double)copies / frames;
+  r.badFrames = badFrames + (frames - userCalls);
+  return r;
+}
+
+static void printResult(const char *name, const RunResult &r, uint32_t seconds) {
+  double framesPerSecond = (double)r.frames / seconds;
+  printf("%-44s %7.1f ns/frame  %.2f copies/frame  %7.1f KB/s copied  %llu bad\n", name,
+         r.nsPerFrame, r.copiesPerFrame,
+         r.copiesPerFrame * framesPerSecond * sizeof(RecvContainer) / 1024.0,
+         (unsigned long long)r.badFrames);
+}
+
+static bool registerOsal() {
+  static T_OsdkOsalHandler osalHandler = {
+      .TaskCreate = OsdkLinux_TaskCreate,
+      .TaskDestroy = OsdkLinux_TaskDestroy,
+      .TaskSleepMs = OsdkLinux_TaskSleepMs,
+      .MutexCreate = OsdkLinux_MutexCreate,
+      .MutexDestroy = OsdkLinux_MutexDestroy,
+      .MutexLock = OsdkLinux_MutexLock,
+      .MutexUnlock = OsdkLinux_MutexUnlock,
+      .SemaphoreCreate = OsdkLinux_SemaphoreCreate,
+      .SemaphoreDestroy = OsdkLinux_SemaphoreDestroy,
+      .SemaphoreWait = OsdkLinux_SemaphoreWait,
+      .SemaphoreTimedWait = OsdkLinux_SemaphoreTimedWait,
+      .SemaphorePost = OsdkLinux_SemaphorePost,
+      .GetTimeMs = OsdkLinux_GetTimeMs,
+#ifdef OS_DEBUG
+      .GetTimeUs = OsdkLinux_GetTimeUs,
+#endif
+      .Malloc = OsdkLinux_Malloc,
+      .Free = OsdkLinux_Free,
+  };
+  return DJI_REG_OSAL_HANDLER(&osalHandler);
+}
+
+int main(int argc, char **argv) {
+  uint32_t seconds = (argc > 1) ? strtoul(argv[1], NULL, 10) : 3600;
+
+  if (!registerOsal()) {
+    printf("Osal handler register fail\n");
+    return 1;
+  }
+
+  DataSubscription sub(NULL);
+  TopicName fast[] = {TOPIC_QUATERNION, TOPIC_ACCELERATION_GROUND, TOPIC_VELOCITY,
+                      TOPIC_ANGULAR_RATE_FUSIONED};
+  TopicName medium[] = {TOPIC_GPS_FUSED, TOPIC_RC, TOPIC_GIMBAL_ANGLES, TOPIC_STATUS_FLIGHT};
+  TopicName slow[] = {TOPIC_BATTERY_INFO, TOPIC_GPS_DETAILS};
+  if (!startPackage(&sub, 0, fast, 4, 200) || !startPackage(&sub, 1, medium, 4, 50) ||
+      !startPackage(&sub, 2, slow, 2, 5)) {
+    printf("Package setup fail\n");
+    return 1;
+  }
+  schedule[0].size = packageSize(fast, 4);
+  schedule[1].size = packageSize(medium, 4);
+  schedule[2].size = packageSize(slow, 2);
+  printf("%u s of flight, RecvContainer is %zu bytes\n", seconds, sizeof(RecvContainer));
+
+  for (int s = 0; s < scheduleNum; s++) {
+    sub.registerUserPackageUnpackCallback(schedule[s].packageID, userCallback);
+  }
+  RunResult before = runFlight(&sub, true, seconds);
+  printResult("by-value decode, VehicleCallBack", before, seconds);
+
+  RunResult legacy = runFlight(&sub, false, seconds);
+  printResult("by-reference decode, VehicleCallBack", legacy, seconds);
+
+  for (int s = 0; s < scheduleNum; s++) {
+    sub.registerUserPackageUnpackRefCallback(schedule[s].packageID, userRefCallback);
+  }
+  RunResult ref = runFlight(&sub, false, seconds);
+  printResult("by-reference decode, VehicleCallBackRef", ref, seconds);
+
+  /* The last frame of the 200 Hz package must be what the topics read */
+  Quaternion q = sub.getValue<TOPIC_QUATERNION>();
+  uint8_t expect[sizeof(q)];
+  uint32_t lastTick = seconds * 200 - 1;
+  for (uint32_t i = 0; i < sizeof(q); i++) expect[i] = (uint8_t)(lastTick + i);
+  bool topicOk = memcmp(&q, expect, sizeof(q)) == 0;
+  printf("quaternion topic %s\n", topicOk ? "matches the last frame" : "MISMATCH");
+
+  bool pass = topicOk && before.copiesPerFrame == 2.0 && legacy.copiesPerFrame == 1.0 &&
+              ref.copiesPerFrame == 0.0 && before.badFrames == 0 && legacy.badFrames == 0 &&
+              ref.badFrames == 0;
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,291 @@
+/*! @file benchmark/timer_pacing_bench/main.cpp
+ *  @version 4.0.0
+ *  @date Jan 2020
+ *
+ *  @brief
+ *  Pacing accuracy and CPU use of the UDT sending queue timer, compared with
+ *  the rdtsc based timer it replaced.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <pthread.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <vector>
+#include "common.h"
+
+/* Clock of the replaced timer, the TSC on x86 */
+static uint64_t legacyCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  uint32_t lval, hval;
+  asm volatile("rdtsc" : "=a"(lval), "=d"(hval));
+  return ((uint64_t)hval << 32) | lval;
+#else
+  return CTimer::getTime();
+#endif
+}
+
+/*! The CTimer::sleepto() loop before the timerfd one. busyWaiting is the
+ *  default build, without it (NO_BUSY_WAITING) the loop waits on a
+ *  condition in 10 ms slices unless tick() is called. */
+class LegacyTimer {
+ public:
+  LegacyTimer(bool busyWaiting) : busyWaiting(busyWaiting), schedTime(0) {
+    pthread_mutex_init(&tickLock, NULL);
+    pthread_cond_init(&tickCond, NULL);
+  }
+
+  ~LegacyTimer() {
+    pthread_mutex_destroy(&tickLock);
+    pthread_cond_destroy(&tickCond);
+  }
+
+  static uint64_t now() { return legacyCycles(); }
+
+  static uint64_t frequency() {
+    static uint64_t freq = 0;
+    if (0 == freq) {
+#if defined(__x86_64__) || defined(__i386__)
+      uint64_t t1 = legacyCycles();
+      timespec ts = {0, 100000000};
+      nanosleep(&ts, NULL);
+      freq = (legacyCycles() - t1) / 100000;
+#endif
+      if (freq < 10) freq = 1;
+    }
+    return freq;
+  }
+
+  void sleepto(uint64_t nexttime) {
+    schedTime = nexttime;
+
+    uint64_t t = legacyCycles();
+    while (t < schedTime) {
+      if (busyWaiting) {
+        __asm__ volatile("nop; nop; nop; nop; nop;");
+      } else {
+        timeval nowTv;
+        timespec timeout;
+        gettimeofday(&nowTv, 0);
+        if (nowTv.tv_usec < 990000) {
+          timeout.tv_sec = nowTv.tv_sec;
+          timeout.tv_nsec = (nowTv.tv_usec + 10000) * 1000;
+        } else {
+          timeout.tv_sec = nowTv.tv_sec + 1;
+          timeout.tv_nsec = (nowTv.tv_usec + 10000 - 1000000) * 1000;
+        }
+        pthread_mutex_lock(&tickLock);
+        pthread_cond_timedwait(&tickCond, &tickLock, &timeout);
+        pthread_mutex_unlock(&tickLock);
+      }
+      t = legacyCycles();
+    }
+  }
+
+  void interrupt() {
+    schedTime = legacyCycles();
+    tick();
+  }
+
+  void tick() { pthread_cond_signal(&tickCond); }
+
+ private:
+  bool busyWaiting;
+  volatile uint64_t schedTime;
+  pthread_cond_t tickCond;
+  pthread_mutex_t tickLock;
+};
+
+/*! The current timer, behind the same interface */
+class CurrentTimer {
+ public:
+  static uint64_t now() {
+    uint64_t t;
+    CTimer::rdtsc(t);
+    return t;
+  }
+
+  static uint64_t frequency() { return CTimer::getCPUFrequency(); }
+
+  void sleepto(uint64_t nexttime) { timer.sleepto(nexttime); }
+  void interrupt() { timer.interrupt(); }
+  void tick() { timer.tick(); }
+
+  CTimer timer;
+};
+
+static double threadCpuUs() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+typedef struct PacingResult {
+  uint64_t sleeps;
+  uint64_t early;      /* sleeps that returned before their time */
+  double lateAvgUs;
+  double lateP99Us;
+  double lateMaxUs;
+  double cpuMsPerSec;  /* CPU time of the paced thread per second of pacing */
+} PacingResult;
+
+/* Paces one thread on a fixed period, as the sending queue does for a
+ * constant rate stream. tickUs > 0 adds the receiving queue worker, which
+ * ticks the timer on every loop when built with NO_BUSY_WAITING; its own
+ * CPU time is not counted, that worker runs anyway. */
+template <typename Timer>
+static PacingResult runPacing(Timer &timer, int periodUs, double seconds, int tickUs) {
+  std::atomic<bool> stop(false);
+  std::thread ticker;
+  if (tickUs > 0) {
+    ticker = std::thread([&]() {
+      while (!stop.load()) {
+        timer.tick();
+        std::this_thread::sleep_for(std::chrono::microseconds(tickUs));
+      }
+    });
+  }
+
+  uint64_t freq = Timer::frequency();
+  uint64_t sleeps = (uint64_t)(seconds * 1e6 / periodUs);
+  std::vector<double> late;
+  late.reserve(sleeps);
+  PacingResult r = {0};
+
+  double cpuStart = threadCpuUs();
+  uint64_t next = Timer::now();
+  for (uint64_t i = 0; i < sleeps; i++) {
+    next += periodUs * freq;
+    timer.sleepto(next);
+    uint64_t t = Timer::now();
+    if (t < next) {
+      r.early++;
+      late.push_back(0);
+    } else {
+      late.push_back((double)(t - next) / freq);
+    }
+  }
+  double cpuUs = threadCpuUs() - cpuStart;
+
+  stop = true;
+  if (ticker.joinable()) ticker.join();
+
+  double total = 0;
+  for (size_t i = 0; i < late.size(); i++) total += late[i];
+  std::sort(late.begin(), late.end());
+  r.sleeps = sleeps;
+  r.lateAvgUs = total / sleeps;
+  r.lateP99Us = late[sleeps * 99 / 100];
+  r.lateMaxUs = late.back();
+  r.cpuMsPerSec = cpuUs / 1e3 / (sleeps * periodUs / 1e6);
+  return r;
+}
+
+/* Time for interrupt() to end a long sleep, as when a packet is queued
+ * while the sending queue waits for the next scheduled one */
+template <typename Timer>
+static double runInterrupt(Timer &timer, int rounds) {
+  uint64_t freq = Timer::frequency();
+  double worst = 0;
+  for (int i = 0; i < rounds; i++) {
+    std::atomic<uint64_t> sent(0);
+    std::thread waker([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      sent = Timer::now();
+      timer.interrupt();
+    });
+    timer.sleepto(Timer::now() + 1000000ULL * freq);
+    uint64_t woke = Timer::now();
+    waker.join();
+    double us = (woke > sent.load()) ? (double)(woke - sent.load()) / freq : 0;
+    if (us > worst) worst = us;
+  }
+  return worst;
+}
+
+static void printResult(const char *name, int periodUs, const PacingResult &r) {
+  printf("%-30s %6d us  late avg %8.1f us  p99 %8.1f us  max %8.1f us  %6.1f ms CPU/s  %llu early\n",
+         name, periodUs, r.lateAvgUs, r.lateP99Us, r.lateMaxUs, r.cpuMsPerSec,
+         (unsigned long long)r.early);
+}
+
+int main(int argc, char **argv) {
+  double seconds = (argc > 1) ? atof(argv[1]) : 1.0;
+  static const int periods[] = {50, 1000, 10000};
+  bool pass = true;
+
+  printf("%-30s %9s\n", "timer", "period");
+  for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+    int period = periods[p];
+    double runSeconds = std::max(seconds, period * 50 / 1e6);
+
+    LegacyTimer busy(true);
+    PacingResult busyRes = runPacing(busy, period, runSeconds, 0);
+    printResult("old, busy waiting", period, busyRes);
+
+    LegacyTimer sliced(false);
+    PacingResult slicedRes = runPacing(sliced, period, runSeconds, 0);
+    printResult("old, NO_BUSY_WAITING", period, slicedRes);
+
+    LegacyTimer ticked(false);
+    PacingResult tickedRes = runPacing(ticked, period, runSeconds, 100);
+    printResult("old, NO_BUSY_WAITING + ticks", period, tickedRes);
+
+    CurrentTimer current;
+    CTimerStat before;
+    current.timer.getStat(before);
+    PacingResult currentRes = runPacing(current, period, runSeconds, 0);
+    printResult("timerfd", period, currentRes);
+
+    /* nothing interrupts the paced thread, so every sleep that waited is a full one */
+    CTimerStat after;
+    current.timer.getStat(after);
+    int64_t waited = after.m_llSleeps - before.m_llSleeps;
+    int64_t fullSleeps = after.m_llFullSleeps - before.m_llFullSleeps;
+    if ((waited <= 0) || (waited > (int64_t)currentRes.sleeps) || (fullSleeps != waited)) pass = false;
+
+    if (busyRes.early || slicedRes.early || tickedRes.early || currentRes.early) pass = false;
+    /* the point of the timer: far less CPU than spinning */
+    if (currentRes.cpuMsPerSec >= busyRes.cpuMsPerSec) pass = false;
+  }
+
+  LegacyTimer busy(true);
+  LegacyTimer sliced(false);
+  CurrentTimer current;
+  double busyWake = runInterrupt(busy, 20);
+  double slicedWake = runInterrupt(sliced, 20);
+  double currentWake = runInterrupt(current, 20);
+  printf("interrupt() wake-up, worst of 20: old busy %.1f us, old NO_BUSY_WAITING %.1f us, timerfd %.1f us\n",
+         busyWake, slicedWake, currentWake);
+  /* an interrupted sleep must not run to its one second deadline */
+  if ((busyWake > 500000) || (slicedWake > 500000) || (currentWake > 500000)) pass = false;
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
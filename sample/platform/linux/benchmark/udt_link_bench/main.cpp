@@ -0,0 +1,523 @@
+/*! @file benchmark/udt_link_bench/main.cpp
+ *  @version 4.0.0
+ *  @date Jan 2020
+ *
+ *  @brief
+ *  Streams 30 fps synthetic H.264 from a UDT sender to a receiver connected
+ *  like DJICameraStreamLink, through an in-process lossy link over loopback.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+#include "udt.h"
+#include "ccc.h"
+
+/* Same read size as DJICameraStreamLink */
+static const int RECEIVE_SIZE = 128000;
+static const int FPS = 30;
+
+static uint64_t nowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+typedef struct LinkConfig {
+  const char *name;
+  double lossRate;  /* probability a datagram is dropped, in each direction */
+  int delayUs;      /* one-way delay */
+  int jitterUs;     /* random extra delay up to this, reorders datagrams closer than it */
+} LinkConfig;
+
+/*! UDP relay between the receiver and the sender, impairing both
+ *  directions with the same settings. The random seed is fixed, so a run
+ *  can be reproduced. */
+class LinkShim {
+ public:
+  LinkShim(const LinkConfig &config, const sockaddr_in &server)
+      : config(config), server(server), rng(2020), stopping(false) {
+    memset(&client, 0, sizeof(client));
+    forwarded[0] = forwarded[1] = dropped[0] = dropped[1] = 0;
+  }
+
+  ~LinkShim() {
+    stop();
+    for (std::multimap<uint64_t, Datagram>::iterator i = line.begin(); i != line.end(); ++i)
+      delete[] i->second.data;
+  }
+
+  /*! The receiver connects to the returned address */
+  bool start(sockaddr_in *addr) {
+    front = openSocket();
+    back = openSocket();
+    if (front < 0 || back < 0) return false;
+    socklen_t len = sizeof(*addr);
+    if (0 != getsockname(front, (sockaddr *)addr, &len)) return false;
+    worker = std::thread(&LinkShim::run, this);
+    return true;
+  }
+
+  void stop() {
+    stopping = true;
+    if (worker.joinable()) worker.join();
+    if (front >= 0) close(front);
+    if (back >= 0) close(back);
+    front = back = -1;
+  }
+
+  /* [0] receiver to sender, [1] sender to receiver */
+  uint64_t forwarded[2];
+  uint64_t dropped[2];
+
+ private:
+  typedef struct Datagram {
+    int dir;
+    int len;
+    char *data;
+  } Datagram;
+
+  static int openSocket() {
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s < 0) return -1;
+    /* the relay itself must not lose anything on top of the settings */
+    int size = 4 * 1024 * 1024;
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    setsockopt(s, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (0 != bind(s, (sockaddr *)&addr, sizeof(addr))) {
+      close(s);
+      return -1;
+    }
+    return s;
+  }
+
+  void receive(int s, int dir) {
+    char buf[65536];
+    while (true) {
+      sockaddr_in from;
+      socklen_t fromLen = sizeof(from);
+      ssize_t n = recvfrom(s, buf, sizeof(buf), MSG_DONTWAIT, (sockaddr *)&from, &fromLen);
+      if (n < 0) return;
+      if (dir == 0) client = from;
+
+      if (std::uniform_real_distribution<double>(0, 1)(rng) < config.lossRate) {
+        dropped[dir]++;
+        continue;
+      }
+      uint64_t release = nowUs() + config.delayUs;
+      if (config.jitterUs > 0) release += rng() % config.jitterUs;
+
+      Datagram d;
+      d.dir = dir;
+      d.len = (int)n;
+      d.data = new char[n];
+      memcpy(d.data, buf, n);
+      line.insert(std::make_pair(release, d));
+    }
+  }
+
+  void run() {
+    while (!stopping.load()) {
+      uint64_t now = nowUs();
+      while (!line.empty() && line.begin()->first <= now) {
+        Datagram &d = line.begin()->second;
+        if (d.dir == 0)
+          sendto(back, d.data, d.len, 0, (const sockaddr *)&server, sizeof(server));
+        else
+          sendto(front, d.data, d.len, 0, (const sockaddr *)&client, sizeof(client));
+        forwarded[d.dir]++;
+        delete[] d.data;
+        line.erase(line.begin());
+      }
+
+      timespec timeout = {0, 5000000};
+      if (!line.empty()) {
+        uint64_t wait = std::min<uint64_t>(line.begin()->first - now, 5000);
+        timeout.tv_nsec = wait * 1000;
+      }
+      pollfd fds[2] = {{front, POLLIN, 0}, {back, POLLIN, 0}};
+      if (ppoll(fds, 2, &timeout, NULL) <= 0) continue;
+      if (fds[0].revents & POLLIN) receive(front, 0);
+      if (fds[1].revents & POLLIN) receive(back, 1);
+    }
+  }
+
+  LinkConfig config;
+  sockaddr_in server;
+  sockaddr_in client;
+  int front = -1;
+  int back = -1;
+  std::mt19937 rng;
+  std::multimap<uint64_t, Datagram> line;  /* datagrams in flight, by release time */
+  std::atomic<bool> stopping;
+  std::thread worker;
+};
+
+/*! Annex-B frames carrying their index, length and capture time. Header
+ *  fields are written 7 bits per byte with the top bit set and payload
+ *  bytes are never 0, so the only start codes are at frame starts and a
+ *  receiver can resynchronise after skipped data. */
+class FrameFormat {
+ public:
+  static const int HEADER_SIZE = 5 + 4 + 4 + 5;
+
+  FrameFormat() : noise(NOISE_SIZE) {
+    std::mt19937 noiseRng(2020);
+    for (size_t i = 0; i < noise.size(); i++) noise[i] = (char)(1 + noiseRng() % 255);
+  }
+
+  void build(uint32_t index, uint32_t len, uint64_t captureUs, std::vector<char> &frame) const {
+    frame.resize(len);
+    frame[0] = frame[1] = frame[2] = 0;
+    frame[3] = 1;
+    frame[4] = (index % FPS == 0) ? 0x65 : 0x41;
+    putField(&frame[5], index, 4);
+    putField(&frame[9], len, 4);
+    putField(&frame[13], captureUs, 5);
+    memcpy(&frame[HEADER_SIZE], payload(index, len), len - HEADER_SIZE);
+  }
+
+  /*! @return false if buf does not hold a valid header */
+  static bool parse(const char *buf, uint32_t *index, uint32_t *len, uint64_t *captureUs) {
+    uint64_t v[3];
+    return getField(buf + 5, 4, &v[0]) && getField(buf + 9, 4, &v[1]) &&
+           getField(buf + 13, 5, &v[2]) && (*index = v[0], *len = v[1], *captureUs = v[2],
+                                            *len >= (uint32_t)HEADER_SIZE);
+  }
+
+  const char *payload(uint32_t index, uint32_t len) const {
+    return &noise[(index * 7919u) % (NOISE_SIZE - len)];
+  }
+
+  static bool isStartCode(const char *p) { return !p[0] && !p[1] && !p[2] && p[3] == 1; }
+
+ private:
+  static const size_t NOISE_SIZE = 1024 * 1024;
+
+  static void putField(char *p, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) p[i] = (char)(0x80 | ((value >> (7 * i)) & 0x7F));
+  }
+
+  static bool getField(const char *p, int bytes, uint64_t *value) {
+    *value = 0;
+    for (int i = 0; i < bytes; i++) {
+      if (!(p[i] & 0x80)) return false;
+      *value |= (uint64_t)(p[i] & 0x7F) << (7 * i);
+    }
+    return true;
+  }
+
+  std::vector<char> noise;
+};
+
+/*! Cuts the received stream back into frames. A frame cut short by a
+ *  start code was partly skipped by the receiver and is not shown. */
+class FrameReceiver {
+ public:
+  FrameReceiver(const FrameFormat &format)
+      : complete(0), incomplete(0), mismatches(0), bytes(0), lastIndex(0), format(format) {}
+
+  void feed(const char *data, int len, uint64_t now) {
+    buf.insert(buf.end(), data, data + len);
+    size_t pos = 0;
+    while (buf.size() - pos >= (size_t)FrameFormat::HEADER_SIZE) {
+      const char *p = &buf[pos];
+      uint32_t index, frameLen;
+      uint64_t captureUs;
+      if (!FrameFormat::isStartCode(p) || !FrameFormat::parse(p, &index, &frameLen, &captureUs)) {
+        /* keep the last bytes, a start code may continue in the next chunk */
+        size_t next = findStartCode(pos + 1, buf.size());
+        pos = (next < buf.size()) ? next : std::max(pos + 1, buf.size() - 3);
+        continue;
+      }
+
+      size_t avail = std::min(buf.size() - pos, (size_t)frameLen);
+      size_t cut = findStartCode(pos + 4, pos + avail);
+      if (cut < pos + avail) {
+        incomplete++;
+        pos = cut;
+        continue;
+      }
+      if (avail < frameLen) break;
+
+      /* skipped data may also join two frames without a start code between */
+      if (0 != memcmp(p + FrameFormat::HEADER_SIZE, format.payload(index, frameLen),
+                      frameLen - FrameFormat::HEADER_SIZE)) {
+        incomplete++;
+        mismatches++;
+        pos += frameLen;
+        continue;
+      }
+      complete++;
+      bytes += frameLen;
+      lastIndex = index;
+      latencyUs.push_back(now - captureUs);
+      pos += frameLen;
+    }
+    buf.erase(buf.begin(), buf.begin() + pos);
+  }
+
+  uint64_t complete;
+  uint64_t incomplete;
+  uint64_t mismatches;
+  uint64_t bytes;
+  uint32_t lastIndex;
+  std::vector<uint64_t> latencyUs;
+
+ private:
+  /* first complete start code beginning in [from, end), or end */
+  size_t findStartCode(size_t from, size_t end) const {
+    for (size_t i = from; i < end && i + 4 <= buf.size(); i++)
+      if (FrameFormat::isStartCode(&buf[i])) return i;
+    return end;
+  }
+
+  const FrameFormat &format;
+  std::vector<char> buf;
+};
+
+typedef struct SenderStat {
+  bool ok;
+  uint32_t frames;
+  UDT::TRACEINFO perf;
+  std::atomic<bool> finished;
+  std::atomic<bool> receiverDone;
+} SenderStat;
+
+/* The camera side: one frame every 1/FPS s, an IDR frame each second */
+static void runSender(UDTSOCKET server, const FrameFormat *format, int kbps, SenderStat *stat) {
+  sockaddr_in peer;
+  int peerLen = sizeof(peer);
+  UDTSOCKET sock = UDT::accept(server, (sockaddr *)&peer, &peerLen);
+  stat->ok = (sock != UDT::INVALID_SOCK);
+
+  std::mt19937 rng(2020);
+  uint32_t avg = kbps * 1000 / 8 / FPS;
+  uint32_t idrLen = avg * 5;
+  uint32_t pLen = (avg * FPS - idrLen) / (FPS - 1);
+  std::vector<char> frame;
+  uint64_t start = nowUs();
+  for (uint32_t i = 0; stat->ok && i < stat->frames; i++) {
+    uint64_t capture = start + (uint64_t)i * 1000000 / FPS;
+    uint64_t now = nowUs();
+    if (capture > now) std::this_thread::sleep_for(std::chrono::microseconds(capture - now));
+
+    uint32_t len = (i % FPS == 0) ? idrLen : pLen * 4 / 5 + rng() % (pLen * 2 / 5);
+    format->build(i, len, capture, frame);
+    int sent = 0;
+    while (sent < (int)frame.size()) {
+      int n = UDT::send(sock, &frame[sent], (int)frame.size() - sent, 0);
+      if (n == UDT::ERROR) {
+        printf("send: %s\n", UDT::getlasterror().getErrorMessage());
+        stat->ok = false;
+        break;
+      }
+      sent += n;
+    }
+  }
+  stat->finished = true;
+
+  /* Closing breaks the connection, wait until the receiver has its stats */
+  while (!stat->receiverDone.load()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  if (stat->ok && UDT::ERROR == UDT::perfmon(sock, &stat->perf)) stat->ok = false;
+  UDT::close(sock);
+}
+
+typedef struct RunResult {
+  bool ok;
+  uint64_t frames;
+  uint64_t complete;
+  uint64_t incomplete;
+  uint64_t mismatches;
+  double goodputMbps;
+  double p50Ms, p95Ms, p99Ms, maxMs;
+  double retransPercent;
+  int rcvDropped;
+} RunResult;
+
+typedef struct Profile {
+  const char *name;
+  int senderLatencyMs;    /* CLiveCC with this latency, 0 for the default CUDTCC */
+  int receiverLatencyMs;  /* UDT_LATENCY of the receiver, 0 to wait for every lost packet */
+} Profile;
+
+static RunResult runLink(const LinkConfig &link, const Profile &profile, int kbps, double seconds,
+                         const FrameFormat &format) {
+  RunResult r;
+  memset(&r, 0, sizeof(r));
+
+  UDTSOCKET server = UDT::socket(AF_INET, SOCK_STREAM, 0);
+  if (profile.senderLatencyMs > 0) {
+    /* accepted sockets inherit the congestion control and the latency */
+    CCCFactory<CLiveCC> liveCC;
+    UDT::setsockopt(server, 0, UDT_CC, &liveCC, sizeof(liveCC));
+    UDT::setsockopt(server, 0, UDT_LATENCY, &profile.senderLatencyMs, sizeof(int));
+  }
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  int addrLen = sizeof(addr);
+  if (UDT::ERROR == UDT::bind(server, (sockaddr *)&addr, sizeof(addr)) ||
+      UDT::ERROR == UDT::getsockname(server, (sockaddr *)&addr, &addrLen) ||
+      UDT::ERROR == UDT::listen(server, 1)) {
+    printf("server: %s\n", UDT::getlasterror().getErrorMessage());
+    return r;
+  }
+
+  LinkShim shim(link, addr);
+  sockaddr_in shimAddr;
+  if (!shim.start(&shimAddr)) {
+    printf("link shim setup fail\n");
+    UDT::close(server);
+    return r;
+  }
+
+  SenderStat senderStat;
+  senderStat.frames = (uint32_t)(seconds * FPS);
+  senderStat.finished = false;
+  senderStat.receiverDone = false;
+  std::thread sender(runSender, server, &format, kbps, &senderStat);
+
+  /* Set up like DJICameraStreamLink::init() */
+  UDTSOCKET sock = UDT::socket(AF_INET, SOCK_STREAM, 0);
+  int timeoutMs = 100;
+  UDT::setsockopt(sock, 0, UDT_RCVTIMEO, &timeoutMs, sizeof(int));
+  if (profile.receiverLatencyMs > 0)
+    UDT::setsockopt(sock, 0, UDT_LATENCY, &profile.receiverLatencyMs, sizeof(int));
+  bool connected = (UDT::ERROR != UDT::connect(sock, (sockaddr *)&shimAddr, sizeof(shimAddr)));
+  if (!connected) printf("connect: %s\n", UDT::getlasterror().getErrorMessage());
+
+  FrameReceiver receiver(format);
+  std::vector<char> buf(RECEIVE_SIZE);
+  uint64_t start = nowUs();
+  uint64_t lastData = start;
+  while (connected && receiver.lastIndex + 1 < senderStat.frames) {
+    int n = UDT::recv(sock, &buf[0], RECEIVE_SIZE, 0);
+    uint64_t now = nowUs();
+    if (n == UDT::ERROR) {
+      if (UDT::getlasterror_code() != CUDTException::ETIMEOUT) {
+        printf("recv: %s\n", UDT::getlasterror().getErrorMessage());
+        break;
+      }
+      /* the last frames may have been given up */
+      if (senderStat.finished.load() && now - lastData > 2000000) break;
+      continue;
+    }
+    receiver.feed(&buf[0], n, now);
+    lastData = now;
+  }
+  double sec = (lastData - start) / 1e6;
+
+  UDT::TRACEINFO perf;
+  bool perfOk = connected && (UDT::ERROR != UDT::perfmon(sock, &perf));
+  senderStat.receiverDone = true;
+  sender.join();
+  UDT::close(sock);
+  UDT::close(server);
+  shim.stop();
+
+  r.ok = perfOk && senderStat.ok;
+  r.frames = senderStat.frames;
+  r.complete = receiver.complete;
+  r.incomplete = receiver.incomplete;
+  r.mismatches = receiver.mismatches;
+  r.goodputMbps = sec > 0 ? receiver.bytes * 8 / sec / 1e6 : 0;
+  std::vector<uint64_t> &lat = receiver.latencyUs;
+  std::sort(lat.begin(), lat.end());
+  if (!lat.empty()) {
+    r.p50Ms = lat[lat.size() * 50 / 100] / 1e3;
+    r.p95Ms = lat[lat.size() * 95 / 100] / 1e3;
+    r.p99Ms = lat[lat.size() * 99 / 100] / 1e3;
+    r.maxMs = lat.back() / 1e3;
+  }
+  if (r.ok) {
+    r.retransPercent = senderStat.perf.pktSentTotal
+                           ? 100.0 * senderStat.perf.pktRetransTotal / senderStat.perf.pktSentTotal
+                           : 0;
+    r.rcvDropped = perf.pktRcvDropTotal;
+  }
+  return r;
+}
+
+int main(int argc, char **argv) {
+  double seconds = (argc > 1) ? atof(argv[1]) : 10;
+  int kbps = (argc > 2) ? atoi(argv[2]) : 8000;
+  /* DJICameraStreamLink only sets the receiver side, the camera runs the sender */
+  static const Profile profiles[] = {
+      {"reliable", 0, 0},
+      {"skip", 0, 100},
+      {"live", 100, 100},
+  };
+  static const LinkConfig links[] = {
+      {"clean", 0, 0, 0},
+      {"2% loss, 10 ms", 0.02, 10000, 0},
+      {"5% loss, 20 ms, 5 ms jitter", 0.05, 20000, 5000},
+  };
+
+  UDT::startup();
+  FrameFormat format;
+  bool pass = true;
+
+  printf("%d kbit/s at %d fps for %.0f s\n", kbps, FPS, seconds);
+  printf("reliable: default CC, nothing skipped; skip: receiver UDT_LATENCY 100 ms only;\n"
+         "live: CLiveCC sender and UDT_LATENCY 100 ms on both sides\n");
+  printf("%-28s %-8s %8s %9s %6s %8s %8s %8s %8s %7s %6s\n", "link", "profile", "Mbit/s", "frames",
+         "cut", "p50 ms", "p95 ms", "p99 ms", "max ms", "retx %", "drop");
+  for (size_t i = 0; i < sizeof(links) / sizeof(links[0]); i++) {
+    for (size_t j = 0; j < sizeof(profiles) / sizeof(profiles[0]); j++) {
+      const Profile &profile = profiles[j];
+      RunResult r = runLink(links[i], profile, kbps, seconds, format);
+      printf("%-28s %-8s %8.2f %4llu/%-4llu %6llu %8.1f %8.1f %8.1f %8.1f %7.2f %6d\n",
+             links[i].name, profile.name, r.goodputMbps, (unsigned long long)r.complete,
+             (unsigned long long)r.frames, (unsigned long long)r.incomplete, r.p50Ms, r.p95Ms,
+             r.p99Ms, r.maxMs, r.retransPercent, r.rcvDropped);
+
+      if (!r.ok) pass = false;
+      /* nothing is skipped without a receiver latency, or on a clean link */
+      bool skipping = (profile.receiverLatencyMs > 0) && (links[i].lossRate > 0);
+      if (!skipping && (r.complete != r.frames || r.mismatches != 0)) pass = false;
+      if (skipping && r.complete < r.frames / 2) pass = false;
+    }
+  }
+
+  UDT::cleanup();
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
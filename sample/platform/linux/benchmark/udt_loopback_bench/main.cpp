@@ -0,0 +1,215 @@
+/*! @file benchmark/udt_loopback_bench/main.cpp
+ *  @version 4.0.0
+ *  @date Jan 2020
+ *
+ *  @brief
+ *  Sends a synthetic H.264 stream from a UDT server to a receiver connected
+ *  like DJICameraStreamLink, over the loopback interface.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include "udt.h"
+
+/* Same read size as DJICameraStreamLink */
+static const int RECEIVE_SIZE = 128000;
+
+/*! Deterministic Annex-B access units, an IDR picture every 30 frames.
+ *  Payload bytes are never 0, so no start code shows up inside a NAL.
+ *  They are cut from a fixed noise table to keep the generator cheap. */
+class H264Source {
+ public:
+  H264Source(uint32_t seed) : rng(seed), frame(0), noise(NOISE_SIZE) {
+    std::mt19937 noiseRng(seed);
+    for (size_t i = 0; i < noise.size(); i++) noise[i] = (char)(1 + noiseRng() % 255);
+  }
+
+  void next(std::vector<char> &au) {
+    bool idr = (frame++ % 30) == 0;
+    size_t len = idr ? 60000 + rng() % 40000 : 8000 + rng() % 17000;
+    au.resize(len);
+    au[0] = 0;
+    au[1] = 0;
+    au[2] = 0;
+    au[3] = 1;
+    au[4] = idr ? 0x65 : 0x41;
+    memcpy(&au[5], &noise[rng() % (NOISE_SIZE - len)], len - 5);
+  }
+
+ private:
+  static const size_t NOISE_SIZE = 1024 * 1024;
+
+  std::mt19937 rng;
+  uint64_t frame;
+  std::vector<char> noise;
+};
+
+/*! Compares the received byte stream with what the source generated */
+class StreamChecker {
+ public:
+  StreamChecker(uint32_t seed) : source(seed), pos(0), units(0), mismatches(0) {
+    source.next(au);
+  }
+
+  void feed(const char *buf, int len) {
+    while (len > 0) {
+      int n = std::min(len, (int)(au.size() - pos));
+      if (memcmp(buf, &au[pos], n) != 0) mismatches++;
+      buf += n;
+      len -= n;
+      pos += n;
+      if (pos == au.size()) {
+        units++;
+        pos = 0;
+        source.next(au);
+      }
+    }
+  }
+
+  uint64_t getUnits() const { return units; }
+  uint64_t getMismatches() const { return mismatches; }
+
+ private:
+  H264Source source;
+  std::vector<char> au;
+  size_t pos;
+  uint64_t units;
+  uint64_t mismatches;
+};
+
+typedef struct SenderStat {
+  uint64_t bytes;
+  bool ok;
+  UDT::TRACEINFO perf;
+  std::atomic<bool> receiverDone;
+} SenderStat;
+
+/* The camera side, accepts one receiver and sends it the stream */
+static void runSender(UDTSOCKET server, uint64_t totalBytes, uint32_t seed, SenderStat *stat) {
+  sockaddr_in peer;
+  int peerLen = sizeof(peer);
+  UDTSOCKET sock = UDT::accept(server, (sockaddr *)&peer, &peerLen);
+  stat->bytes = 0;
+  stat->ok = (sock != UDT::INVALID_SOCK);
+
+  H264Source source(seed);
+  std::vector<char> au;
+  while (stat->ok && stat->bytes < totalBytes) {
+    source.next(au);
+    int sent = 0;
+    while (sent < (int)au.size()) {
+      int n = UDT::send(sock, &au[sent], (int)au.size() - sent, 0);
+      if (n == UDT::ERROR) {
+        printf("send: %s\n", UDT::getlasterror().getErrorMessage());
+        stat->ok = false;
+        break;
+      }
+      sent += n;
+    }
+    stat->bytes += sent;
+  }
+
+  /* Closing breaks the connection, wait until the receiver has its stats */
+  while (!stat->receiverDone.load()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  if (stat->ok && UDT::ERROR == UDT::perfmon(sock, &stat->perf)) stat->ok = false;
+  UDT::close(sock);
+}
+
+int main(int argc, char **argv) {
+  uint64_t totalBytes = ((argc > 1) ? strtoull(argv[1], NULL, 10) : 200) * 1024 * 1024;
+  const uint32_t seed = 2020;
+
+  UDT::startup();
+
+  UDTSOCKET server = UDT::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = 0;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  int addrLen = sizeof(addr);
+  if (UDT::ERROR == UDT::bind(server, (sockaddr *)&addr, sizeof(addr)) ||
+      UDT::ERROR == UDT::getsockname(server, (sockaddr *)&addr, &addrLen) ||
+      UDT::ERROR == UDT::listen(server, 1)) {
+    printf("server: %s\n", UDT::getlasterror().getErrorMessage());
+    return 1;
+  }
+
+  SenderStat senderStat;
+  senderStat.receiverDone = false;
+  std::thread sender(runSender, server, totalBytes, seed, &senderStat);
+
+  UDTSOCKET sock = UDT::socket(AF_INET, SOCK_STREAM, 0);
+  if (UDT::ERROR == UDT::connect(sock, (sockaddr *)&addr, sizeof(addr))) {
+    printf("connect: %s\n", UDT::getlasterror().getErrorMessage());
+    return 1;
+  }
+
+  StreamChecker checker(seed);
+  std::vector<char> buf(RECEIVE_SIZE);
+  uint64_t received = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  while (received < totalBytes) {
+    int n = UDT::recv(sock, &buf[0], RECEIVE_SIZE, 0);
+    if (n == UDT::ERROR) break;
+    checker.feed(&buf[0], n);
+    received += n;
+  }
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  UDT::TRACEINFO perf;
+  bool perfOk = (UDT::ERROR != UDT::perfmon(sock, &perf));
+  senderStat.receiverDone = true;
+  sender.join();
+  UDT::close(sock);
+  UDT::close(server);
+  UDT::cleanup();
+
+  printf("%.1f MB in %llu access units, %.2f s, %.1f MB/s\n", received / (1024.0 * 1024.0),
+         (unsigned long long)checker.getUnits(), sec, received / (1024.0 * 1024.0) / sec);
+  printf("receive: %lld packets in %lld calls, %.1f per call, %d at most\n",
+         (long long)perf.sysRecvPktTotal, (long long)perf.sysRecvCallTotal,
+         perf.sysRecvCallTotal ? (double)perf.sysRecvPktTotal / perf.sysRecvCallTotal : 0.0,
+         perf.sysRecvBatchMax);
+  if (senderStat.ok) {
+    UDT::TRACEINFO &s = senderStat.perf;
+    printf("send:    %lld packets in %lld calls, %.1f per call, %d at most\n",
+           (long long)s.sysSendPktTotal, (long long)s.sysSendCallTotal,
+           s.sysSendCallTotal ? (double)s.sysSendPktTotal / s.sysSendCallTotal : 0.0,
+           s.sysSendBatchMax);
+    printf("%lld data packets sent, %d retransmitted, %d lost at the receiver\n",
+           (long long)s.pktSentTotal, s.pktRetransTotal, perf.pktRcvLossTotal);
+  }
+
+  bool pass = perfOk && senderStat.ok && received >= totalBytes && checker.getMismatches() == 0;
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+/*! @file benchmark/work_stealing_pool_bench/main.cpp
+ *  @version 4.0.0
+ *  @date Jan 2020
+ *
+ *  @brief
+ *  Throughput of the stereo depth stage pipeline on the WorkStealingPool,
+ *  compared with running the stages of every direction on one thread.
+ *  The stages only burn a fixed amount of CPU time, so OpenCV is not needed.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "work_stealing_pool.hpp"
+
+using namespace M210_STEREO;
+
+typedef std::chrono::steady_clock Clock;
+
+/* Stage costs in us, roughly the ratio of remap, StereoBM and the depth
+ * conversion of a VGA pair */
+static int rectifyUs = 1000;
+static int matchUs   = 6000;
+static int depthUs   = 500;
+
+/* Same as StereoDepthEngine::SLOT_NUM, frames of a direction in flight */
+static const int slotNum = 2;
+
+static uint64_t threadCpuUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* CPU time of the calling thread, so more threads than cores gain nothing */
+static void burn(int us) {
+  uint64_t end = threadCpuUs() + us;
+  volatile uint64_t x = 0;
+  while (threadCpuUs() < end) x++;
+}
+
+typedef struct Direction {
+  int nextFrame;
+  int doneFrames;
+  std::vector<Clock::time_point> startTime;
+} Direction;
+
+/* Runs the stages the way StereoDepthEngine chains them: rectify posts
+ * match, match runs depth, and a finished slot starts the next frame. */
+class PipelineRun {
+ public:
+  PipelineRun(int directionNum, int frameNum, int threadNum)
+      : frameNum(frameNum), remaining(directionNum * frameNum), latencySumMs(0),
+        maxLatencyMs(0), pool(threadNum) {
+    directions.resize(directionNum);
+    for (int d = 0; d < directionNum; d++) {
+      directions[d].nextFrame = 0;
+      directions[d].doneFrames = 0;
+      directions[d].startTime.resize(frameNum);
+    }
+  }
+
+  double run() {
+    Clock::time_point start = Clock::now();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (size_t d = 0; d < directions.size(); d++) {
+        for (int s = 0; s < slotNum; s++) startFrame((int)d);
+      }
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    while (remaining > 0) done.wait(lock);
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+  bool allDone() {
+    for (size_t d = 0; d < directions.size(); d++) {
+      if (directions[d].doneFrames != frameNum) return false;
+    }
+    return true;
+  }
+
+  double averageLatencyMs() {
+    return latencySumMs / (directions.size() * frameNum);
+  }
+
+  double maxLatency() { return maxLatencyMs; }
+
+ private:
+  /* mutex held */
+  void startFrame(int d) {
+    Direction &dir = directions[d];
+    if (dir.nextFrame >= frameNum) return;
+    int frame = dir.nextFrame++;
+    dir.startTime[frame] = Clock::now();
+    pool.post([this, d, frame] { rectify(d, frame); });
+  }
+
+  void rectify(int d, int frame) {
+    burn(rectifyUs);
+    pool.submit([this, d, frame] { match(d, frame); });
+  }
+
+  void match(int d, int frame) {
+    burn(matchUs);
+    depth(d, frame);
+  }
+
+  void depth(int d, int frame) {
+    burn(depthUs);
+    std::lock_guard<std::mutex> lock(mutex);
+    Direction &dir = directions[d];
+    double ms = std::chrono::duration<double, std::milli>(
+        Clock::now() - dir.startTime[frame]).count();
+    latencySumMs += ms;
+    maxLatencyMs = std::max(maxLatencyMs, ms);
+    dir.doneFrames++;
+    startFrame(d);
+    if (--remaining == 0) done.notify_all();
+  }
+
+  int frameNum;
+  std::vector<Direction> directions;
+  std::mutex mutex;
+  std::condition_variable done;
+  int remaining;
+  double latencySumMs;
+  double maxLatencyMs;
+
+  /* declared last, so its workers are joined before the rest goes away */
+  WorkStealingPool pool;
+};
+
+static double runSerial(int directionNum, int frameNum) {
+  Clock::time_point start = Clock::now();
+  for (int f = 0; f < frameNum; f++) {
+    for (int d = 0; d < directionNum; d++) {
+      burn(rectifyUs);
+      burn(matchUs);
+      burn(depthUs);
+    }
+  }
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+  int directionNum = (argc > 1) ? atoi(argv[1]) : 6;
+  int frameNum = (argc > 2) ? atoi(argv[2]) : 40;
+  int threadNum = (argc > 3) ? atoi(argv[3]) : 0;
+  int cores = std::max(1u, std::thread::hardware_concurrency());
+  int pairs = directionNum * frameNum;
+
+  printf("%d directions x %d frames, stages %d/%d/%d us, %d cores\n",
+         directionNum, frameNum, rectifyUs, matchUs, depthUs, cores);
+
+  double serialMs = runSerial(directionNum, frameNum);
+  printf("%-24s %8.1f ms  %7.1f pairs/s\n", "serial, 1 thread", serialMs,
+         pairs * 1000.0 / serialMs);
+
+  PipelineRun pipeline(directionNum, frameNum, threadNum);
+  double poolMs = pipeline.run();
+  char name[64];
+  snprintf(name, sizeof(name), "pool, %d threads", threadNum > 0 ? threadNum : cores);
+  printf("%-24s %8.1f ms  %7.1f pairs/s  x%.2f  latency avg %.1f ms max %.1f ms\n",
+         name, poolMs, pairs * 1000.0 / poolMs, serialMs / poolMs,
+         pipeline.averageLatencyMs(), pipeline.maxLatency());
+
+  bool pass = pipeline.allDone();
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}